@@ -441,6 +441,8 @@ struct Request_Info
     char userAgent[NAME_SIZE];
     /** The address the request came from. */
     char sourceAddress[INET6_ADDRSTRLEN];
+    /** The Accept-Encoding header of this request. */
+    char acceptEncoding[NAME_SIZE];
 };
 
 /*!
@@ -839,6 +841,16 @@ struct File_Info
     * to 0. */
     int is_cacheable;
 
+    /** The entity tag of the file, including the quotes, or an empty
+    *  string if the file has none. A request with a matching
+    *  If-None-Match header is answered with "304 Not Modified". */
+    char etag[NAME_SIZE];
+
+    /** The content encoding of the file, or an empty string if the file
+    *  has only one representation. If set, a "Vary: Accept-Encoding"
+    *  header is sent; "identity" sends no Content-Encoding header. */
+    char content_encoding[NAME_SIZE];
+
 	/** The content type of the file. This string needs to be allocated 
 	*  by the caller using {\bf ixmlCloneDOMString}.  When finished 
 	*  with it, the SDK frees the {\bf DOMString}. */
@@ -1011,6 +1011,25 @@ static int CheckOtherHTTPHeaders(
 	return RetCode;
 }
 
+/*!
+ * \brief Checks if an If-None-Match header matches an entity tag.
+ *
+ * \return
+ * \li \c 1 - if the header is "*" or lists the entity tag.
+ * \li \c 0 - otherwise.
+ */
+static int etag_matches(
+	/*! [in] The value of the If-None-Match header. */
+	const char *if_none_match,
+	/*! [in] The entity tag, including the quotes. */
+	const char *etag)
+{
+	while (*if_none_match == ' ' || *if_none_match == '\t')
+		if_none_match++;
+
+	return *if_none_match == '*' || strstr(if_none_match, etag) != NULL;
+}
+
 /*!
  * \brief Processes the request and returns the result in the output parameters.
  *
@@ -1054,7 +1073,10 @@ static int process_request(
 	int alias_grabbed;
 	size_t dummy;
 	const char *extra_headers = NULL;
+    char extra_headers_buf[3 * NAME_SIZE];
+    http_header_t *ifNoneMatch;
     memptr userAgent;
+    memptr acceptEncoding;
     struct sockaddr_in *inAddr;
 
 	print_http_headers(req);
@@ -1124,6 +1146,9 @@ static int process_request(
             rinfo.userAgent[0] = rinfo.userAgent[sizeof(rinfo.userAgent) - 1] = '\0';
             if (httpmsg_find_hdr(req, HDR_USER_AGENT, &userAgent))
                 strncpy(rinfo.userAgent, userAgent.buf, sizeof(rinfo.userAgent) - 1);
+            rinfo.acceptEncoding[0] = rinfo.acceptEncoding[sizeof(rinfo.acceptEncoding) - 1] = '\0';
+            if (httpmsg_find_hdr(req, HDR_ACCEPT_ENCODING, &acceptEncoding))
+                strncpy(rinfo.acceptEncoding, acceptEncoding.buf, sizeof(rinfo.acceptEncoding) - 1);
             inAddr = ((struct sockaddr_in *)&info->foreign_sockaddr);
             if (inet_ntop(inAddr->sin_family, &inAddr->sin_addr, rinfo.sourceAddress, sizeof(rinfo.sourceAddress)) == NULL)
                 rinfo.sourceAddress[0] = '\0';
@@ -1233,10 +1258,41 @@ static int process_request(
 		goto error_handler;
 	}
 
+    extra_headers_buf[0] = '\0';
     if (finfo.is_cacheable == 0) {
-        extra_headers = "CACHE-CONTROL: no-cache\r\n";
-    } else {
-        extra_headers = "";
+        strcat(extra_headers_buf, "CACHE-CONTROL: no-cache\r\n");
+    }
+    if (finfo.etag[0] != '\0') {
+        strcat(extra_headers_buf, "ETAG: ");
+        strcat(extra_headers_buf, finfo.etag);
+        strcat(extra_headers_buf, "\r\n");
+    }
+    if (finfo.content_encoding[0] != '\0') {
+        if (strcmp(finfo.content_encoding, "identity") != 0) {
+            strcat(extra_headers_buf, "CONTENT-ENCODING: ");
+            strcat(extra_headers_buf, finfo.content_encoding);
+            strcat(extra_headers_buf, "\r\n");
+        }
+        strcat(extra_headers_buf, "VARY: Accept-Encoding\r\n");
+    }
+    extra_headers = extra_headers_buf;
+
+    /* Answer a conditional request for an unchanged file with headers only. */
+    if (finfo.etag[0] != '\0' && req->method != HTTPMETHOD_SIMPLEGET) {
+        ifNoneMatch = httpmsg_find_hdr_str(req, "IF-NONE-MATCH");
+        if (ifNoneMatch && ifNoneMatch->value.buf &&
+            etag_matches(ifNoneMatch->value.buf, finfo.etag)) {
+            if (http_MakeMessage(headers, resp_major, resp_minor,
+                "R" "D" "S" "Xc" "sCc",
+                HTTP_NOT_MODIFIED,	/* status code */
+                X_USER_AGENT,
+                extra_headers) != 0) {
+                goto error_handler;
+            }
+            *rtype = RESP_HEADERS;
+            err_code = HTTP_OK;
+            goto error_handler;
+        }
     }
 
 	/* Check if chunked encoding should be used. */
@@ -1382,6 +1438,7 @@ static int http_RecvPostMessage(
 	int num_read = 0;
 	int ret_code = HTTP_OK;
     memptr userAgent;
+    memptr acceptEncoding;
     struct sockaddr_in *inAddr;
 
 	if (Instr && Instr->IsVirtualFile) {
@@ -1390,6 +1447,9 @@ static int http_RecvPostMessage(
         rinfo.userAgent[0] = rinfo.userAgent[sizeof(rinfo.userAgent) - 1] = '\0';
         if (httpmsg_find_hdr(&parser->msg, HDR_USER_AGENT, &userAgent))
             strncpy(rinfo.userAgent, userAgent.buf, sizeof(rinfo.userAgent) - 1);
+        rinfo.acceptEncoding[0] = rinfo.acceptEncoding[sizeof(rinfo.acceptEncoding) - 1] = '\0';
+        if (httpmsg_find_hdr(&parser->msg, HDR_ACCEPT_ENCODING, &acceptEncoding))
+            strncpy(rinfo.acceptEncoding, acceptEncoding.buf, sizeof(rinfo.acceptEncoding) - 1);
         inAddr = ((struct sockaddr_in *)&info->foreign_sockaddr);
         if (inet_ntop(inAddr->sin_family, &inAddr->sin_addr, rinfo.sourceAddress, sizeof(rinfo.sourceAddress)) == NULL)
             rinfo.sourceAddress[0] = '\0';
@@ -1503,6 +1563,7 @@ void web_server_callback(http_parser_t *parser, INOUT http_message_t *req,
 	struct xml_alias_t xmldoc;
 	struct SendInstruction RespInstr;
     memptr userAgent;
+    memptr acceptEncoding;
     struct Request_Info rinfo;
     struct sockaddr_in *inAddr;
 
@@ -1531,6 +1592,9 @@ void web_server_callback(http_parser_t *parser, INOUT http_message_t *req,
         rinfo.userAgent[0] = rinfo.userAgent[sizeof(rinfo.userAgent) - 1] = '\0';
         if (httpmsg_find_hdr(req, HDR_USER_AGENT, &userAgent))
             strncpy(rinfo.userAgent, userAgent.buf, sizeof(rinfo.userAgent) - 1);
+        rinfo.acceptEncoding[0] = rinfo.acceptEncoding[sizeof(rinfo.acceptEncoding) - 1] = '\0';
+        if (httpmsg_find_hdr(req, HDR_ACCEPT_ENCODING, &acceptEncoding))
+            strncpy(rinfo.acceptEncoding, acceptEncoding.buf, sizeof(rinfo.acceptEncoding) - 1);
         inAddr = ((struct sockaddr_in *)&info->foreign_sockaddr);
         if (inet_ntop(inAddr->sin_family, &inAddr->sin_addr, rinfo.sourceAddress, sizeof(rinfo.sourceAddress)) == NULL)
             rinfo.sourceAddress[0] = '\0';
@@ -2,6 +2,7 @@
 #include "platform/messageloop.h"
 #include "platform/path.h"
 #include "platform/process.h"
+#include "platform/recordfile.h"
 #include "platform/string.h"
 #include "pupnp/client.h"
 #include "pupnp/upnp.h"
@@ -86,6 +87,22 @@ static int run_server(
         save_media_cache_timer.start(std::chrono::seconds(5), true);
     };
 
+    // Kept separate from the media cache file, as new values can only be
+    // appended to an inifile with a single section.
+    class platform::inifile media_fingerprints_file(
+                platform::config_dir() + "/media_fingerprints", false);
+
+    class platform::timer save_media_fingerprints_timer(
+                messageloop_ref,
+                std::bind(&platform::inifile::save, &media_fingerprints_file));
+    media_fingerprints_file.on_touched = [&save_media_fingerprints_timer]
+    {
+        save_media_fingerprints_timer.start(std::chrono::seconds(5), true);
+    };
+
+    class platform::recordfile media_store_file(
+                platform::config_dir() + "/media_store");
+
     class platform::inifile watchlist_file(
                 platform::config_dir() + "/watchlist", false);
 
@@ -97,15 +114,28 @@ static int run_server(
         save_watchlist_timer.start(std::chrono::seconds(1), true);
     };
 
+    class platform::inifile objectids_file(
+                platform::config_dir() + "/objectids", false);
+
+    class platform::timer save_objectids_timer(
+                messageloop_ref,
+                std::bind(&platform::inifile::save, &objectids_file));
+    objectids_file.on_touched = [&save_objectids_timer]
+    {
+        save_objectids_timer.start(std::chrono::seconds(5), true);
+    };
+
     server::recreate_server = [
             &messageloop, &messageloop_ref,
-            &media_cache_file, &watchlist_file,
+            &media_cache_file, &media_fingerprints_file, &media_store_file,
+            &watchlist_file, &objectids_file,
             &upnp, &settings, &logfile]
     {
         server_ptr = nullptr;
         server_ptr.reset(new class server(
                              messageloop_ref, settings, upnp, logfile,
-                             media_cache_file, watchlist_file));
+                             media_cache_file, media_fingerprints_file,
+                             media_store_file, watchlist_file, objectids_file));
 
         if (!server_ptr->initialize())
         {
@@ -37,6 +37,7 @@ public:
 private:
     class ps_filter &parent;
     std::list<class ps_packet> pack;
+    size_t pack_offset;
 };
 
 ps_filter::ps_filter(std::unique_ptr<std::istream> &&input)
@@ -46,7 +47,8 @@ ps_filter::ps_filter(std::unique_ptr<std::istream> &&input)
       end_code_sent(false),
       clock_offset(-1),
       pack_header_interval(max_pack_header_interval - 3000),
-      next_pack_header(90000)
+      next_pack_header(90000),
+      pack_has_sequence_header(false)
 {
 }
 
@@ -55,6 +57,13 @@ ps_filter::~ps_filter()
     delete std::istream::rdbuf(nullptr);
 }
 
+std::vector<size_t> ps_filter::take_random_access_points()
+{
+    std::vector<size_t> result;
+    result.swap(random_access_points);
+    return result;
+}
+
 static uint64_t get_timestamp(const class pes_packet &pes_packet)
 {
     if (pes_packet.has_pts())
@@ -65,6 +74,20 @@ static uint64_t get_timestamp(const class pes_packet &pes_packet)
     return uint64_t(-1);
 }
 
+static bool has_sequence_header(const class pes_packet &pes_packet)
+{
+    const uint8_t * const payload = pes_packet.payload();
+    const size_t size = pes_packet.payload_size();
+    for (size_t i = 3; i < size; i++)
+        if ((payload[i] == 0xB3) && (payload[i - 1] == 0x01) &&
+            (payload[i - 2] == 0x00) && (payload[i - 3] == 0x00))
+        {
+            return true;
+        }
+
+    return false;
+}
+
 static void finish_pack(std::list<ps_packet> &pack, uint64_t scr)
 {
     class ps_pack_header ps_pack_header;
@@ -91,6 +114,7 @@ std::list<ps_packet> ps_filter::read_pack()
     static const size_t max_packet_queue_size = 64;
 
     std::list<ps_packet> pack;
+    pack_has_sequence_header = false;
     for (;;)
     {
         uint64_t lts = uint64_t(-1);
@@ -161,6 +185,7 @@ std::list<ps_packet> ps_filter::read_pack()
                     last_timestamp.clear();
                     clock_offset = -1;
                     pack.clear();
+                    pack_has_sequence_header = false;
                     continue;
                 }
 
@@ -203,6 +228,9 @@ std::list<ps_packet> ps_filter::read_pack()
                     std::cout << std::endl;
 #endif
 
+                    if (pes_packet.is_video_stream() && has_sequence_header(pes_packet))
+                        pack_has_sequence_header = true;
+
                     pack.emplace_back(std::move(pes_packet));
                 } while (!lstream->empty() && (get_timestamp(lstream->front()) == uint64_t(-1)));
             }
@@ -348,7 +376,8 @@ ps_packet ps_filter::read_ps_packet()
 
 
 ps_filter::streambuf::streambuf(class ps_filter &parent)
-    : parent(parent)
+    : parent(parent),
+      pack_offset(0)
 {
 }
 
@@ -358,10 +387,17 @@ int ps_filter::streambuf::underflow()
         return traits_type::to_int_type(*gptr());
 
     if (!pack.empty())
+    {
+        pack_offset += pack.front().size();
         pack.pop_front();
+    }
 
     if (pack.empty())
+    {
         pack = parent.read_pack();
+        if (parent.pack_has_sequence_header)
+            parent.random_access_points.push_back(pack_offset);
+    }
 
     if (!pack.empty())
     {
@@ -24,6 +24,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace mpeg {
 
@@ -33,6 +34,12 @@ public:
     ps_filter(std::unique_ptr<std::istream> &&input);
     ~ps_filter();
 
+    /*! Returns the output offsets of the packs holding a video sequence
+        header, where a decoder can start, that were read since the previous
+        call.
+     */
+    std::vector<size_t> take_random_access_points();
+
 private:
     std::list<ps_packet> read_pack();
     void filter_packet();
@@ -54,6 +61,9 @@ private:
     static const uint64_t pack_header_delay = 15000;
     const uint64_t pack_header_interval;
     uint64_t next_pack_header;
+
+    bool pack_has_sequence_header;
+    std::vector<size_t> random_access_points;
 };
 
 } // End of namespace
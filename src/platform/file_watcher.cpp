@@ -0,0 +1,260 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "file_watcher.h"
+
+namespace platform {
+
+static std::string to_dir(const std::string &path)
+{
+    if (!path.empty() && (path[path.length() - 1] != '/'))
+        return path + '/';
+
+    return path;
+}
+
+bool file_watcher::is_watched(const std::string &dir) const
+{
+    std::lock_guard<std::mutex> _(mutex);
+
+    return watches.find(to_dir(dir)) != watches.end();
+}
+
+} // End of namespace
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <cerrno>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <vector>
+
+namespace platform {
+
+static const uint32_t watch_mask =
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+file_watcher::file_watcher(
+        class messageloop_ref &messageloop,
+        const std::function<void(const std::string &, const std::string &)> &changed)
+    : messageloop(messageloop),
+      changed(changed),
+      inotify_fd(::inotify_init1(IN_CLOEXEC)),
+      thread()
+{
+    if (inotify_fd < 0)
+    {
+        std::clog << "platform::file_watcher: inotify is not available, directories will be listed on each request." << std::endl;
+        return;
+    }
+
+    if (::pipe(stop_pipe) != 0)
+    {
+        ::close(inotify_fd);
+        inotify_fd = -1;
+        return;
+    }
+
+    thread.reset(new std::thread([this]
+    {
+        alignas(struct inotify_event) char buffer[65536];
+
+        for (;;)
+        {
+            struct pollfd fds[2];
+            fds[0].fd = inotify_fd;
+            fds[0].events = POLLIN;
+            fds[1].fd = stop_pipe[0];
+            fds[1].events = POLLIN;
+
+            if (::poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                else
+                    break;
+            }
+
+            if (fds[1].revents != 0)
+                break;
+
+            const ssize_t size = ::read(inotify_fd, buffer, sizeof(buffer));
+            if (size <= 0)
+            {
+                if ((size < 0) && (errno == EINTR))
+                    continue;
+                else
+                    break;
+            }
+
+            for (ssize_t i = 0; i < size; )
+            {
+                const auto &event = *reinterpret_cast<const struct inotify_event *>(buffer + i);
+                i += sizeof(struct inotify_event) + event.len;
+
+                // Files are reported when they are closed after writing, so
+                // that half written files are not scanned.
+                if ((event.mask & IN_CREATE) && !(event.mask & IN_ISDIR))
+                    continue;
+
+                std::string name = (event.len > 0) ? std::string(event.name) : std::string();
+                if (!name.empty() && (event.mask & IN_ISDIR))
+                    name.push_back('/');
+
+                const int wd = event.wd;
+                const uint32_t mask = event.mask;
+                this->messageloop.post([this, wd, mask, name] { this->event(wd, mask, name); });
+            }
+        }
+    }));
+}
+
+file_watcher::~file_watcher()
+{
+    if (thread)
+    {
+        const char stop = 0;
+        if (::write(stop_pipe[1], &stop, sizeof(stop)) == sizeof(stop))
+            thread->join();
+        else
+            thread->detach();
+
+        thread = nullptr;
+
+        ::close(stop_pipe[0]);
+        ::close(stop_pipe[1]);
+    }
+
+    if (inotify_fd >= 0)
+        ::close(inotify_fd);
+}
+
+bool file_watcher::watch(const std::string &path)
+{
+    const auto dir = to_dir(path);
+
+    std::lock_guard<std::mutex> _(mutex);
+    if (watches.find(dir) != watches.end())
+        return true;
+
+    if (thread)
+    {
+        const int wd = ::inotify_add_watch(inotify_fd, dir.c_str(), watch_mask);
+        if (wd >= 0)
+        {
+            // Two paths to the same directory share one watch, events are
+            // reported for each of them.
+            watches[dir] = wd;
+            directories.emplace(wd, dir);
+            return true;
+        }
+        else if (errno == ENOSPC)
+        {
+            static bool logged = false;
+            if (!logged)
+            {
+                std::clog << "platform::file_watcher: inotify watch limit reached, increase fs.inotify.max_user_watches." << std::endl;
+                logged = true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void file_watcher::unwatch(const std::string &path)
+{
+    std::lock_guard<std::mutex> _(mutex);
+
+    auto i = watches.find(to_dir(path));
+    if (i != watches.end())
+    {
+        const int wd = i->second;
+        for (auto j = directories.lower_bound(wd); (j != directories.end()) && (j->first == wd); j++)
+            if (j->second == i->first)
+            {
+                directories.erase(j);
+                break;
+            }
+
+        if (directories.find(wd) == directories.end())
+            ::inotify_rm_watch(inotify_fd, wd);
+
+        watches.erase(i);
+    }
+}
+
+void file_watcher::event(int wd, uint32_t mask, const std::string &name)
+{
+    if (mask & IN_Q_OVERFLOW)
+        return changed(std::string(), std::string());
+
+    std::vector<std::string> dirs;
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        for (auto i = directories.lower_bound(wd); (i != directories.end()) && (i->first == wd); i++)
+            dirs.push_back(i->second);
+    }
+
+    for (auto &dir : dirs)
+    {
+        if (mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+        {
+            unwatch(dir);
+            changed(dir, std::string());
+        }
+        else
+            changed(dir, name);
+    }
+}
+
+} // End of namespace
+
+#else
+
+namespace platform {
+
+file_watcher::file_watcher(
+        class messageloop_ref &messageloop,
+        const std::function<void(const std::string &, const std::string &)> &changed)
+    : messageloop(messageloop),
+      changed(changed)
+{
+}
+
+file_watcher::~file_watcher()
+{
+}
+
+bool file_watcher::watch(const std::string &)
+{
+    return false;
+}
+
+void file_watcher::unwatch(const std::string &)
+{
+}
+
+void file_watcher::event(int, uint32_t, const std::string &)
+{
+}
+
+} // End of namespace
+#endif
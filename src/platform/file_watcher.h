@@ -0,0 +1,72 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef PLATFORM_FILE_WATCHER_H
+#define PLATFORM_FILE_WATCHER_H
+
+#include "platform/messageloop.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace platform {
+
+/*! Watches directories for added, removed and rewritten entries. The changed
+    callback is invoked on the messageloop with the watched directory and the
+    name of the entry (with a trailing '/' for directories). The name is empty
+    if the directory itself was removed, and both are empty if events were
+    lost and all watched directories should be considered changed. Watches
+    can be added from any thread.
+ */
+class file_watcher
+{
+public:
+    file_watcher(
+            class messageloop_ref &,
+            const std::function<void(const std::string &dir, const std::string &name)> &changed);
+
+    ~file_watcher();
+
+    bool watch(const std::string &dir);
+    bool is_watched(const std::string &dir) const;
+    void unwatch(const std::string &dir);
+
+private:
+    void event(int wd, uint32_t mask, const std::string &name);
+
+private:
+    class messageloop_ref messageloop;
+    const std::function<void(const std::string &, const std::string &)> changed;
+
+    mutable std::mutex mutex;
+    std::map<std::string, int> watches;
+    std::multimap<int, std::string> directories;
+
+#if defined(__linux__)
+    int inotify_fd;
+    int stop_pipe[2];
+    std::unique_ptr<std::thread> thread;
+#endif
+};
+
+} // End of namespace
+
+#endif
@@ -40,6 +40,8 @@ inifile::~inifile()
 
 void inifile::save()
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     assert(!read_only);
     if (!read_only)
     {
@@ -51,6 +53,8 @@ void inifile::save()
 
 std::set<std::string> inifile::sections() const
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     std::set<std::string> result;
     for (auto &i : values)
         result.insert(i.first);
@@ -60,6 +64,8 @@ std::set<std::string> inifile::sections() const
 
 bool inifile::has_section(const std::string &name) const
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     return values.find(name) != values.end();
 }
 
@@ -75,6 +81,8 @@ class inifile::section inifile::open_section(const std::string &name)
 
 void inifile::erase_section(const std::string &name)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     assert(!read_only);
     if (!read_only)
     {
@@ -422,6 +430,8 @@ inifile::const_section::const_section(const const_section &from)
 
 std::set<std::string> inifile::const_section::names() const
 {
+    std::lock_guard<std::recursive_mutex> _(inifile.mutex);
+
     auto i = inifile.values.find(section_name);
     if (i != inifile.values.end())
     {
@@ -437,6 +447,8 @@ std::set<std::string> inifile::const_section::names() const
 
 bool inifile::const_section::has_value(const std::string &name) const
 {
+    std::lock_guard<std::recursive_mutex> _(inifile.mutex);
+
     auto i = inifile.values.find(section_name);
     if (i != inifile.values.end())
         return i->second.find(name) != i->second.end();
@@ -446,6 +458,8 @@ bool inifile::const_section::has_value(const std::string &name) const
 
 std::string inifile::const_section::read(const std::string &name, const std::string &default_) const
 {
+    std::lock_guard<std::recursive_mutex> _(inifile.mutex);
+
     auto i = inifile.values.find(section_name);
     if (i != inifile.values.end())
     {
@@ -503,6 +517,8 @@ inifile::section::section(const section &from)
 
 void inifile::section::write(const std::string &name, const std::string &value)
 {
+    std::lock_guard<std::recursive_mutex> _(inifile.mutex);
+
     auto i = inifile.values.find(section_name);
     if (i != inifile.values.end())
     {
@@ -564,6 +580,8 @@ void inifile::section::write(const std::string &name, long long value)
 
 void inifile::section::erase(const std::string &name)
 {
+    std::lock_guard<std::recursive_mutex> _(inifile.mutex);
+
     auto i = inifile.values.find(section_name);
     if (i != inifile.values.end())
     {
@@ -23,10 +23,14 @@
 #include <istream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 
 namespace platform {
 
+/*! An ini file that keeps unchanged values in the file, the sections and
+    values can be read and written from multiple threads.
+ */
 class inifile
 {
 private:
@@ -128,6 +132,7 @@ private:
     std::unique_ptr<std::iostream> file;
     std::map<std::string, std::map<std::string, string_ref>> values;
     enum { none, soft, hard } touched;
+    mutable std::recursive_mutex mutex;
 };
 
 } // End of namespace
@@ -19,11 +19,14 @@
 #include "string.h"
 #include "uuid.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <mutex>
+#include <thread>
 #include <unordered_set>
 
 static const size_t min_file_size = 65536;
+static const size_t max_list_threads = 8;
 
 namespace platform {
 
@@ -74,6 +77,34 @@ std::string path_from_mrl(const std::string &mrl)
     return std::string();
 }
 
+std::vector<std::vector<std::string>> list_files(
+        const std::vector<std::string> &paths,
+        file_filter filter,
+        size_t max_count)
+{
+    std::vector<std::vector<std::string>> result(paths.size());
+
+    // Listing a directory mostly waits for the disk or network, so a few
+    // directories are listed at the same time.
+    std::atomic<size_t> next(0);
+    const auto list = [&paths, filter, max_count, &result, &next]
+    {
+        for (size_t i = next++; i < paths.size(); i = next++)
+            result[i] = list_files(paths[i], filter, max_count);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1, n = std::min(paths.size(), max_list_threads); i < n; i++)
+        threads.emplace_back(list);
+
+    list();
+
+    for (auto &i : threads)
+        i.join();
+
+    return result;
+}
+
 } // End of namespace
 
 #if defined(__unix__) || defined(__APPLE__)
@@ -186,36 +217,60 @@ std::vector<std::string> list_files(
     {
         auto &hidden_names = platform::hidden_names();
         auto &hidden_suffixes = platform::hidden_suffixes();
+        const int fd = ::dirfd(dir);
 
         for (auto dirent = ::readdir(dir);
              dirent && (result.size() < max_count);
              dirent = ::readdir(dir))
         {
+            if (dirent->d_name[0] == '.')
+                continue;
+
+            const std::string name = dirent->d_name;
+            if (name.empty() || (name[name.length() - 1] == '~'))
+                continue;
+
+            // The file type from the directory entry is used where possible,
+            // stat is only needed for symlinks, file sizes and file systems
+            // that do not provide it.
             struct stat stat;
-            if ((dirent->d_name[0] != '.') &&
-                (::stat((cpath + dirent->d_name).c_str(), &stat) == 0))
+            bool has_stat = false;
+            const auto stat_entry = [fd, &dirent, &stat, &has_stat]
             {
-                const std::string name = dirent->d_name;
-                if (!name.empty() && (name[name.length() - 1] != '~'))
-                {
-                    const std::string lname = to_lower(name);
-                    if (S_ISDIR(stat.st_mode) &&
-                        (hidden_names.find(lname) == hidden_names.end()) &&
-                        (hidden_dirs.find(cpath + name) == hidden_dirs.end()))
-                    {
-                        result.emplace_back(name + '/');
-                    }
-                    else if (filter == file_filter::all)
-                    {
-                        result.emplace_back(std::move(name));
-                    }
-                    else if ((filter == file_filter::large_files) &&
-                             (size_t(stat.st_size) >= min_file_size) &&
-                             (hidden_suffixes.find(suffix_of(lname)) == hidden_suffixes.end()))
-                    {
-                        result.emplace_back(std::move(name));
-                    }
-                }
+                if (!has_stat)
+                    has_stat = ::fstatat(fd, dirent->d_name, &stat, 0) == 0;
+
+                return has_stat;
+            };
+
+            bool is_dir = false;
+#if defined(DT_DIR)
+            if ((dirent->d_type == DT_DIR) || (dirent->d_type == DT_REG))
+                is_dir = dirent->d_type == DT_DIR;
+            else
+#endif
+            if (stat_entry())
+                is_dir = S_ISDIR(stat.st_mode);
+            else
+                continue;
+
+            const std::string lname = to_lower(name);
+            if (is_dir &&
+                (hidden_names.find(lname) == hidden_names.end()) &&
+                (hidden_dirs.find(cpath + name) == hidden_dirs.end()))
+            {
+                result.emplace_back(name + '/');
+            }
+            else if (filter == file_filter::all)
+            {
+                result.emplace_back(std::move(name));
+            }
+            else if ((filter == file_filter::large_files) &&
+                     (hidden_suffixes.find(suffix_of(lname)) == hidden_suffixes.end()) &&
+                     stat_entry() &&
+                     (size_t(stat.st_size) >= min_file_size))
+            {
+                result.emplace_back(std::move(name));
             }
         }
 
@@ -287,6 +342,25 @@ std::string file_date(const std::string &path)
     return std::string();
 }
 
+bool stat_file(const std::string &path, struct file_stat &file_stat)
+{
+    struct stat stat;
+    if (::stat(path.c_str(), &stat) == 0)
+    {
+        file_stat.device = stat.st_dev;
+        file_stat.inode = stat.st_ino;
+        file_stat.size = stat.st_size;
+#if defined(__APPLE__)
+        file_stat.mtime = (int64_t(stat.st_mtimespec.tv_sec) * 1000000000) + stat.st_mtimespec.tv_nsec;
+#else
+        file_stat.mtime = (int64_t(stat.st_mtim.tv_sec) * 1000000000) + stat.st_mtim.tv_nsec;
+#endif
+        return true;
+    }
+
+    return false;
+}
+
 std::string temp_file_path(const std::string &suffix)
 {
     return std::string("/tmp/") + std::string(uuid::generate()) + '.' + suffix;
@@ -605,6 +679,21 @@ std::string file_date(const std::string &path)
     return std::string();
 }
 
+bool stat_file(const std::string &path, struct file_stat &file_stat)
+{
+    struct _stati64 stat;
+    if (::_wstati64(to_windows_path(path).c_str(), &stat) == 0)
+    {
+        file_stat.device = stat.st_dev;
+        file_stat.inode = stat.st_ino; // Always 0 on Windows.
+        file_stat.size = stat.st_size;
+        file_stat.mtime = int64_t(stat.st_mtime) * 1000000000;
+        return true;
+    }
+
+    return false;
+}
+
 std::string temp_file_path(const std::string &suffix)
 {
     wchar_t temp_path[MAX_PATH];
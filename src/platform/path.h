@@ -18,6 +18,7 @@
 #ifndef PLATFORM_PATH_H
 #define PLATFORM_PATH_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -35,10 +36,27 @@ std::vector<std::string> list_files(
         file_filter filter = file_filter::large_files,
         size_t max_count = size_t(-1));
 
+/*! Lists multiple directories concurrently, the result contains the listing
+    of each path in the same order.
+ */
+std::vector<std::vector<std::string>> list_files(
+        const std::vector<std::string> &paths,
+        file_filter filter = file_filter::large_files,
+        size_t max_count = size_t(-1));
+
 std::vector<std::string> list_removable_media();
 
 std::string file_date(const std::string &path);
 
+struct file_stat
+{
+    uint64_t device, inode;
+    uint64_t size;
+    int64_t mtime; // In nanoseconds since the epoch.
+};
+
+bool stat_file(const std::string &path, struct file_stat &);
+
 std::string temp_file_path(const std::string &suffix);
 void remove_file(const std::string &);
 void rename_file(const std::string &old_path, const std::string &new_path);
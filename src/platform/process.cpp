@@ -286,6 +286,12 @@ void process::send_term()
         get_shared<bool>(0) = true;
 }
 
+void process::send_kill()
+{
+    // Threads can not be killed.
+    send_term();
+}
+
 bool process::term_pending() const
 {
     if ((thread == nullptr) && shm)
@@ -449,6 +455,14 @@ void process::send_term()
         throw std::runtime_error("Process not started.");
 }
 
+void process::send_kill()
+{
+    if (child != 0)
+        ::kill(child, SIGKILL);
+    else
+        throw std::runtime_error("Process not started.");
+}
+
 bool process::term_pending() const
 {
     return term_received;
@@ -647,6 +661,14 @@ void process::send_term()
         get_shared<bool>(0) = true;
 }
 
+void process::send_kill()
+{
+    if (child != 0)
+        ::TerminateProcess(HANDLE(child), 1);
+    else
+        throw std::runtime_error("Process not started.");
+}
+
 bool process::term_pending() const
 {
     if ((child == 0) && shm)
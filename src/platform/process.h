@@ -69,6 +69,7 @@ public:
     int output_fd();
 
     void send_term();
+    void send_kill();
     bool term_pending() const;
 
     bool joinable() const;
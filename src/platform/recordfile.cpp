@@ -0,0 +1,358 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "recordfile.h"
+#include "path.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace platform {
+
+static const char magic[4] = { 'L', 'X', 'i', 'R' };
+static const size_t file_header_size = 16;
+static const size_t record_header_size = 4 + sizeof(uuid::value);
+static const uint64_t min_compact_size = 65536;
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) |
+           (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static FILE * open_file(const std::string &filename, const char *mode);
+
+static bool write_record(FILE *file, const uuid &uuid, const uint8_t *data, uint32_t size)
+{
+    uint8_t header[record_header_size];
+    put_u32(header, size);
+    memcpy(header + 4, uuid.value, sizeof(uuid.value));
+
+    return
+            (fwrite(header, sizeof(header), 1, file) == 1) &&
+            ((size == 0) || (fwrite(data, size, 1, file) == 1));
+}
+
+recordfile::recordfile(const std::string &filename)
+    : filename(filename),
+      file_version(0),
+      wasted(0),
+      map(nullptr),
+      map_size(0),
+#if defined(WIN32)
+      file_handle(nullptr),
+      map_handle(nullptr),
+#endif
+      append_file(nullptr)
+{
+    uint64_t end = 0;
+    if (!read_index(end))
+        clear(0);
+    else if ((end != map_size) ||
+             ((wasted > min_compact_size) && (wasted > (map_size / 2))))
+    {
+        compact();
+    }
+
+    if (!append_file && !open_append())
+        std::clog << "platform::recordfile: failed to open " << filename << " for writing." << std::endl;
+}
+
+recordfile::~recordfile()
+{
+    if (append_file)
+        fclose(append_file);
+
+    unmap_file();
+}
+
+void recordfile::clear(uint32_t version)
+{
+    index.clear();
+    wasted = 0;
+    file_version = version;
+
+    compact();
+}
+
+size_t recordfile::uuid_hash::operator()(const uuid &uuid) const
+{
+    size_t result = 0;
+    memcpy(&result, uuid.value, std::min(sizeof(result), sizeof(uuid.value)));
+    return result;
+}
+
+bool recordfile::has_record(const uuid &uuid) const
+{
+    return index.find(uuid) != index.end();
+}
+
+std::string recordfile::read(const uuid &uuid) const
+{
+    auto i = index.find(uuid);
+    if (i != index.end())
+    {
+        if (i->second.mapped)
+            return std::string(reinterpret_cast<const char *>(map + i->second.offset), i->second.size);
+        else
+            return i->second.data;
+    }
+
+    return std::string();
+}
+
+void recordfile::write(const uuid &uuid, const std::string &data)
+{
+    auto i = index.find(uuid);
+    if (i != index.end())
+    {
+        if ((i->second.size == data.size()) && (read(uuid) == data))
+            return;
+
+        wasted += record_header_size + i->second.size;
+    }
+
+    const uint32_t size = uint32_t(data.size());
+    if (!append_file ||
+        !write_record(append_file, uuid, reinterpret_cast<const uint8_t *>(data.data()), size) ||
+        (fflush(append_file) != 0))
+    {
+        std::clog << "platform::recordfile: failed to write " << filename << std::endl;
+    }
+
+    struct record &record = index[uuid];
+    record.mapped = false;
+    record.offset = 0;
+    record.size = size;
+    record.data = data;
+}
+
+void recordfile::compact()
+{
+    const std::string temp_filename = filename + ".tmp";
+    FILE * const file = open_file(temp_filename, "wb");
+    if (!file)
+    {
+        std::clog << "platform::recordfile: failed to create " << temp_filename << std::endl;
+        return;
+    }
+
+    uint8_t header[file_header_size];
+    memset(header, 0, sizeof(header));
+    memcpy(header, magic, sizeof(magic));
+    put_u32(header + sizeof(magic), file_version);
+
+    bool result = fwrite(header, sizeof(header), 1, file) == 1;
+    for (auto i = index.begin(); (i != index.end()) && result; i++)
+    {
+        result = write_record(
+                    file, i->first,
+                    i->second.mapped
+                        ? (map + i->second.offset)
+                        : reinterpret_cast<const uint8_t *>(i->second.data.data()),
+                    i->second.size);
+    }
+
+    result &= fclose(file) == 0;
+    if (!result)
+    {
+        std::clog << "platform::recordfile: failed to write " << temp_filename << std::endl;
+        remove_file(temp_filename);
+        return;
+    }
+
+    if (append_file)
+    {
+        fclose(append_file);
+        append_file = nullptr;
+    }
+
+    unmap_file();
+#if defined(WIN32)
+    remove_file(filename);
+#endif
+    rename_file(temp_filename, filename);
+
+    uint64_t end = 0;
+    if (!read_index(end))
+        std::clog << "platform::recordfile: failed to read " << filename << std::endl;
+
+    open_append();
+}
+
+bool recordfile::read_index(uint64_t &end)
+{
+    index.clear();
+    wasted = 0;
+    end = 0;
+
+    if (!map_file() || (memcmp(map, magic, sizeof(magic)) != 0))
+    {
+        unmap_file();
+        return false;
+    }
+
+    file_version = get_u32(map + sizeof(magic));
+
+    // Only the record headers are read here, the data stays on disk until it
+    // is needed.
+    uint64_t pos = file_header_size;
+    while ((pos + record_header_size) <= map_size)
+    {
+        const uint32_t size = get_u32(map + pos);
+        if ((pos + record_header_size + size) > map_size)
+            break; // Incomplete record
+
+        struct uuid uuid;
+        memcpy(uuid.value, map + pos + 4, sizeof(uuid.value));
+
+        struct record &record = index[uuid];
+        if (record.mapped)
+            wasted += record_header_size + record.size;
+
+        record.mapped = true;
+        record.offset = pos + record_header_size;
+        record.size = size;
+
+        pos += record_header_size + size;
+    }
+
+    end = pos;
+    return true;
+}
+
+bool recordfile::open_append()
+{
+    append_file = open_file(filename, "ab");
+    return append_file != nullptr;
+}
+
+} // End of namespace
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace platform {
+
+static FILE * open_file(const std::string &filename, const char *mode)
+{
+    return fopen(filename.c_str(), mode);
+}
+
+bool recordfile::map_file()
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat stat;
+        if ((::fstat(fd, &stat) == 0) && (uint64_t(stat.st_size) >= file_header_size))
+        {
+            void * const data = ::mmap(nullptr, size_t(stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                map = reinterpret_cast<const uint8_t *>(data);
+                map_size = uint64_t(stat.st_size);
+            }
+        }
+
+        ::close(fd);
+    }
+
+    return map != nullptr;
+}
+
+void recordfile::unmap_file()
+{
+    if (map)
+        ::munmap(const_cast<uint8_t *>(map), size_t(map_size));
+
+    map = nullptr;
+    map_size = 0;
+}
+
+} // End of namespace
+
+#elif defined(WIN32)
+#include <windows.h>
+
+namespace platform {
+
+static FILE * open_file(const std::string &filename, const char *mode)
+{
+    return _wfopen(to_windows_path(filename).c_str(), to_windows_path(mode).c_str());
+}
+
+bool recordfile::map_file()
+{
+    file_handle = ::CreateFile(
+                to_windows_path(filename).c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                NULL,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                NULL);
+
+    if (file_handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        if (::GetFileSizeEx(file_handle, &size) && (uint64_t(size.QuadPart) >= file_header_size))
+        {
+            map_handle = ::CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (map_handle)
+            {
+                map = reinterpret_cast<const uint8_t *>(::MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0));
+                if (map)
+                    map_size = uint64_t(size.QuadPart);
+            }
+        }
+    }
+    else
+        file_handle = nullptr;
+
+    return map != nullptr;
+}
+
+void recordfile::unmap_file()
+{
+    if (map)
+        ::UnmapViewOfFile(map);
+
+    if (map_handle)
+        ::CloseHandle(map_handle);
+
+    if (file_handle)
+        ::CloseHandle(file_handle);
+
+    map_handle = file_handle = nullptr;
+    map = nullptr;
+    map_size = 0;
+}
+
+} // End of namespace
+#endif
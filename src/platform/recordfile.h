@@ -0,0 +1,79 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef PLATFORM_RECORDFILE_H
+#define PLATFORM_RECORDFILE_H
+
+#include "platform/uuid.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+namespace platform {
+
+/*! A binary store of records keyed by UUID. The file is memory mapped for
+    reading, new records are appended to it and the file is compacted when
+    more than half of it consists of overwritten records. The version is
+    stored in the file header and is not interpreted by recordfile.
+ */
+class recordfile
+{
+public:
+    explicit recordfile(const std::string &filename);
+    ~recordfile();
+
+    uint32_t version() const { return file_version; }
+    void clear(uint32_t version);
+
+    size_t size() const { return index.size(); }
+    bool empty() const { return index.empty(); }
+
+    bool has_record(const uuid &) const;
+    std::string read(const uuid &) const;
+    void write(const uuid &, const std::string &data);
+
+    void compact();
+
+private:
+    struct uuid_hash { size_t operator()(const uuid &) const; };
+    struct record { bool mapped; uint64_t offset; uint32_t size; std::string data; };
+
+    bool map_file();
+    bool read_index(uint64_t &end);
+    void unmap_file();
+    bool open_append();
+
+private:
+    const std::string filename;
+    uint32_t file_version;
+
+    std::unordered_map<uuid, record, uuid_hash> index;
+    uint64_t wasted;
+
+    const uint8_t *map;
+    uint64_t map_size;
+#if defined(WIN32)
+    void *file_handle, *map_handle;
+#endif
+
+    FILE *append_file;
+};
+
+} // End of namespace
+
+#endif
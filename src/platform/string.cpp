@@ -18,6 +18,7 @@
 #include "string.h"
 #include <algorithm>
 #include <climits>
+#include <cstdio>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
@@ -117,6 +118,59 @@ bool alphanum_less::operator()(const std::string &a_u8, const std::string &b_u8)
     return false;
 }
 
+std::string alphanum_key(const std::string &input_u8)
+{
+    auto input = to_utf32(input_u8);
+    if (input.empty()) // Not UTF-8
+        for (char c : input_u8)
+            input.push_back(char32_t(uint8_t(c)));
+
+    std::string result;
+    result.reserve(input.length() + 16);
+
+    for (size_t p = 0; p < input.length(); )
+    {
+        const char32_t c = input[p];
+        if (is_number(c))
+        {
+            // Numbers are zero-padded to a fixed width, as the first byte is
+            // always a digit they also sort against other characters like
+            // alphanum_less does.
+            char number[16];
+            snprintf(number, sizeof(number), "%010u", read_number(input, p));
+            result += number;
+        }
+        else
+        {
+            // UTF-8 preserves the order of the code points.
+            if (c < 0x80)
+                result.push_back(char(c));
+            else if (c < 0x800)
+            {
+                result.push_back(char(0xC0 | (c >> 6)));
+                result.push_back(char(0x80 | (c & 0x3F)));
+            }
+            else if (c < 0x10000)
+            {
+                result.push_back(char(0xE0 | (c >> 12)));
+                result.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+                result.push_back(char(0x80 | (c & 0x3F)));
+            }
+            else
+            {
+                result.push_back(char(0xF0 | ((c >> 18) & 0x07)));
+                result.push_back(char(0x80 | ((c >> 12) & 0x3F)));
+                result.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+                result.push_back(char(0x80 | (c & 0x3F)));
+            }
+
+            p++;
+        }
+    }
+
+    return result;
+}
+
 std::string from_base64(const std::string &input)
 {
     static const uint8_t table[256] =
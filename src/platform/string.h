@@ -28,6 +28,12 @@ std::string to_lower(const std::string &);
 
 struct alphanum_less { bool operator()(const std::string &, const std::string &) const; };
 
+/*! Returns a key that orders like alphanum_less when compared bytewise, so
+    it can be computed once per string and sorted with a plain std::string
+    comparison.
+ */
+std::string alphanum_key(const std::string &);
+
 std::string from_base64(const std::string &);
 std::string to_base64(const std::string &, bool pad = false);
 
@@ -0,0 +1,165 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "tempfile.h"
+#include "path.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace platform {
+
+tempfile::tempfile()
+    : fd(-1)
+{
+    const std::string path = temp_file_path("tmp");
+
+#if defined(O_TMPFILE)
+    const size_t sl = path.find_last_of('/');
+    if (sl != path.npos)
+        fd = ::open(path.substr(0, sl + 1).c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+#endif
+
+    if (fd < 0)
+    {
+        fd = ::open(path.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        if (fd >= 0)
+            ::unlink(path.c_str());
+    }
+}
+
+tempfile::~tempfile()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool tempfile::is_open() const
+{
+    return fd >= 0;
+}
+
+bool tempfile::write(uint64_t offset, const char *data, size_t size)
+{
+    while ((fd >= 0) && (size > 0))
+    {
+        const ssize_t result = ::pwrite(fd, data, size, off_t(offset));
+        if (result > 0)
+        {
+            offset += uint64_t(result);
+            data += result;
+            size -= size_t(result);
+        }
+        else if ((result < 0) && (errno == EINTR))
+            continue;
+        else
+            return false;
+    }
+
+    return size == 0;
+}
+
+bool tempfile::read(uint64_t offset, char *data, size_t size) const
+{
+    while ((fd >= 0) && (size > 0))
+    {
+        const ssize_t result = ::pread(fd, data, size, off_t(offset));
+        if (result > 0)
+        {
+            offset += uint64_t(result);
+            data += result;
+            size -= size_t(result);
+        }
+        else if ((result < 0) && (errno == EINTR))
+            continue;
+        else
+            return false;
+    }
+
+    return size == 0;
+}
+
+} // End of namespace
+
+#elif defined(WIN32)
+#include <windows.h>
+#include <cstring>
+
+namespace platform {
+
+tempfile::tempfile()
+    : handle(::CreateFile(
+                 to_windows_path(temp_file_path("tmp")).c_str(),
+                 GENERIC_READ | GENERIC_WRITE,
+                 0,
+                 NULL,
+                 CREATE_NEW,
+                 FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                 NULL))
+{
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        DWORD bytes = 0;
+        ::DeviceIoControl(handle, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytes, NULL);
+    }
+    else
+        handle = nullptr;
+}
+
+tempfile::~tempfile()
+{
+    if (handle)
+        ::CloseHandle(handle);
+}
+
+bool tempfile::is_open() const
+{
+    return handle != nullptr;
+}
+
+bool tempfile::write(uint64_t offset, const char *data, size_t size)
+{
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = DWORD(offset);
+    overlapped.OffsetHigh = DWORD(offset >> 32);
+
+    DWORD written = 0;
+    return
+            handle &&
+            ::WriteFile(handle, data, DWORD(size), &written, &overlapped) &&
+            (written == size);
+}
+
+bool tempfile::read(uint64_t offset, char *data, size_t size) const
+{
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = DWORD(offset);
+    overlapped.OffsetHigh = DWORD(offset >> 32);
+
+    DWORD read = 0;
+    return
+            handle &&
+            ::ReadFile(handle, data, DWORD(size), &read, &overlapped) &&
+            (read == size);
+}
+
+} // End of namespace
+#endif
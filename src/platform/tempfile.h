@@ -0,0 +1,55 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef PLATFORM_TEMPFILE_H
+#define PLATFORM_TEMPFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace platform {
+
+/*! An anonymous temporary file for positional reads and writes. The file is
+    removed when it is closed, on Linux it is created with O_TMPFILE and
+    never has a name. Unwritten ranges are left as holes where the file
+    system supports it.
+ */
+class tempfile
+{
+public:
+    tempfile();
+    tempfile(const tempfile &) = delete;
+    ~tempfile();
+
+    tempfile & operator=(const tempfile &) = delete;
+
+    bool is_open() const;
+
+    bool write(uint64_t offset, const char *data, size_t size);
+    bool read(uint64_t offset, char *data, size_t size) const;
+
+private:
+#if defined(WIN32)
+    void *handle;
+#else
+    int fd;
+#endif
+};
+
+} // End of namespace
+
+#endif
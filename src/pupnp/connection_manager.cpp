@@ -27,6 +27,8 @@ namespace pupnp {
 const char connection_manager::service_id[]   = "urn:upnp-org:serviceId:ConnectionManager";
 const char connection_manager::service_type[] = "urn:schemas-upnp-org:service:ConnectionManager:1";
 
+const size_t connection_manager::max_cached_protocols = 256;
+
 connection_manager::connection_manager(class platform::messageloop_ref &messageloop, class rootdevice &rootdevice)
     : messageloop(messageloop),
       rootdevice(rootdevice),
@@ -51,6 +53,9 @@ void connection_manager::add_source_audio_protocol(
               << name << " " << sample_rate << "/" << channels
               << std::endl;
 
+    std::lock_guard<std::mutex> _(protocols_mutex);
+
+    cached_protocols.clear();
     source_audio_protocol_list.emplace_back(protocol(
                                                 "http-get", mime,
                                                 true, false, false,
@@ -79,6 +84,9 @@ void connection_manager::add_source_video_protocol(
               << width << "x" << height << "@" << (float(frame_rate_num) / float(frame_rate_den))
               << std::endl;
 
+    std::lock_guard<std::mutex> _(protocols_mutex);
+
+    cached_protocols.clear();
     source_video_protocol_list.emplace_back(protocol(
                                                 "http-get", mime,
                                                 true, false, false,
@@ -106,6 +114,9 @@ void connection_manager::add_source_image_protocol(
               << name << " " << width << "x" << height
               << std::endl;
 
+    std::lock_guard<std::mutex> _(protocols_mutex);
+
+    cached_protocols.clear();
     source_image_protocol_list.emplace_back(protocol(
                                                 "http-get", mime,
                                                 true, false, false,
@@ -114,21 +125,81 @@ void connection_manager::add_source_image_protocol(
                                                 width, height));
 }
 
-std::vector<connection_manager::protocol> connection_manager::get_protocols(unsigned channels) const
+std::shared_ptr<const std::vector<connection_manager::protocol>> connection_manager::find_protocols(
+        const protocols_key &key,
+        const std::function<std::vector<protocol>()> &make) const
 {
-    std::map<int, std::vector<protocol>> protocols;
-    for (auto &protocol : source_audio_protocol_list)
+    std::lock_guard<std::mutex> _(protocols_mutex);
+
+    auto i = cached_protocols.find(key);
+    if (i != cached_protocols.end())
+        return i->second;
+
+    if (cached_protocols.size() >= max_cached_protocols)
+        cached_protocols.clear();
+
+    auto result = std::make_shared<const std::vector<protocol>>(make());
+    cached_protocols[key] = result;
+    return result;
+}
+
+std::shared_ptr<const std::vector<connection_manager::protocol>> connection_manager::get_protocols(unsigned channels) const
+{
+    return find_protocols(protocols_key('a', channels, 0, 0.0f), [this, channels]
     {
-        int score = 0;
-        score += ((protocol.channels > 2) == (channels > 2)) ? -2 : 0;
+        std::map<int, std::vector<protocol>> protocols;
+        for (auto &protocol : source_audio_protocol_list)
+        {
+            int score = 0;
+            score += ((protocol.channels > 2) == (channels > 2)) ? -2 : 0;
 
-        protocols[score].emplace_back(protocol);
-    }
+            protocols[score].emplace_back(protocol);
+        }
+
+        std::set<std::string> profiles;
+        std::vector<protocol> result;
+        for (auto &i : protocols)
+            if (result.empty() || (i.first <= 0))
+                for (auto &protocol : i.second)
+                    if (profiles.find(protocol.profile) == profiles.end())
+                    {
+                        profiles.insert(protocol.profile);
+                        result.emplace_back(std::move(protocol));
+                        result.back().channels = std::min(result.back().channels, channels);
+                    }
+
+        return result;
+    });
+}
 
-    std::set<std::string> profiles;
-    std::vector<protocol> result;
-    for (auto &i : protocols)
-        if (result.empty() || (i.first <= 0))
+std::shared_ptr<const std::vector<connection_manager::protocol>> connection_manager::get_protocols(unsigned channels, unsigned width, float frame_rate) const
+{
+    return find_protocols(protocols_key('v', channels, width, frame_rate), [this, channels, width, frame_rate]
+    {
+        std::map<int, std::vector<protocol>> protocols;
+        for (auto &protocol : source_video_protocol_list)
+        {
+            int score = 0;
+            score += ((protocol.channels > 2) == (channels > 2)) ? -2 : 0;
+
+            const unsigned pwidth = unsigned((protocol.width * protocol.aspect) + 0.5f);
+            score += ((pwidth > 1280) == (width > 1280)) ? -1 : 0;
+            score += ((pwidth >  876) == (width >  876)) ? -1 : 0;
+            score += ((pwidth >  640) == (width >  640)) ? -1 : 0;
+            score += ((pwidth >  352) == (width >  352)) ? -1 : 0;
+            score += ((pwidth <= 352) == (width <= 352)) ? -1 : 0;
+
+            const float rate = float(protocol.frame_rate_num) / float(protocol.frame_rate_den);
+            score += (std::fabs(rate - frame_rate) > 0.01f) ? 2 : 0;
+            score += (std::fabs(rate - frame_rate) > 0.3f) ? 4 : 0;
+            score += (std::fabs(rate - frame_rate) > 2.0f) ? 8 : 0;
+
+            protocols[score].emplace_back(protocol);
+        }
+
+        std::set<std::string> profiles;
+        std::vector<protocol> result;
+        for (auto &i : protocols)
             for (auto &protocol : i.second)
                 if (profiles.find(protocol.profile) == profiles.end())
                 {
@@ -137,82 +208,49 @@ std::vector<connection_manager::protocol> connection_manager::get_protocols(unsi
                     result.back().channels = std::min(result.back().channels, channels);
                 }
 
-    return std::move(result);
-}
-
-std::vector<connection_manager::protocol> connection_manager::get_protocols(unsigned channels, unsigned width, float frame_rate) const
-{
-    std::map<int, std::vector<protocol>> protocols;
-    for (auto &protocol : source_video_protocol_list)
-    {
-        int score = 0;
-        score += ((protocol.channels > 2) == (channels > 2)) ? -2 : 0;
-
-        const unsigned pwidth = unsigned((protocol.width * protocol.aspect) + 0.5f);
-        score += ((pwidth > 1280) == (width > 1280)) ? -1 : 0;
-        score += ((pwidth >  876) == (width >  876)) ? -1 : 0;
-        score += ((pwidth >  640) == (width >  640)) ? -1 : 0;
-        score += ((pwidth >  352) == (width >  352)) ? -1 : 0;
-        score += ((pwidth <= 352) == (width <= 352)) ? -1 : 0;
-
-        const float rate = float(protocol.frame_rate_num) / float(protocol.frame_rate_den);
-        score += (std::fabs(rate - frame_rate) > 0.01f) ? 2 : 0;
-        score += (std::fabs(rate - frame_rate) > 0.3f) ? 4 : 0;
-        score += (std::fabs(rate - frame_rate) > 2.0f) ? 8 : 0;
-
-        protocols[score].emplace_back(protocol);
-    }
-
-    std::set<std::string> profiles;
-    std::vector<protocol> result;
-    for (auto &i : protocols)
-        for (auto &protocol : i.second)
-            if (profiles.find(protocol.profile) == profiles.end())
-            {
-                profiles.insert(protocol.profile);
-                result.emplace_back(std::move(protocol));
-                result.back().channels = std::min(result.back().channels, channels);
-            }
-
-    return std::move(result);
+        return result;
+    });
 }
 
-std::vector<connection_manager::protocol> connection_manager::get_protocols(unsigned width, unsigned height) const
+std::shared_ptr<const std::vector<connection_manager::protocol>> connection_manager::get_protocols(unsigned width, unsigned height) const
 {
-    std::map<int, std::vector<protocol>> protocols;
-    for (auto &protocol : source_image_protocol_list)
+    return find_protocols(protocols_key('i', width, height, 0.0f), [this, width, height]
     {
-        int score = 0;
+        std::map<int, std::vector<protocol>> protocols;
+        for (auto &protocol : source_image_protocol_list)
+        {
+            int score = 0;
 
-        score += ((protocol.width > 1024) == (width > 1024)) ? -1 : 0;
-        score += ((protocol.width >  640) == (width >  640)) ? -1 : 0;
-        score += ((protocol.width >  160) == (width >  160)) ? -1 : 0;
-        score += ((protocol.width <= 160) == (width <= 160)) ? -1 : 0;
+            score += ((protocol.width > 1024) == (width > 1024)) ? -1 : 0;
+            score += ((protocol.width >  640) == (width >  640)) ? -1 : 0;
+            score += ((protocol.width >  160) == (width >  160)) ? -1 : 0;
+            score += ((protocol.width <= 160) == (width <= 160)) ? -1 : 0;
 
-        score += ((protocol.height >  768) == (height >  768)) ? -1 : 0;
-        score += ((protocol.height >  480) == (height >  480)) ? -1 : 0;
-        score += ((protocol.height >  160) == (height >  160)) ? -1 : 0;
-        score += ((protocol.height <= 160) == (height <= 160)) ? -1 : 0;
+            score += ((protocol.height >  768) == (height >  768)) ? -1 : 0;
+            score += ((protocol.height >  480) == (height >  480)) ? -1 : 0;
+            score += ((protocol.height >  160) == (height >  160)) ? -1 : 0;
+            score += ((protocol.height <= 160) == (height <= 160)) ? -1 : 0;
 
-        protocols[score].emplace_back(protocol);
-    }
+            protocols[score].emplace_back(protocol);
+        }
 
-    std::set<std::string> profiles;
-    std::vector<protocol> result;
-    for (auto &i : protocols)
-        for (auto &protocol : i.second)
-            if (profiles.find(protocol.profile) == profiles.end())
-            {
-                profiles.insert(protocol.profile);
-                result.emplace_back(std::move(protocol));
-            }
+        std::set<std::string> profiles;
+        std::vector<protocol> result;
+        for (auto &i : protocols)
+            for (auto &protocol : i.second)
+                if (profiles.find(protocol.profile) == profiles.end())
+                {
+                    profiles.insert(protocol.profile);
+                    result.emplace_back(std::move(protocol));
+                }
 
-    return std::move(result);
+        return result;
+    });
 }
 
 connection_manager::protocol connection_manager::get_protocol(const std::string &profile, unsigned num_channels) const
 {
-    for (auto &i : get_protocols(num_channels))
+    for (auto &i : *get_protocols(num_channels))
         if (i.profile == profile)
             return i;
 
@@ -221,7 +259,7 @@ connection_manager::protocol connection_manager::get_protocol(const std::string
 
 connection_manager::protocol connection_manager::get_protocol(const std::string &profile, unsigned num_channels, unsigned width, float frame_rate) const
 {
-    for (auto &i : get_protocols(num_channels, width, frame_rate))
+    for (auto &i : *get_protocols(num_channels, width, frame_rate))
         if (i.profile == profile)
             return i;
 
@@ -230,7 +268,7 @@ connection_manager::protocol connection_manager::get_protocol(const std::string
 
 connection_manager::protocol connection_manager::get_protocol(const std::string &profile, unsigned width, unsigned height) const
 {
-    for (auto &i : get_protocols(width, height))
+    for (auto &i : *get_protocols(width, height))
         if (i.profile == profile)
             return i;
 
@@ -315,6 +353,21 @@ void connection_manager::write_eventable_statevariables(rootdevice::eventable_pr
     propset.add_property("CurrentConnectionIDs", sp.empty() ? sp : sp.substr(1));
 }
 
+static uint64_t attach_key(const std::string &protocol_string, const std::string &mrl, const std::string &opt)
+{
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const std::string *i : { &protocol_string, &mrl, &opt })
+    {
+        for (char c : *i)
+            hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+
+        hash = (hash ^ 0xFF) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
 void connection_manager::add_output_connection(
         const std::shared_ptr<class connection_proxy> &connection_proxy,
         const struct protocol &protocol,
@@ -341,6 +394,7 @@ void connection_manager::add_output_connection(
 
     connections[id] = connection;
     connection_proxies[id] = connection_proxy;
+    connection_proxy_index.emplace(attach_key(connection.protocol_string, mrl, opt), id);
 
     connection_proxy->subscribe_close(messageloop, [this, id]
     {
@@ -349,12 +403,12 @@ void connection_manager::add_output_connection(
 
     connection_proxy->subscribe_detach(messageloop, [this, id]
     {
-        connection_proxies.erase(id);
+        remove_connection_proxy(id);
     });
 
     platform::timer::single_shot(messageloop, std::chrono::seconds(10), [this, id]
     {
-        connection_proxies.erase(id);
+        remove_connection_proxy(id);
     });
 
     messageloop.post([this] { rootdevice.emit_event(service_id); });
@@ -363,8 +417,22 @@ void connection_manager::add_output_connection(
 
 void connection_manager::remove_output_connection(int32_t id)
 {
-    connection_proxies.erase(id);
-    connections.erase(id);
+    remove_connection_proxy(id);
+
+    auto connection = connections.find(id);
+    if (connection != connections.end())
+    {
+        const auto &c = connection->second;
+        const auto range = connection_proxy_index.equal_range(attach_key(c.protocol_string, c.mrl, c.opt));
+        for (auto i = range.first; i != range.second; i++)
+            if (i->second == id)
+            {
+                connection_proxy_index.erase(i);
+                break;
+            }
+
+        connections.erase(connection);
+    }
 
     messageloop.post([this] { rootdevice.emit_event(service_id); });
     for (auto &j : numconnections_changed) if (j.second) j.second(connections.size());
@@ -378,26 +446,38 @@ std::shared_ptr<class connection_proxy> connection_manager::try_attach_output_co
 {
     const auto protocol_string = protocol.to_string();
 
-    for (auto &i : connection_proxies)
-    {
-        auto connection = connections.find(i.first);
-        if (connection != connections.end())
+    // Streams of the same endpoint first, as the renderer is most likely
+    // reconnecting, then a stream of another renderer that is still at its
+    // start or can be joined at a random access point.
+    const auto range = connection_proxy_index.equal_range(attach_key(protocol_string, mrl, opt));
+    for (bool same_endpoint : { true, false })
+        for (auto i = range.first; i != range.second; i++)
         {
-            if ((connection->second.protocol_string == protocol_string) &&
-                (connection->second.mrl == mrl) &&
-                (connection->second.endpoint == endpoint) &&
-                (connection->second.opt == opt))
+            auto connection = connections.find(i->second);
+            if (connection != connections.end())
             {
-                auto proxy = std::make_shared<class connection_proxy>();
-                if (proxy->attach(*i.second))
-                    return proxy;
+                auto connection_proxy = connection->second.connection_proxy.lock();
+                if (connection_proxy &&
+                    ((connection->second.endpoint == endpoint) == same_endpoint) &&
+                    (connection->second.protocol_string == protocol_string) &&
+                    (connection->second.mrl == mrl) &&
+                    (connection->second.opt == opt))
+                {
+                    auto proxy = std::make_shared<class connection_proxy>();
+                    if (proxy->attach(*connection_proxy))
+                        return proxy;
+                }
             }
         }
-    }
 
     return nullptr;
 }
 
+void connection_manager::remove_connection_proxy(int32_t id)
+{
+    connection_proxies.erase(id);
+}
+
 std::vector<connection_manager::connection_info> connection_manager::output_connections() const
 {
     std::vector<connection_info> result;
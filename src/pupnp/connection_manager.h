@@ -25,7 +25,10 @@
 #include <istream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 namespace pupnp {
@@ -165,9 +168,12 @@ public:
             const char *mime, const char *suffix,
             unsigned width, unsigned height);
 
-    std::vector<protocol> get_protocols(unsigned channels) const;
-    std::vector<protocol> get_protocols(unsigned channels, unsigned width, float frame_rate) const;
-    std::vector<protocol> get_protocols(unsigned width, unsigned height) const;
+    /*! Returns the protocols for an item of the specified shape, ordered by
+        how well they match. The lists are cached until a protocol is added.
+     */
+    std::shared_ptr<const std::vector<protocol>> get_protocols(unsigned channels) const;
+    std::shared_ptr<const std::vector<protocol>> get_protocols(unsigned channels, unsigned width, float frame_rate) const;
+    std::shared_ptr<const std::vector<protocol>> get_protocols(unsigned width, unsigned height) const;
     protocol get_protocol(const std::string &profile, unsigned num_channels) const;
     protocol get_protocol(const std::string &profile, unsigned num_channels, unsigned width, float frame_rate) const;
     protocol get_protocol(const std::string &profile, unsigned width, unsigned height) const;
@@ -203,7 +209,11 @@ private: // From rootdevice::service
     virtual void write_eventable_statevariables(rootdevice::eventable_propertyset &) const override final;
 
 private:
+    typedef std::tuple<char, unsigned, unsigned, float> protocols_key;
+    std::shared_ptr<const std::vector<protocol>> find_protocols(const protocols_key &, const std::function<std::vector<protocol>()> &) const;
+
     void remove_output_connection(int32_t);
+    void remove_connection_proxy(int32_t);
 
 private:
     class platform::messageloop_ref messageloop;
@@ -215,9 +225,17 @@ private:
 
     std::vector<protocol> sink_protocol_list;
 
+    static const size_t max_cached_protocols;
+    mutable std::mutex protocols_mutex;
+    mutable std::map<protocols_key, std::shared_ptr<const std::vector<protocol>>> cached_protocols;
+
     int32_t connection_id_counter;
     std::map<int32_t, connection_info> connections;
     std::map<int32_t, std::shared_ptr<class connection_proxy>> connection_proxies;
+
+    // Maps a hash of the protocol, MRL and options to the output connections,
+    // which can be attached to from any endpoint while their proxy is alive.
+    std::unordered_multimap<uint64_t, int32_t> connection_proxy_index;
 };
 
 } // End of namespace
@@ -16,9 +16,13 @@
  ******************************************************************************/
 
 #include "connection_proxy.h"
+#include "platform/tempfile.h"
+#include <atomic>
 #include <cassert>
 #include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <iostream>
 #include <memory>
 #include <mutex>
 #include <streambuf>
@@ -29,6 +33,8 @@ static const size_t block_size = 1048576;
 
 namespace pupnp {
 
+const size_t connection_proxy::default_max_memory = 64 * block_size;
+
 class connection_proxy::streambuf : public std::streambuf
 {
 friend class source;
@@ -42,14 +48,30 @@ public:
 private:
     class connection_proxy &parent;
 
-    size_t buffer_offset;
+    // Written by the reading thread, read by the consume thread to find out
+    // which part of the buffer can be reused.
+    std::atomic<size_t> buffer_offset;
     size_t buffer_available;
+
+    // The block the get area points into if the data rate is unknown.
+    std::shared_ptr<const std::vector<char>> block;
 };
 
+/*! The buffer is a ring with a single writer, the consume thread, and a
+    reader for each attached streambuf. buffer_end is only advanced by the
+    writer and buffer_offset only when the writer needs space, so readers
+    can pick up new data without taking the mutex. The mutex and condition
+    variables are only used to sleep, and are only signaled if someone
+    sleeps on them.
+
+    If the data rate is unknown the whole stream is kept instead, in blocks
+    that readers access with the mutex locked. Once more than max_memory is
+    used, the oldest blocks are moved to spill_file.
+ */
 class connection_proxy::source
 {
 public:
-    source(std::unique_ptr<std::istream> &&input, size_t data_rate);
+    source(std::unique_ptr<std::istream> &&input, size_t data_rate, const random_access_points_function &, size_t max_memory);
     ~source();
 
     bool attach(class streambuf &);
@@ -65,25 +87,41 @@ public:
 
 private:
     void consume();
+    void fill_ring();
+    void fill_blocks();
+    bool try_read(class streambuf &, size_t pos);
+    bool try_read_block(class streambuf &, size_t pos);
+    bool spill_block();
     void recompute_buffer_offset(std::unique_lock<std::mutex> &);
 
 private:
     const std::unique_ptr<std::istream> input;
     const size_t data_rate;
+    const random_access_points_function take_random_access_points;
 
     std::unique_ptr<std::thread> consume_thread;
     std::mutex mutex;
 
-    bool stream_end;
+    std::atomic<bool> stream_end;
     std::set<class streambuf *> streambufs;
 
     size_t preload_threshold;
     size_t detach_threshold;
     std::vector<char> buffer;
-    std::condition_variable buffer_condition;
-    size_t buffer_offset;
-    size_t buffer_used;
-
+    std::atomic<size_t> buffer_offset;
+    std::atomic<size_t> buffer_end;
+    std::deque<size_t> random_access_points;
+
+    size_t max_memory;
+    std::vector<std::shared_ptr<const std::vector<char>>> blocks;
+    size_t resident_blocks;
+    size_t spilled_blocks;
+    std::unique_ptr<platform::tempfile> spill_file;
+
+    std::condition_variable data_condition;
+    std::atomic<int> waiting_readers;
+    std::condition_variable space_condition;
+    std::atomic<bool> waiting_writer;
 };
 
 connection_proxy::connection_proxy()
@@ -94,9 +132,11 @@ connection_proxy::connection_proxy()
 
 connection_proxy::connection_proxy(
         std::unique_ptr<std::istream> &&input,
-        size_t data_rate)
+        size_t data_rate,
+        const random_access_points_function &random_access_points,
+        size_t max_memory)
     : std::istream(new class streambuf(*this)),
-      source(new class source(std::move(input), data_rate))
+      source(new class source(std::move(input), data_rate, random_access_points, max_memory))
 {
     source->attach(static_cast<class streambuf &>(*std::istream::rdbuf()));
 }
@@ -136,14 +176,22 @@ void connection_proxy::subscribe_detach(platform::messageloop_ref &messageloop_r
 
 connection_proxy::source::source(
         std::unique_ptr<std::istream> &&input,
-        size_t data_rate)
+        size_t data_rate,
+        const random_access_points_function &take_random_access_points,
+        size_t max_memory)
     : input(std::move(input)),
       data_rate(data_rate),
+      take_random_access_points(take_random_access_points),
       stream_end(false),
       preload_threshold(block_size),
       detach_threshold(block_size * 2),
       buffer_offset(0),
-      buffer_used(0)
+      buffer_end(0),
+      max_memory(max_memory),
+      resident_blocks(0),
+      spilled_blocks(0),
+      waiting_readers(0),
+      waiting_writer(false)
 {
     if (data_rate > 0)
     {
@@ -158,8 +206,6 @@ connection_proxy::source::source(
                           block_count * block_size,
                           detach_threshold + block_size));
     }
-    else
-        buffer.resize(block_size);
 
     consume_thread.reset(new std::thread(std::bind(
                                              &connection_proxy::source::consume,
@@ -172,7 +218,8 @@ connection_proxy::source::~source()
         std::lock_guard<std::mutex> _(mutex);
 
         stream_end = true;
-        buffer_condition.notify_all();
+        data_condition.notify_all();
+        space_condition.notify_all();
     }
 
     consume_thread->join();
@@ -189,81 +236,147 @@ bool connection_proxy::source::attach(class streambuf &streambuf)
         streambufs.insert(&streambuf);
         return true;
     }
+    else if (!random_access_points.empty())
+    {
+        // Points before buffer_offset have been removed, so the data is
+        // still there.
+        streambuf.buffer_offset = random_access_points.back();
+        streambuf.buffer_available = 0;
+        streambufs.insert(&streambuf);
+        return true;
+    }
 
     return false;
 }
 
 void connection_proxy::source::detach(class streambuf &streambuf)
 {
-    std::unique_lock<std::mutex> l(mutex);
+    std::lock_guard<std::mutex> _(mutex);
 
     streambufs.erase(&streambuf);
-    recompute_buffer_offset(l);
+    space_condition.notify_one();
 }
 
 void connection_proxy::source::consume()
 {
-    std::unique_lock<std::mutex> l(mutex);
+    if (data_rate != 0)
+        fill_ring();
+    else
+        fill_blocks();
 
+    std::lock_guard<std::mutex> _(mutex);
+
+    stream_end = true;
+    data_condition.notify_all();
+}
+
+void connection_proxy::source::fill_ring()
+{
     while (!stream_end && *input)
     {
+        const size_t end = buffer_end;
+
         // Wait for enough space to write a block.
-        char * write_block = nullptr;
-        size_t write_block_size = 0;
-        do
+        if (((end - buffer_offset) + block_size) > buffer.size())
         {
-            if ((buffer_used + block_size) <= buffer.size())
+            std::unique_lock<std::mutex> l(mutex);
+
+            for (waiting_writer = true; !stream_end; space_condition.wait(l))
             {
-                const size_t write_block_pos = (buffer_offset + buffer_used) % buffer.size();
-                write_block = &buffer[write_block_pos];
-                write_block_size = std::min(block_size, buffer.size() - write_block_pos);
+                recompute_buffer_offset(l);
+                if (((end - buffer_offset) + block_size) <= buffer.size())
+                    break;
             }
-            else if (data_rate == 0)
-                buffer.resize(buffer.size() + block_size);
-            else
-                buffer_condition.wait(l);
-        } while (!stream_end && !write_block);
 
-        if (!stream_end)
+            waiting_writer = false;
+            if (stream_end)
+                break;
+        }
+
+        const size_t write_block_pos = end % buffer.size();
+        const size_t write_block_size = std::min(block_size, buffer.size() - write_block_pos);
+        assert(write_block_size > 0);
+        input->read(&buffer[write_block_pos], write_block_size);
+
+        buffer_end = end + input->gcount();
+
+        if (take_random_access_points)
         {
-            l.unlock();
-            assert(write_block_size > 0);
-            input->read(write_block, write_block_size);
-            const size_t read = input->gcount();
-            l.lock();
-
-            buffer_used += read;
-            buffer_condition.notify_all();
+            const auto points = take_random_access_points();
+            if (!points.empty())
+            {
+                std::lock_guard<std::mutex> _(mutex);
+
+                random_access_points.insert(random_access_points.end(), points.begin(), points.end());
+            }
         }
-    }
 
-    stream_end = true;
-    buffer_condition.notify_all();
+        if (waiting_readers > 0)
+        {
+            std::lock_guard<std::mutex> _(mutex);
+
+            data_condition.notify_all();
+        }
+    }
 }
 
-bool connection_proxy::source::read(class streambuf &streambuf)
+void connection_proxy::source::fill_blocks()
 {
-    std::unique_lock<std::mutex> l(mutex);
+    while (!stream_end && *input)
+    {
+        std::shared_ptr<std::vector<char>> block = std::make_shared<std::vector<char>>(block_size);
+        input->read(block->data(), block->size());
+        block->resize(size_t(input->gcount()));
+        if (block->empty())
+            break;
 
-    streambuf.buffer_offset += streambuf.buffer_available;
-    streambuf.buffer_available = 0;
-    recompute_buffer_offset(l);
+        {
+            std::lock_guard<std::mutex> _(mutex);
 
-    while (!stream_end &&
-           (((buffer_offset + buffer_used) <= streambuf.buffer_offset) ||
-            ((buffer_offset == 0) && (buffer_used < preload_threshold))))
+            buffer_end = buffer_end + block->size();
+            blocks.emplace_back(std::move(block));
+            resident_blocks++;
+            data_condition.notify_all();
+        }
+
+        // The last block is kept in memory, so all spilled blocks are full.
+        while ((resident_blocks > 1) && ((resident_blocks * block_size) > max_memory))
+            if (!spill_block())
+                break;
+    }
+}
+
+bool connection_proxy::source::spill_block()
+{
+    if (!spill_file)
+        spill_file.reset(new platform::tempfile());
+
+    // Only this thread modifies blocks, so it can be read without the mutex.
+    const auto &block = blocks[spilled_blocks];
+    if (spill_file->write(uint64_t(spilled_blocks) * block_size, block->data(), block->size()))
     {
-        buffer_condition.wait(l);
+        std::lock_guard<std::mutex> _(mutex);
+
+        blocks[spilled_blocks++] = nullptr;
+        resident_blocks--;
+        return true;
     }
 
-    if ((buffer_offset + buffer_used) > streambuf.buffer_offset)
+    std::clog << "pupnp::connection_proxy: failed to write to temporary file, keeping the stream in memory." << std::endl;
+    max_memory = size_t(-1);
+    return false;
+}
+
+bool connection_proxy::source::try_read(class streambuf &streambuf, size_t pos)
+{
+    // stream_end is read first, buffer_end is final once it is set.
+    const bool end_of_stream = stream_end;
+    const size_t end = buffer_end;
+
+    if ((end > pos) && (end_of_stream || (buffer_offset > 0) || (end >= preload_threshold)))
     {
-        const size_t bpos = streambuf.buffer_offset % buffer.size();
-        const size_t size = std::min(
-                    std::min(
-                        buffer.size() - bpos,
-                        (buffer_offset + buffer_used) - streambuf.buffer_offset),
-                    block_size);
+        const size_t bpos = pos % buffer.size();
+        const size_t size = std::min(std::min(buffer.size() - bpos, end - pos), block_size);
 
         streambuf.setg(&buffer[bpos], &buffer[bpos], &buffer[bpos] + size);
         streambuf.buffer_available = size;
@@ -271,6 +384,82 @@ bool connection_proxy::source::read(class streambuf &streambuf)
         return true;
     }
 
+    return false;
+}
+
+bool connection_proxy::source::try_read_block(class streambuf &streambuf, size_t pos)
+{
+    if (buffer_end > pos)
+    {
+        const size_t index = pos / block_size;
+        std::shared_ptr<const std::vector<char>> block = blocks[index];
+        if (!block)
+        {
+            std::shared_ptr<std::vector<char>> spilled = std::make_shared<std::vector<char>>(block_size);
+            if (!spill_file->read(uint64_t(index) * block_size, spilled->data(), spilled->size()))
+            {
+                std::clog << "pupnp::connection_proxy: failed to read from temporary file." << std::endl;
+                return false;
+            }
+
+            block = std::move(spilled);
+        }
+
+        const size_t offset = pos % block_size;
+        char * const data = const_cast<char *>(block->data());
+
+        streambuf.block = std::move(block);
+        streambuf.setg(data + offset, data + offset, data + streambuf.block->size());
+        streambuf.buffer_available = streambuf.block->size() - offset;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool connection_proxy::source::read(class streambuf &streambuf)
+{
+    const size_t pos = streambuf.buffer_offset + streambuf.buffer_available;
+    streambuf.buffer_offset = pos;
+    streambuf.buffer_available = 0;
+
+    if (waiting_writer)
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        space_condition.notify_one();
+    }
+
+    // The blocks used if the data rate is unknown have to be accessed with
+    // the mutex locked.
+    if ((data_rate != 0) && try_read(streambuf, pos))
+        return true;
+
+    std::unique_lock<std::mutex> l(mutex);
+
+    const auto read_available = [this, &streambuf, pos]
+    {
+        return (data_rate != 0)
+                ? try_read(streambuf, pos)
+                : try_read_block(streambuf, pos);
+    };
+
+    for (;;)
+    {
+        waiting_readers++;
+        const bool result = read_available();
+        if (!result && !stream_end)
+            data_condition.wait(l);
+
+        waiting_readers--;
+
+        if (result)
+            return true;
+        else if (stream_end && !read_available())
+            break;
+    }
+
     for (auto &i : on_detach) i.first->post(i.second);
     on_detach.clear();
 
@@ -281,8 +470,23 @@ bool connection_proxy::source::seek(class streambuf &streambuf, size_t pos)
 {
     std::unique_lock<std::mutex> l(mutex);
 
+    if (data_rate == 0)
+    {
+        if (pos <= buffer_end)
+        {
+            streambuf.buffer_offset = pos;
+            streambuf.buffer_available = 0;
+            streambuf.block = nullptr;
+            streambuf.setg(nullptr, nullptr, nullptr);
+
+            return (pos == buffer_end) || try_read_block(streambuf, pos);
+        }
+
+        return false;
+    }
+
     const size_t apos = pos & ~(block_size - 1);
-    if ((apos >= buffer_offset) && (pos <= buffer_offset + buffer_used))
+    if ((apos >= buffer_offset) && (pos <= buffer_end))
     {
         streambuf.buffer_offset = apos;
         streambuf.buffer_available = 0;
@@ -291,7 +495,7 @@ bool connection_proxy::source::seek(class streambuf &streambuf, size_t pos)
         const size_t size = std::min(
                     std::min(
                         buffer.size() - bpos,
-                        (buffer_offset + buffer_used) - streambuf.buffer_offset),
+                        buffer_end - apos),
                     block_size);
 
         streambuf.setg(&buffer[bpos], &buffer[bpos] + pos - apos, &buffer[bpos] + size);
@@ -309,9 +513,9 @@ size_t connection_proxy::source::size()
     {
         std::unique_lock<std::mutex> l(mutex);
         while (!stream_end)
-            buffer_condition.wait(l);
+            data_condition.wait(l);
 
-        return buffer_offset + buffer_used;
+        return buffer_end;
     }
 
     return 0;
@@ -323,7 +527,7 @@ void connection_proxy::source::recompute_buffer_offset(std::unique_lock<std::mut
     {
         size_t new_offset = size_t(-1);
         for (auto &i : streambufs)
-            new_offset = std::min(new_offset, i->buffer_offset);
+            new_offset = std::min(new_offset, size_t(i->buffer_offset));
 
         if ((new_offset != size_t(-1)) && (new_offset >= (buffer_offset + block_size)) &&
             ((buffer_offset > 0) || (new_offset >= detach_threshold)))
@@ -336,8 +540,9 @@ void connection_proxy::source::recompute_buffer_offset(std::unique_lock<std::mut
 
             const size_t proceed = (new_offset - buffer_offset) & ~(block_size - 1);
             buffer_offset += proceed;
-            buffer_used -= proceed;
-            buffer_condition.notify_all();
+
+            while (!random_access_points.empty() && (random_access_points.front() < buffer_offset))
+                random_access_points.pop_front();
         }
     }
 }
@@ -19,20 +19,42 @@
 #define PUPNP_CONNECTION_PROXY_H
 
 #include "platform/messageloop.h"
+#include <functional>
 #include <istream>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace pupnp {
 
 class connection_proxy : public std::istream
 {
 public:
+    /*! Returns the offsets in the input stream where a decoder can start
+        that became known since the previous call, in increasing order. It
+        is invoked on the thread reading the input.
+     */
+    typedef std::function<std::vector<size_t>()> random_access_points_function;
+
+    static const size_t default_max_memory;
+
     connection_proxy();
-    connection_proxy(std::unique_ptr<std::istream> &&input, size_t data_rate);
+
+    /*! If data_rate is 0, the whole stream is kept so it can be seeked in.
+        Once more than max_memory is buffered, the oldest data is moved to
+        a temporary file. Otherwise the last 30 seconds are kept in memory.
+     */
+    connection_proxy(
+            std::unique_ptr<std::istream> &&input, size_t data_rate,
+            const random_access_points_function & = nullptr,
+            size_t max_memory = default_max_memory);
 
     ~connection_proxy();
 
+    /*! Attaches to the stream of another connection_proxy. If the start of
+        the stream is no longer buffered, the stream is joined at the most
+        recent buffered random access point, if any.
+     */
     bool attach(connection_proxy &);
 
     void subscribe_close(platform::messageloop_ref &, const std::function<void()> &);
@@ -28,8 +28,9 @@ namespace pupnp {
 
 const char content_directory::service_id[]   = "urn:upnp-org:serviceId:ContentDirectory";
 const char content_directory::service_type[] = "urn:schemas-upnp-org:service:ContentDirectory:1";
+const char content_directory::sort_capabilities[] = "dc:title,dc:date,res@duration,upnp:originalTrackNumber";
 
-content_directory::content_directory(class platform::messageloop_ref &messageloop, class upnp &upnp, class rootdevice &rootdevice, class connection_manager &connection_manager)
+content_directory::content_directory(class platform::messageloop_ref &messageloop, class upnp &upnp, class rootdevice &rootdevice, class connection_manager &connection_manager, class platform::inifile &objectids_file)
     : messageloop(messageloop),
       upnp(upnp),
       rootdevice(rootdevice),
@@ -39,6 +40,11 @@ content_directory::content_directory(class platform::messageloop_ref &messageloo
       update_timer_interval(2),
       system_update_id(0),
       allow_process_pending_updates(true),
+      response_cache_size(256),
+      response_cache_hits(0),
+      response_cache_misses(0),
+      response_cache_generation(0),
+      objectids(objectids_file),
       root_item_source(*this)
 {
     using namespace std::placeholders;
@@ -46,9 +52,6 @@ content_directory::content_directory(class platform::messageloop_ref &messageloo
     // Add the root path.
     item_sources["/"] = &root_item_source;
 
-    objectid_list.push_back(std::string());
-    objectid_map[objectid_list.back()] = objectid_list.size() - 1;
-
     connection_manager.numconnections_changed[this] = std::bind(&content_directory::num_connections_changed, this, _1);
 
     rootdevice.service_register(service_id, *this);
@@ -65,28 +68,77 @@ content_directory::~content_directory()
 
 void content_directory::item_source_register(const std::string &path, struct item_source &item_source)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     item_sources[path] = &item_source;
     item_source_order.push_back(path);
 }
 
 void content_directory::item_source_unregister(const std::string &path)
 {
-    item_sources.erase(path);
+    std::unique_lock<std::recursive_mutex> l(mutex);
 
     auto i = std::find(item_source_order.begin(), item_source_order.end(), path);
     if (i != item_source_order.end())
         item_source_order.erase(i);
+
+    auto item_source = item_sources.find(path);
+    if (item_source != item_sources.end())
+    {
+        const auto source = item_source->second;
+        item_sources.erase(item_source);
+
+        // Wait for Browse and Search requests still using the item source,
+        // the messageloop is processed as they may be waiting for it.
+        while (item_source_uses.find(source) != item_source_uses.end())
+        {
+            l.unlock();
+            messageloop.process_events(std::chrono::milliseconds(16));
+            l.lock();
+        }
+    }
+}
+
+std::shared_ptr<content_directory::item_source> content_directory::use_item_source(struct item_source *item_source)
+{
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
+    item_source_uses[item_source]++;
+    return std::shared_ptr<struct item_source>(item_source, [this](struct item_source *item_source)
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        auto i = item_source_uses.find(item_source);
+        if (--(i->second) == 0)
+            item_source_uses.erase(i);
+    });
 }
 
 void content_directory::update_system()
 {
-    system_update_id++;
-    if (allow_process_pending_updates)
-        update_timer.start(update_timer_interval, true);
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        system_update_id++;
+    }
+
+    // Browse may be handled on another thread, the timer is started on the
+    // messageloop.
+    messageloop.post([this]
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        if (allow_process_pending_updates)
+            update_timer.start(update_timer_interval, true);
+    });
 }
 
 void content_directory::update_path(const std::string &path)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
+    flush_cache(path);
+
     const std::string objectid = to_objectid(path, false);
     if (!objectid.empty() && (objectid != "0") && (objectid != "-1"))
     {
@@ -100,8 +152,25 @@ void content_directory::update_path(const std::string &path)
     }
 }
 
+void content_directory::flush_cache(const std::string &path)
+{
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
+    response_cache_generation++;
+    for (auto i = response_cache.begin(); i != response_cache.end(); )
+        if (starts_with(i->second.path, path))
+        {
+            response_cache_index.erase(i->first);
+            i = response_cache.erase(i);
+        }
+        else
+            i++;
+}
+
 void content_directory::num_connections_changed(int num_connections)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     allow_process_pending_updates = num_connections == 0;
     if (allow_process_pending_updates)
         update_timer.start(update_timer_interval, true);
@@ -109,6 +178,8 @@ void content_directory::num_connections_changed(int num_connections)
 
 void content_directory::process_pending_updates(void)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     if (allow_process_pending_updates)
     {
         updated_container_update_ids = std::move(pending_container_updates);
@@ -268,6 +339,37 @@ static content_directory::item make_play_item(const content_directory::item &bas
     return item;
 }
 
+static std::vector<content_directory::sort_criterion> parse_sort_criteria(const std::string &text)
+{
+    std::vector<content_directory::sort_criterion> result;
+
+    std::stringstream str(text);
+    std::string field;
+    while (std::getline(str, field, ','))
+    {
+        size_t begin = field.find_first_not_of(" \t");
+        const size_t end = field.find_last_not_of(" \t");
+        if ((begin == field.npos) || (end == field.npos))
+            continue;
+
+        content_directory::sort_criterion criterion;
+        criterion.ascending = field[begin] != '-';
+        if ((field[begin] == '+') || (field[begin] == '-'))
+            begin++;
+
+        const auto property = field.substr(begin, end - begin + 1);
+        if      (property == "dc:title"                 ) criterion.property = content_directory::sort_property::title;
+        else if (property == "dc:date"                  ) criterion.property = content_directory::sort_property::date;
+        else if (property == "res@duration"             ) criterion.property = content_directory::sort_property::duration;
+        else if (property == "upnp:originalTrackNumber" ) criterion.property = content_directory::sort_property::track;
+        else                                              continue;
+
+        result.push_back(criterion);
+    }
+
+    return result;
+}
+
 void content_directory::handle_action(const upnp::request &request, action_browse &action)
 {
     const auto objectid = action.get_object_id();
@@ -281,19 +383,128 @@ void content_directory::handle_action(const upnp::request &request, action_brows
 
     auto path = from_objectid(objectid);
 
-    const std::string basepath = content_directory::basepath(path);
-    auto item_source = item_sources.find(basepath);
-    for (std::string i=basepath; !i.empty() && (item_source == item_sources.end()); i = parentpath(i))
-        item_source = item_sources.find(i);
+    std::shared_ptr<struct item_source> source;
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        const std::string basepath = content_directory::basepath(path);
+        auto item_source = item_sources.find(basepath);
+        for (std::string i=basepath; !i.empty() && (item_source == item_sources.end()); i = parentpath(i))
+            item_source = item_sources.find(i);
+
+        if ((item_source == item_sources.end()) || !starts_with(path, item_source->first))
+        {
+            std::clog << "pupnp::content_directory: could not find item source for path: " << std::endl;
+            return;
+        }
+
+        source = use_item_source(item_source->second);
+    }
+
+    // Renderers repeat the same Browse each time a folder is entered, so
+    // responses are kept until update_path() is called for the path.
+    std::string cache_key;
+    uint64_t cache_generation = 0;
+    if (source->cache_contentdir_items(path))
+    {
+        std::ostringstream str;
+        str << objectid << '\n' << int(action.get_browse_flag()) << '\n' << start << '\n' << count
+            << '\n' << action.get_filter() << '\n' << action.get_sort_criteria()
+            << '\n' << client << '\n' << request.url.host;
+
+        cache_key = str.str();
+
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        auto i = response_cache_index.find(cache_key);
+        if (i != response_cache_index.end())
+        {
+            response_cache_hits++;
+            response_cache.splice(response_cache.begin(), response_cache, i->second);
+
+            const auto &response = i->second->second;
+            return action.set_response(response.result, response.number_returned, response.totalmatches, response.update_id);
+        }
+
+        response_cache_misses++;
+        cache_generation = response_cache_generation;
+    }
+
+    size_t totalmatches = 0;
+    call_item_source(*source, [&]
+    {
+        totalmatches = browse(request, action, *source, client, path);
+    });
 
-    if ((item_source == item_sources.end()) || !starts_with(path, item_source->first))
+    uint32_t updateid;
     {
-        std::clog << "pupnp::content_directory: could not find item source for path: " << std::endl;
-        return;
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        updateid = system_update_id;
+        if (objectid != "0")
+        {
+            auto container_update_id = container_update_ids.find(objectid);
+            if (container_update_id != container_update_ids.end())
+            {
+                if ((start == 0) && (totalmatches != container_update_id->second.totalmatches))
+                {
+                    updateid = ++(container_update_id->second.id);
+                    container_update_id->second.totalmatches = totalmatches;
+                    pending_container_updates.insert(objectid);
+                    update_system();
+                    flush_cache(path);
+                }
+                else
+                    updateid = container_update_id->second.id;
+            }
+            else
+                container_update_ids[objectid] = update_id { updateid, totalmatches };
+        }
     }
 
+    action.set_response(totalmatches, updateid);
+
+    if (!cache_key.empty())
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        // Not cached if the cache was flushed while browsing, as the result
+        // may be stale.
+        if (cache_generation != response_cache_generation)
+            return;
+
+        response_cache.emplace_front(
+                    cache_key,
+                    cached_response { path, action.get_result(), action.get_number_returned(), totalmatches, updateid });
+
+        auto i = response_cache_index.find(cache_key);
+        if (i != response_cache_index.end())
+            response_cache.erase(i->second);
+
+        response_cache_index[cache_key] = response_cache.begin();
+        while (response_cache.size() > response_cache_size)
+        {
+            response_cache_index.erase(response_cache.back().first);
+            response_cache.pop_back();
+        }
+    }
+}
+
+void content_directory::call_item_source(struct item_source &item_source, const std::function<void()> &func)
+{
+    if (item_source.concurrent_contentdir_items())
+        func();
+    else
+        messageloop.send(func);
+}
+
+size_t content_directory::browse(const upnp::request &request, action_browse &action, struct item_source &item_source, const std::string &client, std::string &path)
+{
+    const auto start = action.get_starting_index();
+    const auto count = action.get_requested_count();
+
     auto itemprops = split_item_props(path);
-    const item item = item_source->second->get_contentdir_item(client, itemprops[0]);
+    const item item = item_source.get_contentdir_item(client, itemprops[0]);
     if (starts_with(item.path, path))
         itemprops[0] = path = item.path;
 
@@ -305,7 +516,8 @@ void content_directory::handle_action(const upnp::request &request, action_brows
         {
         case action_browse::browse_flag::direct_children:
             totalmatches = count;
-            for (auto &item : item_source->second->list_contentdir_items(client, path, start, totalmatches))
+            for (auto &item : item_source.list_sorted_contentdir_items(
+                     client, path, parse_sort_criteria(action.get_sort_criteria()), start, totalmatches))
             {
                 std::string title = item.title;
                 if (item.duration.count() > 0)
@@ -325,17 +537,17 @@ void content_directory::handle_action(const upnp::request &request, action_brows
                     case item_type::music_video:
                     case item_type::image:
                     case item_type::photo:
-                        add_file(action, request.url.host, *item_source->second, item, item.path, item.title);
+                        add_file(action, request.url.host, item_source, item, item.path, item.title);
                         break;
 
                     case item_type::audio_broadcast:
                     case item_type::video_broadcast:
-                        add_file(action, request.url.host, *item_source->second, item, item.path, title);
+                        add_file(action, request.url.host, item_source, item, item.path, title);
                         break;
 
                     case item_type::audio:
                     case item_type::video:
-                        add_file(action, request.url.host, *item_source->second, item, item.path, title);
+                        add_file(action, request.url.host, item_source, item, item.path, title);
                         break;
 
                     case item_type::audio_book:
@@ -366,7 +578,7 @@ void content_directory::handle_action(const upnp::request &request, action_brows
             {
                 const auto props = split_item_props(path + "///" + items[i]);
                 if (props[1] == "p")
-                    add_file(action, request.url.host, *item_source->second, make_play_item(item, props), path + "///" + items[i]);
+                    add_file(action, request.url.host, item_source, make_play_item(item, props), path + "///" + items[i]);
                 else
                     add_container(action, item.type, path + "///" + items[i], props[3]);
             }
@@ -376,7 +588,7 @@ void content_directory::handle_action(const upnp::request &request, action_brows
 
         case action_browse::browse_flag::metadata:
             if (itemprops[1].empty() || (itemprops[1] == "p"))
-                add_file(action, request.url.host, *item_source->second, make_play_item(item, itemprops), path);
+                add_file(action, request.url.host, item_source, make_play_item(item, itemprops), path);
             else
                 add_container(action, item.type, path, itemprops[3]);
 
@@ -387,47 +599,97 @@ void content_directory::handle_action(const upnp::request &request, action_brows
     else
         std::clog << "pupnp::content_directory: could not find item " << itemprops[0] << std::endl;
 
-    auto updateid = system_update_id;
-    if (objectid != "0")
+    return totalmatches;
+}
+
+void content_directory::handle_action(const upnp::request &request, action_search &action)
+{
+    const auto start = action.get_starting_index();
+    const auto count = action.get_requested_count();
+
+    std::string client = request.user_agent;
+    const size_t space = request.user_agent.find_first_of(' ');
+    if (space != request.user_agent.npos)
+        client = client.substr(0, space);
+
+    search_criteria criteria;
+    if (!criteria.parse(action.get_search_criteria()))
     {
-        auto container_update_id = container_update_ids.find(objectid);
-        if (container_update_id != container_update_ids.end())
+        std::clog << "pupnp::content_directory: could not parse search criteria: " << action.get_search_criteria() << std::endl;
+        return action.set_response(0, get_system_update_id());
+    }
+
+    const auto path = from_objectid(action.get_container_id());
+    if (path.empty() || (path[path.length() - 1] != '/'))
+        return action.set_response(0, get_system_update_id());
+
+    std::vector<std::shared_ptr<struct item_source>> sources;
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        for (auto &i : item_source_order)
         {
-            if ((start == 0) && (totalmatches != container_update_id->second.totalmatches))
+            const auto item_source = item_sources.find(i);
+            if ((item_source != item_sources.end()) &&
+                (starts_with(item_source->first, path) || starts_with(path, item_source->first)))
             {
-                updateid = ++(container_update_id->second.id);
-                container_update_id->second.totalmatches = totalmatches;
-                pending_container_updates.insert(objectid);
-                update_system();
+                sources.push_back(use_item_source(item_source->second));
             }
-            else
-                updateid = container_update_id->second.id;
         }
-        else
-            container_update_ids[objectid] = update_id { updateid, totalmatches };
     }
 
-    action.set_response(totalmatches, updateid);
+    size_t totalmatches = 0, skip = start, remaining = count;
+    for (auto &item_source : sources)
+    {
+        call_item_source(*item_source, [&]
+        {
+            // Once the requested items are complete, the item sources are
+            // only asked for their number of matches.
+            const bool complete = (count > 0) && (remaining == 0);
+            size_t matches = complete ? 1 : remaining;
+            const auto items = item_source->search_contentdir_items(
+                        client, path, criteria, complete ? size_t(-1) : skip, matches);
+
+            for (auto &item : items)
+                if (!item.mrl.empty() && ((count == 0) || (remaining > 0)))
+                {
+                    action.add_item(make_browse_item(
+                                        request.url.host, *item_source,
+                                        make_play_item(item, split_item_props(item.path)),
+                                        item.path));
+
+                    if (count > 0)
+                        remaining--;
+                }
+
+            totalmatches += matches;
+            skip -= std::min(skip, matches);
+        });
+    }
+
+    action.set_response(totalmatches, get_system_update_id());
 }
 
-void content_directory::handle_action(const upnp::request &, action_search &action)
+uint32_t content_directory::get_system_update_id() const
 {
-    action.set_response(0, system_update_id);
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
+    return system_update_id;
 }
 
 void content_directory::handle_action(const upnp::request &, action_get_search_capabilities &action)
 {
-    action.set_response(std::string());
+    action.set_response(search_index::capabilities);
 }
 
 void content_directory::handle_action(const upnp::request &, action_get_sort_capabilities &action)
 {
-    action.set_response(std::string());
+    action.set_response(sort_capabilities);
 }
 
 void content_directory::handle_action(const upnp::request &, action_get_system_update_id &action)
 {
-    action.set_response(system_update_id);
+    action.set_response(get_system_update_id());
 }
 
 void content_directory::handle_action(const upnp::request &, action_get_featurelist &action)
@@ -449,11 +711,15 @@ void content_directory::initialize(void)
 {
     using namespace std::placeholders;
 
-    uint32_t updateid = uint32_t(::time(nullptr));
-    if (updateid == system_update_id)
-        updateid++;
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        uint32_t updateid = uint32_t(::time(nullptr));
+        if (updateid == system_update_id)
+            updateid++;
 
-    system_update_id = updateid;
+        system_update_id = updateid;
+    }
 
     upnp.http_callback_register(basedir, std::bind(&content_directory::http_request, this, _1, _2, _3));
 }
@@ -463,17 +729,23 @@ void content_directory::close(void)
     upnp.http_callback_unregister(basedir);
 
     update_timer.stop();
+
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     pending_container_updates.clear();
     updated_container_update_ids.clear();
     container_update_ids.clear();
 
-    objectid_list.clear();
-    objectid_map.clear();
-    object_uuid_to_path.clear();
-    object_path_to_uuid.clear();
+    if ((response_cache_hits + response_cache_misses) > 0)
+    {
+        std::clog << "pupnp::content_directory: Browse response cache " << response_cache_hits
+                  << " hits, " << response_cache_misses << " misses." << std::endl;
+    }
+
+    response_cache.clear();
+    response_cache_index.clear();
 
-    objectid_list.push_back(std::string());
-    objectid_map[objectid_list.back()] = objectid_list.size() - 1;
+    // The object IDs are kept, so that renderers can continue to use them.
 }
 
 void content_directory::write_service_description(rootdevice::service_description &desc) const
@@ -535,6 +807,8 @@ void content_directory::write_service_description(rootdevice::service_descriptio
 
 void content_directory::write_eventable_statevariables(rootdevice::eventable_propertyset &propset) const
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     propset.add_property("SystemUpdateID", std::to_string(system_update_id));
 
     std::string update_ids;
@@ -562,22 +836,29 @@ int content_directory::http_request(const upnp::request &request, std::string &c
             const std::string profile = combined_path.substr(0, colon);
             const std::string path = combined_path.substr(colon + 1);
 
-            auto item_source = item_sources.find(path);
-            for (std::string i=path; !i.empty() && (item_source == item_sources.end()); i=parentpath(i))
-                item_source = item_sources.find(i);
-
-            if ((item_source == item_sources.end()) || !starts_with(path, item_source->first))
+            struct item_source *source;
             {
-                std::clog << "pupnp::content_directory: could not find item source for path: " << std::endl;
-                return upnp::http_not_found;
+                std::lock_guard<std::recursive_mutex> _(mutex);
+
+                auto item_source = item_sources.find(path);
+                for (std::string i=path; !i.empty() && (item_source == item_sources.end()); i=parentpath(i))
+                    item_source = item_sources.find(i);
+
+                if ((item_source == item_sources.end()) || !starts_with(path, item_source->first))
+                {
+                    std::clog << "pupnp::content_directory: could not find item source for path: " << std::endl;
+                    return upnp::http_not_found;
+                }
+
+                source = item_source->second;
             }
 
             const auto props = split_item_props(path);
-            auto item = item_source->second->get_contentdir_item(request.user_agent, props[0]);
+            auto item = source->get_contentdir_item(request.user_agent, props[0]);
             if (props[1] == "p")
                 item = make_play_item(item, props);
 
-            return item_source->second->play_item(request.source_address, item, profile, content_type, response);
+            return source->play_item(request.source_address, item, profile, content_type, response);
         }
     }
 
@@ -586,14 +867,18 @@ int content_directory::http_request(const upnp::request &request, std::string &c
 
 void content_directory::add_directory(action_browse &action, item_type type, const std::string &, const std::string &path, const std::string &title)
 {
-    auto item_source = item_sources.find(path);
-    for (std::string i=path; !i.empty() && (item_source == item_sources.end()); i=parentpath(i))
-        item_source = item_sources.find(i);
-
-    if ((item_source == item_sources.end()) || !starts_with(path, item_source->first))
     {
-        std::clog << "pupnp::content_directory: could not find item source for path: " << std::endl;
-        return;
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        auto item_source = item_sources.find(path);
+        for (std::string i=path; !i.empty() && (item_source == item_sources.end()); i=parentpath(i))
+            item_source = item_sources.find(i);
+
+        if ((item_source == item_sources.end()) || !starts_with(path, item_source->first))
+        {
+            std::clog << "pupnp::content_directory: could not find item source for path: " << std::endl;
+            return;
+        }
     }
 
     add_container(action, type, path, title);
@@ -602,8 +887,12 @@ void content_directory::add_directory(action_browse &action, item_type type, con
 void content_directory::add_container(action_browse &action, item_type type, const std::string &path, const std::string &title)
 {
     auto parentpath = content_directory::parentpath(path);
-    while ((parentpath.length() > 1) && (objectid_map.find(parentpath) == objectid_map.end()))
-        parentpath = content_directory::parentpath(parentpath);
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        while ((parentpath.length() > 1) && (objectids.to_id(parentpath, false) == 0))
+            parentpath = content_directory::parentpath(parentpath);
+    }
 
     browse_container container;
     container.id = to_objectid(path);
@@ -639,10 +928,19 @@ void content_directory::add_container(action_browse &action, item_type type, con
 }
 
 void content_directory::add_file(action_browse &action, const std::string &host, struct item_source &item_source, const item &item, const std::string &path, const std::string &title)
+{
+    action.add_item(make_browse_item(host, item_source, item, path, title));
+}
+
+content_directory::browse_item content_directory::make_browse_item(const std::string &host, struct item_source &item_source, const item &item, const std::string &path, const std::string &title)
 {
     auto parentpath = content_directory::parentpath(path);
-    while ((parentpath.length() > 1) && (objectid_map.find(parentpath) == objectid_map.end()))
-        parentpath = content_directory::parentpath(parentpath);
+    {
+        std::lock_guard<std::recursive_mutex> _(mutex);
+
+        while ((parentpath.length() > 1) && (objectids.to_id(parentpath, false) == 0))
+            parentpath = content_directory::parentpath(parentpath);
+    }
 
     struct browse_item browse_item;
     browse_item.id = to_objectid(path);
@@ -685,22 +983,22 @@ void content_directory::add_file(action_browse &action, const std::string &host,
 
     if (!item.mrl.empty())
     {
-        std::vector<connection_manager::protocol> protocols;
+        std::shared_ptr<const std::vector<connection_manager::protocol>> protocols;
         if (item.is_audio())  protocols = connection_manager.get_protocols(item.channels);
         if (item.is_video())  protocols = connection_manager.get_protocols(item.channels, item.width, item.frame_rate);
         if (item.is_image())  protocols = connection_manager.get_protocols(item.width, item.height);
 
-        for (auto protocol : protocols)
+        if (protocols) for (auto protocol : *protocols)
             if (item_source.correct_protocol(item, protocol))
             {
                 upnp::url url;
                 url.host = host;
-                url.path = to_objectpath(item.uuid, protocol.profile + ':' + path, protocol.suffix);
+                url.path = to_objectpath(protocol.profile, path, protocol.suffix);
                 browse_item.files.push_back(std::make_pair(url, protocol));
             }
     }
 
-    action.add_item(browse_item);
+    return browse_item;
 }
 
 std::string content_directory::basepath(const std::string &dir)
@@ -738,6 +1036,8 @@ std::string content_directory::parentpath(const std::string &dir)
 
 std::string content_directory::to_objectid(const std::string &path, bool create)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     if (path == "/")
     {
         return "0";
@@ -748,18 +1048,9 @@ std::string content_directory::to_objectid(const std::string &path, bool create)
     }
     else
     {
-        auto i = objectid_map.find(path);
-        if (i != objectid_map.end())
-            return std::to_string(i->second);
-
-        if (create)
-        {
-            objectid_list.push_back(path);
-            objectid_list.back().shrink_to_fit();
-            objectid_map[objectid_list.back()] = objectid_list.size() - 1;
-
-            return std::to_string(objectid_list.size() - 1);
-        }
+        const uint32_t id = objectids.to_id(path, create);
+        if (id != 0)
+            return std::to_string(id);
     }
 
     return std::string();
@@ -767,6 +1058,8 @@ std::string content_directory::to_objectid(const std::string &path, bool create)
 
 std::string content_directory::from_objectid(const std::string &id_str)
 {
+    std::lock_guard<std::recursive_mutex> _(mutex);
+
     if (id_str == "0")
     {
         return "/";
@@ -779,9 +1072,9 @@ std::string content_directory::from_objectid(const std::string &id_str)
     {
         try
         {
-            const size_t id = std::stoull(id_str);
-            if (id < objectid_list.size())
-                return objectid_list[id];
+            const unsigned long id = std::stoul(id_str);
+            if ((id > 0) && (id <= uint32_t(-1)))
+                return objectids.from_id(uint32_t(id));
         }
         catch (const std::invalid_argument &) { }
         catch (const std::out_of_range &) { }
@@ -790,56 +1083,56 @@ std::string content_directory::from_objectid(const std::string &id_str)
     }
 }
 
-std::string content_directory::to_objectpath(const platform::uuid &base_uuid, const std::string &path, const std::string &suffix)
+std::string content_directory::to_objectpath(const std::string &profile, const std::string &path, const std::string &suffix)
 {
-    platform::uuid uuid;
-    {
-        auto i = object_path_to_uuid.find(path);
-        if (i == object_path_to_uuid.end())
-        {
-            for (uint16_t i = 0; i != uint16_t(-1); i++)
-            {
-                platform::uuid u = base_uuid;
-                u.value[4] ^= uint8_t(i >> 8);
-                u.value[5] ^= uint8_t(i & 0xFF);
-
-                auto j = object_uuid_to_path.find(u);
-                if (j == object_uuid_to_path.end())
-                {
-                    object_uuid_to_path.insert(std::make_pair(u, path));
-                    uuid = u;
-                    break;
-                }
-            }
-        }
-        else
-            uuid = i->second;
-    }
-
-    if (!uuid.is_null())
-        return basedir + std::string(uuid) + '.' + suffix;
+    const auto objectid = to_objectid(path);
+    if (!objectid.empty())
+        return basedir + profile + '/' + objectid + '.' + suffix;
 
     return std::string();
 }
 
 std::string content_directory::from_objectpath(const std::string &path)
 {
-    const size_t ls = path.find_last_of('/');
-    if (ls != path.npos)
+    if (starts_with(path, basedir))
     {
-        const size_t dot = path.find_first_of('.', ls);
-        if (dot != path.npos)
+        const size_t sl = path.find_first_of('/', basedir.length());
+        if (sl != path.npos)
         {
-            const platform::uuid uuid = path.substr(ls + 1, dot - ls - 1);
-            auto i = object_uuid_to_path.find(uuid);
-            if (i != object_uuid_to_path.end())
-                return i->second;
+            const size_t dot = path.find_first_of('.', sl);
+            if (dot != path.npos)
+            {
+                const auto objectpath = from_objectid(path.substr(sl + 1, dot - sl - 1));
+                if (!objectpath.empty())
+                    return path.substr(basedir.length(), sl - basedir.length()) + ':' + objectpath;
+            }
         }
     }
 
     return std::string();
 }
 
+std::vector<content_directory::item> content_directory::item_source::list_sorted_contentdir_items(const std::string &client, const std::string &path, const std::vector<sort_criterion> &, size_t start, size_t &count)
+{
+    return list_contentdir_items(client, path, start, count);
+}
+
+bool content_directory::item_source::cache_contentdir_items(const std::string &)
+{
+    return false;
+}
+
+bool content_directory::item_source::concurrent_contentdir_items()
+{
+    return false;
+}
+
+std::vector<content_directory::item> content_directory::item_source::search_contentdir_items(const std::string &, const std::string &, const search_criteria &, size_t, size_t &count)
+{
+    count = 0;
+    return std::vector<item>();
+}
+
 
 content_directory::item::item(void)
     : is_dir(false), type(item_type::none), track(0),
@@ -902,29 +1195,37 @@ std::vector<content_directory::item> content_directory::root_item_source::list_c
     std::vector<content_directory::item> result;
     std::set<std::string> names;
 
-    for (auto &i : parent.item_source_order)
+    std::vector<std::pair<std::string, struct item_source *>> item_sources;
+    {
+        std::lock_guard<std::recursive_mutex> _(parent.mutex);
+
+        for (auto &i : parent.item_source_order)
+        {
+            const auto item_source = parent.item_sources.find(i);
+            if ((item_source != parent.item_sources.end()) && starts_with(item_source->first, path))
+                item_sources.push_back(*item_source);
+        }
+    }
+
+    for (auto &item_source : item_sources)
     {
-        const auto item_source = parent.item_sources.find(i);
-        if ((item_source != parent.item_sources.end()) && starts_with(item_source->first, path))
+        auto item = get_contentdir_item(client, item_source.first);
+        if (!item.title.empty() && (names.find(item.title) == names.end()))
         {
-            auto item = get_contentdir_item(client, item_source->first);
-            if (!item.title.empty() && (names.find(item.title) == names.end()))
+            size_t total = 1;
+            if (!item_source.second->list_contentdir_items(client, item_source.first, 0, total).empty() && (total > 0))
             {
-                size_t total = 1;
-                if (!item_source->second->list_contentdir_items(client, item_source->first, 0, total).empty() && (total > 0))
+                names.insert(item.title);
+                if (return_all || (count > 0))
                 {
-                    names.insert(item.title);
-                    if (return_all || (count > 0))
+                    if (start == 0)
                     {
-                        if (start == 0)
-                        {
-                            result.push_back(item);
-                            if (count > 0)
-                                count--;
-                        }
-                        else
-                            start--;
+                        result.push_back(item);
+                        if (count > 0)
+                            count--;
                     }
+                    else
+                        start--;
                 }
             }
         }
@@ -19,12 +19,17 @@
 #define PUPNP_CONTENT_DIRECTORY_H
 
 #include "connection_manager.h"
+#include "objectid_table.h"
 #include "rootdevice.h"
+#include "search_index.h"
 #include "upnp.h"
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
+#include <list>
 #include <map>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -79,10 +84,28 @@ public:
         std::chrono::milliseconds last_position;
     };
 
+    enum class sort_property { title, date, duration, track };
+
+    struct sort_criterion
+    {
+        sort_property property;
+        bool ascending;
+    };
+
     struct item_source
     {
         virtual std::vector<item> list_contentdir_items(const std::string &client, const std::string &path, size_t start, size_t &count) = 0;
+        virtual std::vector<item> list_sorted_contentdir_items(const std::string &client, const std::string &path, const std::vector<sort_criterion> &, size_t start, size_t &count);
+        virtual std::vector<item> search_contentdir_items(const std::string &client, const std::string &path, const search_criteria &, size_t start, size_t &count);
         virtual item get_contentdir_item(const std::string &client, const std::string &path) = 0;
+        virtual bool cache_contentdir_items(const std::string &path);
+
+        /*! Returns true if the list, search and get functions can be called
+            from multiple threads at once, otherwise they are called on the
+            messageloop.
+         */
+        virtual bool concurrent_contentdir_items();
+
         virtual bool correct_protocol(const item &, connection_manager::protocol &) = 0;
         virtual int play_item(const std::string &source_address, const item &, const std::string &profile, std::string &, std::shared_ptr<std::istream> &) = 0;
     };
@@ -129,6 +152,9 @@ public:
         virtual void add_item(const browse_item &) = 0;
         virtual void add_container(const browse_container &) = 0;
         virtual void set_response(size_t totalMatches, uint32_t updateID) = 0;
+        virtual void set_response(const std::string &result, size_t numberReturned, size_t totalMatches, uint32_t updateID) = 0;
+        virtual const std::string & get_result() const = 0;
+        virtual size_t get_number_returned() const = 0;
     };
 
     struct action_search
@@ -168,8 +194,9 @@ public:
 public:
     static const char service_id[];
     static const char service_type[];
+    static const char sort_capabilities[];
 
-    content_directory(class platform::messageloop_ref &, class upnp &, class rootdevice &, class connection_manager &);
+    content_directory(class platform::messageloop_ref &, class upnp &, class rootdevice &, class connection_manager &, class platform::inifile &);
     virtual ~content_directory();
 
     void item_source_register(const std::string &path, struct item_source &);
@@ -178,6 +205,14 @@ public:
     void update_system();
     void update_path(const std::string &path);
 
+    /*! Drops the cached Browse responses for the path and everything below
+        it, without notifying the clients.
+     */
+    void flush_cache(const std::string &path);
+
+    size_t browse_cache_hits() const { return response_cache_hits; }
+    size_t browse_cache_misses() const { return response_cache_misses; }
+
     void handle_action(const upnp::request &, action_browse &);
     void handle_action(const upnp::request &, action_search &);
     void handle_action(const upnp::request &, action_get_search_capabilities &);
@@ -198,15 +233,20 @@ private:
     int http_request(const upnp::request &, std::string &, std::shared_ptr<std::istream> &);
 
 private:
+    std::shared_ptr<struct item_source> use_item_source(struct item_source *);
+    void call_item_source(struct item_source &, const std::function<void()> &);
+    size_t browse(const upnp::request &, action_browse &, struct item_source &, const std::string &client, std::string &path);
+    uint32_t get_system_update_id() const;
     void add_directory(action_browse &, enum item_type, const std::string &client, const std::string &path, const std::string &title = std::string());
     void add_container(action_browse &, enum item_type, const std::string &path, const std::string &title = std::string());
     void add_file(action_browse &, const std::string &, struct item_source &, const item &, const std::string &, const std::string & = std::string());
+    browse_item make_browse_item(const std::string &, struct item_source &, const item &, const std::string &, const std::string & = std::string());
 
     static std::string basepath(const std::string &);
     static std::string parentpath(const std::string &);
     std::string to_objectid(const std::string &path, bool create = true);
     std::string from_objectid(const std::string &id);
-    std::string to_objectpath(const platform::uuid &, const std::string &path, const std::string &suffix);
+    std::string to_objectpath(const std::string &profile, const std::string &path, const std::string &suffix);
     std::string from_objectpath(const std::string &path);
 
     void num_connections_changed(int num_connections);
@@ -221,6 +261,11 @@ private:
 
     platform::timer update_timer;
     const std::chrono::seconds update_timer_interval;
+
+    // Browse and Search are handled on the threads of libupnp, the mutex
+    // guards the members below and is not held while item sources are called.
+    mutable std::recursive_mutex mutex;
+
     uint32_t system_update_id;
     std::set<std::string> pending_container_updates;
     bool allow_process_pending_updates;
@@ -228,12 +273,26 @@ private:
     struct update_id { uint32_t id; size_t totalmatches; };
     std::map<std::string, update_id> container_update_ids;
     std::map<std::string, item_source *> item_sources;
+    std::map<item_source *, size_t> item_source_uses; // Not unregistered while used.
+
+    struct cached_response
+    {
+        std::string path;
+        std::string result;
+        size_t number_returned, totalmatches;
+        uint32_t update_id;
+    };
+
+    typedef std::list<std::pair<std::string, cached_response>> response_list;
+    const size_t response_cache_size;
+    response_list response_cache;
+    std::map<std::string, response_list::iterator> response_cache_index;
+    std::atomic<size_t> response_cache_hits, response_cache_misses;
+    uint64_t response_cache_generation;
+
     std::vector<std::string> item_source_order;
 
-    std::vector<std::string> objectid_list;
-    std::map<std::string, size_t> objectid_map;
-    std::map<platform::uuid, std::string> object_uuid_to_path;
-    std::map<std::string, platform::uuid> object_path_to_uuid;
+    class objectid_table objectids;
 
     struct root_item_source final : item_source
     {
@@ -0,0 +1,234 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "didl_lite.h"
+#include <cstdio>
+#include <sstream>
+
+namespace pupnp {
+
+static const size_t initial_size = 16384;
+
+static std::set<std::string> parse_filter(const std::string &text)
+{
+    std::set<std::string> result;
+
+    std::stringstream str(text);
+    std::string name;
+    while (std::getline(str, name, ','))
+    {
+        const size_t begin = name.find_first_not_of(" \t");
+        const size_t end = name.find_last_not_of(" \t");
+        if ((begin == name.npos) || (end == name.npos))
+            continue;
+
+        name = name.substr(begin, end - begin + 1);
+        const size_t at = name.find_first_of('@');
+        if (at == 0)
+        {
+            result.insert("item" + name);
+            result.insert("container" + name);
+        }
+        else if (at != name.npos)
+        {
+            // Selecting an attribute also selects its property.
+            result.insert(name.substr(0, at));
+            result.insert(name);
+        }
+        else
+            result.insert(name);
+    }
+
+    return result;
+}
+
+didl_lite::didl_lite(const std::string &filter)
+    : select_all(filter.empty() || (filter.find_first_of('*') != filter.npos)),
+      filter(select_all ? std::set<std::string>() : parse_filter(filter)),
+      open_element(nullptr),
+      num_objects(0)
+{
+    result.reserve(initial_size);
+    result +=
+            "<?xml version=\"1.0\"?>\r\n"
+            "<DIDL-Lite"
+            " xmlns=\"urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/\""
+            " xmlns:dc=\"http://purl.org/dc/elements/1.1/\""
+            " xmlns:dlna=\"urn:schemas-dlna-org:metadata-1-0/\""
+            " xmlns:upnp=\"urn:schemas-upnp-org:metadata-1-0/upnp/\">";
+}
+
+didl_lite::~didl_lite()
+{
+}
+
+bool didl_lite::selected(const std::string &name) const
+{
+    return select_all || (filter.find(name) != filter.end());
+}
+
+static void append_escaped(std::string &result, const std::string &text)
+{
+    static const char special[] = "<>&'\"";
+
+    size_t pos = 0;
+    for (size_t i = text.find_first_of(special); i != text.npos; i = text.find_first_of(special, pos))
+    {
+        result.append(text, pos, i - pos);
+        switch (text[i])
+        {
+        case '<':   result += "&lt;";   break;
+        case '>':   result += "&gt;";   break;
+        case '&':   result += "&amp;";  break;
+        case '\'':  result += "&apos;"; break;
+        case '"':   result += "&quot;"; break;
+        }
+
+        pos = i + 1;
+    }
+
+    result.append(text, pos, text.npos);
+}
+
+void didl_lite::attribute(const char *name, const std::string &value)
+{
+    result += ' ';
+    result += name;
+    result += "=\"";
+    append_escaped(result, value);
+    result += '"';
+}
+
+void didl_lite::open_object(const char *element, const std::string &id, const std::string &parent_id, bool restricted)
+{
+    if (num_objects == 0)
+        result += "\r\n";
+
+    result += '<';
+    result += element;
+    attribute("id", id);
+    attribute("parentID", parent_id);
+    attribute("restricted", restricted ? "1" : "0");
+
+    open_element = element;
+    num_objects++;
+}
+
+void didl_lite::open_item(const std::string &id, const std::string &parent_id, bool restricted)
+{
+    open_object("item", id, parent_id, restricted);
+    result += ">\r\n";
+}
+
+void didl_lite::open_container(const std::string &id, const std::string &parent_id, bool restricted, size_t child_count)
+{
+    open_object("container", id, parent_id, restricted);
+    if ((child_count != size_t(-1)) && selected("container@childCount"))
+        attribute("childCount", std::to_string(child_count));
+
+    result += ">\r\n";
+}
+
+void didl_lite::close()
+{
+    if (open_element)
+    {
+        result += "</";
+        result += open_element;
+        result += ">\r\n";
+
+        open_element = nullptr;
+    }
+}
+
+void didl_lite::add_property(const std::string &name, const std::string &value)
+{
+    add_property(name, value, nullptr, std::string());
+}
+
+void didl_lite::add_property(const std::string &name, const std::string &value, const char *attribute, const std::string &attribute_value)
+{
+    // The title and class are required properties.
+    if ((name != "dc:title") && (name != "upnp:class") && !selected(name))
+        return;
+
+    result += '<';
+    result += name;
+    if (attribute && selected(name + '@' + attribute))
+        this->attribute(attribute, attribute_value);
+
+    result += '>';
+    append_escaped(result, value);
+    result += "</";
+    result += name;
+    result += ">\r\n";
+}
+
+static std::string to_time(std::chrono::milliseconds duration)
+{
+    const auto milliseconds = duration.count();
+
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%lld:%02d:%02d.%03d",
+             (long long)(milliseconds / 3600000),
+             int((milliseconds % 3600000) / 60000),
+             int((milliseconds % 60000) / 1000),
+             int(milliseconds % 1000));
+
+    return buffer;
+}
+
+void didl_lite::add_res(
+        const std::string &url,
+        const std::string &protocol_info,
+        std::chrono::milliseconds duration,
+        unsigned sample_rate, unsigned channels,
+        unsigned width, unsigned height)
+{
+    if (!selected("res"))
+        return;
+
+    // The protocolInfo is required if the resource is included.
+    result += "<res";
+    attribute("protocolInfo", protocol_info);
+
+    if ((duration.count() > 0) && selected("res@duration"))
+        attribute("duration", to_time(duration));
+
+    if ((sample_rate > 0) && selected("res@sampleFrequency"))
+        attribute("sampleFrequency", std::to_string(sample_rate));
+
+    if ((channels > 0) && selected("res@nrAudioChannels"))
+        attribute("nrAudioChannels", std::to_string(channels));
+
+    if ((width > 0) && (height > 0) && selected("res@resolution"))
+        attribute("resolution", std::to_string(width) + "x" + std::to_string(height));
+
+    result += '>';
+    append_escaped(result, url);
+    result += "</res>\r\n";
+}
+
+std::string didl_lite::finish()
+{
+    close();
+    result += "</DIDL-Lite>\r\n";
+
+    return std::move(result);
+}
+
+} // End of namespace
@@ -0,0 +1,72 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef PUPNP_DIDL_LITE_H
+#define PUPNP_DIDL_LITE_H
+
+#include <chrono>
+#include <cstddef>
+#include <set>
+#include <string>
+
+namespace pupnp {
+
+/*! Writes a DIDL-Lite document directly into a string, in the same layout
+    as ixmlDocumenttoString() produces for the equivalent DOM. Properties and
+    attributes that are not selected by the Filter argument of Browse or
+    Search are left out; an empty Filter selects everything, as some clients
+    leave it empty and still expect resources.
+ */
+class didl_lite
+{
+public:
+    explicit didl_lite(const std::string &filter = "*");
+    ~didl_lite();
+
+    void open_item(const std::string &id, const std::string &parent_id, bool restricted);
+    void open_container(const std::string &id, const std::string &parent_id, bool restricted, size_t child_count);
+    void close();
+
+    void add_property(const std::string &name, const std::string &value);
+    void add_property(const std::string &name, const std::string &value, const char *attribute, const std::string &attribute_value);
+    void add_res(
+            const std::string &url,
+            const std::string &protocol_info,
+            std::chrono::milliseconds duration,
+            unsigned sample_rate, unsigned channels,
+            unsigned width, unsigned height);
+
+    size_t count() const { return num_objects; }
+    std::string finish();
+
+private:
+    bool selected(const std::string &name) const;
+    void open_object(const char *element, const std::string &id, const std::string &parent_id, bool restricted);
+    void attribute(const char *name, const std::string &value);
+
+private:
+    const bool select_all;
+    std::set<std::string> filter;
+
+    std::string result;
+    const char *open_element;
+    size_t num_objects;
+};
+
+} // End of namespace
+
+#endif
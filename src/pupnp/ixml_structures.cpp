@@ -19,8 +19,6 @@
 #include "platform/string.h"
 #include <ixml.h>
 #include <cstring>
-#include <iomanip>
-#include <sstream>
 
 namespace pupnp {
 namespace ixml_structures {
@@ -370,14 +368,9 @@ action_browse::action_browse(IXML_Node *src, IXML_Document *&dst, const std::str
     : xml_structure(dst),
       src(src),
       prefix(prefix),
-      result(),
-      didl(result.add_element(&result.doc->n, "DIDL-Lite")),
+      result(get_textelement(src, "Filter")),
       number_returned(0)
 {
-    result.set_attribute(didl, "xmlns", "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");
-    result.set_attribute(didl, "xmlns:dc", "http://purl.org/dc/elements/1.1/");
-    result.set_attribute(didl, "xmlns:dlna", "urn:schemas-dlna-org:metadata-1-0/");
-    result.set_attribute(didl, "xmlns:upnp", "urn:schemas-upnp-org:metadata-1-0/upnp/");
 }
 
 std::string action_browse::get_object_id() const
@@ -420,107 +413,85 @@ std::string action_browse::get_sort_criteria() const
     return get_textelement(src, "SortCriteria");
 }
 
-template<typename rep, typename period>
-static std::string to_time(std::chrono::duration<rep, period> duration)
-{
-    const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-
-    std::ostringstream str;
-    str << (milliseconds / 3600000)
-        << ":" << std::setw(2) << std::setfill('0') << ((milliseconds % 3600000) / 60000)
-        << ":" << std::setw(2) << std::setfill('0') << ((milliseconds % 60000) / 1000)
-        << "." << std::setw(3) << std::setfill('0') << (milliseconds % 1000);
-
-    return str.str();
-}
-
 void action_browse::add_item(const content_directory::browse_item &browse_item)
 {
-    IXML_Element * const item = result.add_element(&didl->n, "item");
-    result.set_attribute(item, "id", browse_item.id);
-    result.set_attribute(item, "parentID", browse_item.parent_id);
-    result.set_attribute(item, "restricted", browse_item.restricted ? "1" : "0");
-
-    result.add_textelement(&item->n, "dc:title", browse_item.title);
+    result.open_item(browse_item.id, browse_item.parent_id, browse_item.restricted);
+    result.add_property("dc:title", browse_item.title);
 
     for (auto &attribute : browse_item.attributes)
     {
-        IXML_Element * const e = result.add_textelement(&item->n, attribute.first, attribute.second);
         if (attribute.first == "upnp:albumArtURI")
         {
             if (ends_with(attribute.second, ".jpeg") || ends_with(attribute.second, ".jpg"))
-                result.set_attribute(e, "dlna:profileID", "JPEG_TN");
+                result.add_property(attribute.first, attribute.second, "dlna:profileID", "JPEG_TN");
             else if (ends_with(attribute.second, ".png"))
-                result.set_attribute(e, "dlna:profileID", "PNG_SM");
+                result.add_property(attribute.first, attribute.second, "dlna:profileID", "PNG_SM");
+            else
+                result.add_property(attribute.first, attribute.second);
         }
+        else
+            result.add_property(attribute.first, attribute.second);
     }
 
     for (auto &file : browse_item.files)
     {
-        IXML_Element * const res = result.add_textelement(&item->n, "res", file.first);
-        result.set_attribute(res, "protocolInfo", file.second.to_string());
-
-        if (browse_item.duration.count() > 0)
-            result.set_attribute(res, "duration", to_time(browse_item.duration));
-
-        if (file.second.sample_rate > 0)
-            result.set_attribute(res, "sampleFrequency", std::to_string(file.second.sample_rate));
-
-        if (file.second.channels > 0)
-            result.set_attribute(res, "nrAudioChannels", std::to_string(file.second.channels));
-
-        if ((file.second.width > 0) && (file.second.height > 0))
-            result.set_attribute(res, "resolution", std::to_string(file.second.width) + "x" + std::to_string(file.second.height));
+        result.add_res(
+                    file.first, file.second.to_string(),
+                    browse_item.duration,
+                    file.second.sample_rate, file.second.channels,
+                    file.second.width, file.second.height);
     }
 
-    number_returned++;
+    result.close();
 }
 
 void action_browse::add_container(const content_directory::browse_container &browse_container)
 {
-    IXML_Element * const item = result.add_element(&didl->n, "container");
-    result.set_attribute(item, "id", browse_container.id);
-    result.set_attribute(item, "parentID", browse_container.parent_id);
-    result.set_attribute(item, "restricted", browse_container.restricted ? "1" : "0");
-
-    if (browse_container.child_count != size_t(-1))
-        result.set_attribute(item, "childCount", std::to_string(browse_container.child_count));
-
-    result.add_textelement(&item->n, "dc:title", browse_container.title);
+    result.open_container(browse_container.id, browse_container.parent_id, browse_container.restricted, browse_container.child_count);
+    result.add_property("dc:title", browse_container.title);
 
     for (auto &attribute : browse_container.attributes)
-        result.add_textelement(&item->n, attribute.first, attribute.second);
+        result.add_property(attribute.first, attribute.second);
 
-    number_returned++;
+    result.close();
 }
 
 void action_browse::set_response(size_t total_matches, uint32_t update_id)
+{
+    number_returned = result.count();
+    result_text = result.finish();
+
+    set_response(result_text, number_returned, total_matches, update_id);
+}
+
+void action_browse::set_response(const std::string &didl, size_t number_returned, size_t total_matches, uint32_t update_id)
 {
     IXML_Element * const response = add_element(&doc->n, prefix + ":BrowseResponse");
     set_attribute(response, "xmlns:" + prefix, content_directory::service_type);
 
-    DOMString r = ixmlDocumenttoString(result.doc);
-    add_textelement(&response->n, "Result", r);
-    ixmlFreeDOMString(r);
-
+    add_textelement(&response->n, "Result", didl);
     add_textelement(&response->n, "NumberReturned", std::to_string(number_returned));
     add_textelement(&response->n, "TotalMatches", std::to_string(total_matches));
     add_textelement(&response->n, "UpdateID", std::to_string(update_id));
 }
 
+const std::string & action_browse::get_result() const
+{
+    return result_text;
+}
+
+size_t action_browse::get_number_returned() const
+{
+    return number_returned;
+}
+
 
 action_search::action_search(IXML_Node *src, IXML_Document *&dst, const std::string &prefix)
     : xml_structure(dst),
       src(src),
       prefix(prefix),
-      result(),
-      didl(result.add_element(&result.doc->n, "DIDL-Lite")),
-      number_returned(0)
+      result(get_textelement(src, "Filter"))
 {
-    result.set_attribute(didl, "xmlns", "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");
-    result.set_attribute(didl, "xmlns:dc", "http://purl.org/dc/elements/1.1/");
-    result.set_attribute(didl, "xmlns:dlna", "urn:schemas-dlna-org:metadata-1-0/");
-    result.set_attribute(didl, "xmlns:upnp", "urn:schemas-upnp-org:metadata-1-0/upnp/");
 }
 
 std::string action_search::get_container_id() const
@@ -559,44 +530,34 @@ std::string action_search::get_sort_criteria() const
 
 void action_search::add_item(const content_directory::browse_item &browse_item)
 {
-    IXML_Element * const item = result.add_element(&didl->n, "item");
-    result.set_attribute(item, "id", browse_item.id);
-    result.set_attribute(item, "parentID", browse_item.parent_id);
-    result.set_attribute(item, "restricted", browse_item.restricted ? "1" : "0");
-
-    result.add_textelement(&item->n, "dc:title", browse_item.title);
+    result.open_item(browse_item.id, browse_item.parent_id, browse_item.restricted);
+    result.add_property("dc:title", browse_item.title);
 
     for (auto &attribute : browse_item.attributes)
     {
-        IXML_Element * const e = result.add_textelement(&item->n, attribute.first, attribute.second);
         if (attribute.first == "upnp:albumArtURI")
         {
             if (ends_with(attribute.second, ".jpeg") || ends_with(attribute.second, ".jpg"))
-                result.set_attribute(e, "dlna:profileID", "JPEG_TN");
+                result.add_property(attribute.first, attribute.second, "dlna:profileID", "JPEG_TN");
             else if (ends_with(attribute.second, ".png"))
-                result.set_attribute(e, "dlna:profileID", "PNG_SM");
+                result.add_property(attribute.first, attribute.second, "dlna:profileID", "PNG_SM");
+            else
+                result.add_property(attribute.first, attribute.second);
         }
+        else
+            result.add_property(attribute.first, attribute.second);
     }
 
     for (auto &file : browse_item.files)
     {
-        IXML_Element * const res = result.add_textelement(&item->n, "res", file.first);
-        result.set_attribute(res, "protocolInfo", file.second.to_string());
-
-        if (browse_item.duration.count() > 0)
-            result.set_attribute(res, "duration", to_time(browse_item.duration));
-
-        if (file.second.sample_rate > 0)
-            result.set_attribute(res, "sampleFrequency", std::to_string(file.second.sample_rate));
-
-        if (file.second.channels > 0)
-            result.set_attribute(res, "nrAudioChannels", std::to_string(file.second.channels));
-
-        if ((file.second.width > 0) && (file.second.height > 0))
-            result.set_attribute(res, "resolution", std::to_string(file.second.width) + "x" + std::to_string(file.second.height));
+        result.add_res(
+                    file.first, file.second.to_string(),
+                    browse_item.duration,
+                    file.second.sample_rate, file.second.channels,
+                    file.second.width, file.second.height);
     }
 
-    number_returned++;
+    result.close();
 }
 
 void action_search::set_response(size_t total_matches, uint32_t update_id)
@@ -604,10 +565,8 @@ void action_search::set_response(size_t total_matches, uint32_t update_id)
     IXML_Element * const response = add_element(&doc->n, prefix + ":SearchResponse");
     set_attribute(response, "xmlns:" + prefix, content_directory::service_type);
 
-    DOMString r = ixmlDocumenttoString(result.doc);
-    add_textelement(&response->n, "Result", r);
-    ixmlFreeDOMString(r);
-
+    const size_t number_returned = result.count();
+    add_textelement(&response->n, "Result", result.finish());
     add_textelement(&response->n, "NumberReturned", std::to_string(number_returned));
     add_textelement(&response->n, "TotalMatches", std::to_string(total_matches));
     add_textelement(&response->n, "UpdateID", std::to_string(update_id));
@@ -21,6 +21,7 @@
 #include "rootdevice.h"
 #include "connection_manager.h"
 #include "content_directory.h"
+#include "didl_lite.h"
 #include "mediareceiver_registrar.h"
 
 struct _IXML_Document;
@@ -153,12 +154,15 @@ public:
     virtual void add_item(const content_directory::browse_item &) override;
     virtual void add_container(const content_directory::browse_container &) override;
     virtual void set_response(size_t total_matches, uint32_t update_id) override;
+    virtual void set_response(const std::string &result, size_t number_returned, size_t total_matches, uint32_t update_id) override;
+    virtual const std::string & get_result() const override;
+    virtual size_t get_number_returned() const override;
 
 private:
     _IXML_Node * const src;
     const std::string prefix;
-    xml_structure result;
-    _IXML_Element * const didl;
+    didl_lite result;
+    std::string result_text;
     size_t number_returned;
 };
 
@@ -180,9 +184,7 @@ public:
 private:
     _IXML_Node * const src;
     const std::string prefix;
-    xml_structure result;
-    _IXML_Element * const didl;
-    size_t number_returned;
+    didl_lite result;
 };
 
 class action_get_search_capabilities final : public xml_structure, public content_directory::action_get_search_capabilities
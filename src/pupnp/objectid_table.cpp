@@ -0,0 +1,229 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "objectid_table.h"
+#include "platform/inifile.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace pupnp {
+
+static const char section_name[] = "objectids";
+static const char next_id_name[] = "next_id";
+
+objectid_table::objectid_table(class platform::inifile &inifile, size_t max_size)
+    : inifile(inifile),
+      max_size(max_size),
+      next_id(1),
+      use_counter(0)
+{
+    nodes[0] = node { 0, 0, std::string(), std::vector<uint32_t>() };
+
+    load();
+}
+
+objectid_table::~objectid_table()
+{
+}
+
+void objectid_table::load()
+{
+    const auto section = inifile.open_section(section_name);
+    for (auto &name : section.names())
+    {
+        if (name == next_id_name)
+        {
+            next_id = std::max(next_id, uint32_t(section.read(name, 1ll)));
+            continue;
+        }
+
+        const uint32_t id = uint32_t(std::strtoul(name.c_str(), nullptr, 10));
+        const auto value = section.read(name);
+        const size_t space = value.find_first_of(' ');
+        if ((id == 0) || (space == value.npos))
+            continue;
+
+        const uint32_t parent = uint32_t(std::strtoul(value.c_str(), nullptr, 10));
+        nodes[id] = node { parent, 0, value.substr(space + 1), std::vector<uint32_t>() };
+        next_id = std::max(next_id, id + 1);
+    }
+
+    // Parents are always created before their children, so a parent with a
+    // higher ID can only come from a damaged file.
+    std::vector<uint32_t> orphans;
+    for (auto &i : nodes)
+        if (i.first != 0)
+        {
+            auto parent = nodes.find(i.second.parent);
+            if ((parent != nodes.end()) && (parent->first < i.first))
+                parent->second.children.push_back(i.first);
+            else
+                orphans.push_back(i.first);
+        }
+
+    for (auto &i : orphans)
+        remove(i);
+
+    for (auto &i : nodes)
+    {
+        std::sort(
+                    i.second.children.begin(), i.second.children.end(),
+                    [this](uint32_t a, uint32_t b)
+                    {
+                        return nodes[a].segment < nodes[b].segment;
+                    });
+    }
+}
+
+std::vector<uint32_t>::iterator objectid_table::find_child(node &node, const char *segment, size_t length)
+{
+    return std::lower_bound(
+                node.children.begin(), node.children.end(),
+                0,
+                [this, segment, length](uint32_t a, int)
+                {
+                    const auto &s = nodes[a].segment;
+                    return s.compare(0, s.length(), segment, length) < 0;
+                });
+}
+
+uint32_t objectid_table::to_id(const std::string &path, bool create)
+{
+    uint32_t id = 0;
+    bool created = false;
+    use_counter++;
+    for (size_t pos = 0; pos < path.length(); )
+    {
+        const size_t sl = path.find_first_of('/', pos);
+        const size_t end = (sl != path.npos) ? (sl + 1) : path.length();
+
+        auto &node = nodes[id];
+        auto child = find_child(node, path.data() + pos, end - pos);
+        if ((child != node.children.end()) &&
+            (nodes[*child].segment.compare(0, std::string::npos, path, pos, end - pos) == 0))
+        {
+            id = *child;
+        }
+        else if (create)
+        {
+            const uint32_t child_id = next_id++;
+            auto &child_node = nodes[child_id];
+            child_node.parent = id;
+            child_node.segment = path.substr(pos, end - pos);
+            node.children.insert(child, child_id);
+
+            inifile.open_section(section_name).write(
+                        std::to_string(child_id),
+                        std::to_string(id) + ' ' + child_node.segment);
+
+            id = child_id;
+            created = true;
+        }
+        else
+            return 0;
+
+        nodes[id].last_used = use_counter;
+        pos = end;
+    }
+
+    if (created)
+    {
+        inifile.open_section(section_name).write(next_id_name, (long long)next_id);
+        if (size() > max_size)
+            cleanup();
+    }
+
+    return id;
+}
+
+std::string objectid_table::from_id(uint32_t id)
+{
+    std::vector<const std::string *> segments;
+    size_t length = 0;
+    use_counter++;
+    for (auto i = nodes.find(id); (i != nodes.end()) && (i->first != 0); i = nodes.find(i->second.parent))
+    {
+        i->second.last_used = use_counter;
+        segments.push_back(&i->second.segment);
+        length += i->second.segment.length();
+    }
+
+    std::string result;
+    result.reserve(length);
+    for (auto i = segments.rbegin(); i != segments.rend(); i++)
+        result += **i;
+
+    return result;
+}
+
+void objectid_table::cleanup()
+{
+    // A parent is used whenever one of its children is, and has a lower ID,
+    // so in this order the children of a node come before the node itself.
+    std::vector<std::pair<uint64_t, uint32_t>> order;
+    order.reserve(nodes.size());
+    for (auto &i : nodes)
+        if (i.first != 0)
+            order.emplace_back(i.second.last_used, uint32_t(-1) - i.first);
+
+    std::sort(order.begin(), order.end());
+
+    const size_t target = max_size - (max_size / 4);
+    size_t removed = 0;
+    for (auto &i : order)
+    {
+        if (size() <= target)
+            break;
+
+        const uint32_t id = uint32_t(-1) - i.second;
+        auto node = nodes.find(id);
+        if ((node != nodes.end()) && node->second.children.empty())
+        {
+            remove(id);
+            removed++;
+        }
+    }
+
+    std::clog << "pupnp::objectid_table: removed " << removed << " least recently used object IDs, "
+              << size() << " remaining." << std::endl;
+}
+
+void objectid_table::remove(uint32_t id)
+{
+    auto i = nodes.find(id);
+    if ((id == 0) || (i == nodes.end()))
+        return;
+
+    const auto children = i->second.children;
+    for (auto &child : children)
+        remove(child);
+
+    auto parent = nodes.find(i->second.parent);
+    if (parent != nodes.end())
+    {
+        auto &siblings = parent->second.children;
+        auto sibling = std::find(siblings.begin(), siblings.end(), id);
+        if (sibling != siblings.end())
+            siblings.erase(sibling);
+    }
+
+    inifile.open_section(section_name).erase(std::to_string(id));
+    nodes.erase(id);
+}
+
+} // End of namespace
@@ -0,0 +1,82 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef PUPNP_OBJECTID_TABLE_H
+#define PUPNP_OBJECTID_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace platform { class inifile; }
+
+namespace pupnp {
+
+/*! Maps paths to numeric object IDs and back. The paths are stored in a
+    trie of their segments, each ending with a '/' except for the last, so
+    each directory name is stored once. The IDs are stored in the inifile
+    and stay the same across restarts. Once the table holds more than
+    max_size paths, the least recently used paths are dropped until three
+    quarters of max_size remain, their IDs are not reused.
+
+    The table is not thread safe, content_directory serializes access.
+ */
+class objectid_table
+{
+public:
+    objectid_table(class platform::inifile &, size_t max_size = 262144);
+    ~objectid_table();
+
+    /*! Returns the ID of the path, or 0 if the path is not in the table and
+        create is false.
+     */
+    uint32_t to_id(const std::string &path, bool create = true);
+
+    /*! Returns the path of the ID, or an empty string if the ID is not in
+        the table.
+     */
+    std::string from_id(uint32_t id);
+
+    size_t size() const { return nodes.size() - 1; }
+    void cleanup();
+
+private:
+    struct node
+    {
+        uint32_t parent;
+        uint64_t last_used;
+        std::string segment;
+        std::vector<uint32_t> children;
+    };
+
+    void load();
+    std::vector<uint32_t>::iterator find_child(node &, const char *segment, size_t length);
+    void remove(uint32_t id);
+
+private:
+    class platform::inifile &inifile;
+    const size_t max_size;
+
+    std::unordered_map<uint32_t, node> nodes;
+    uint32_t next_id;
+    uint64_t use_counter;
+};
+
+} // End of namespace
+
+#endif
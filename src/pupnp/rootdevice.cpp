@@ -32,6 +32,8 @@ const char  rootdevice::servicedescriptionfile[]  = "service-";
 const char  rootdevice::servicecontrolfile[]      = "control-";
 const char  rootdevice::serviceeventfile[]        = "event-";
 
+const size_t rootdevice::max_descriptions = 64;
+
 rootdevice::rootdevice(class platform::messageloop_ref &messageloop, class upnp &upnp, const platform::uuid &uuid, const std::string &devicetype)
     : messageloop(messageloop),
       upnp(upnp),
@@ -40,6 +42,7 @@ rootdevice::rootdevice(class platform::messageloop_ref &messageloop, class upnp
       basedir(upnp.http_basedir()),
       devicename(uuid),
       initialized(false),
+      num_description_renders(0),
       rootdevice_registred(false)
 {
     upnp.child_add(*this);
@@ -60,11 +63,13 @@ const std::string &rootdevice::http_basedir() const
 void rootdevice::set_devicename(const std::string &devicename)
 {
     this->devicename = devicename;
+    descriptions.clear();
 }
 
 void rootdevice::add_icon(const std::string &path)
 {
     icons.push_back(path);
+    descriptions.clear();
 }
 
 void rootdevice::service_register(const std::string &service_id, struct service &service)
@@ -84,12 +89,36 @@ void rootdevice::service_register(const std::string &service_id, struct service
         n++;
 
     if (letter[n])
+    {
+        std::lock_guard<std::mutex> _(services_mutex);
+
         services[service_id] = std::make_pair(&service, ext + letter[n]);
+    }
+
+    descriptions.clear();
 }
 
 void rootdevice::service_unregister(const std::string &service_id)
 {
-    services.erase(service_id);
+    std::unique_lock<std::mutex> l(services_mutex);
+
+    auto i = services.find(service_id);
+    if (i != services.end())
+    {
+        struct service * const service = i->second.first;
+        services.erase(i);
+
+        // Wait for the actions still handled on the threads of libupnp, the
+        // messageloop is processed as they may be waiting for it.
+        while (concurrent_actions.find(service) != concurrent_actions.end())
+        {
+            l.unlock();
+            messageloop.process_events(std::chrono::milliseconds(16));
+            l.lock();
+        }
+    }
+
+    descriptions.clear();
 }
 
 bool rootdevice::initialize(void)
@@ -127,6 +156,7 @@ void rootdevice::close(void)
         for (auto i : services)
             i.second.first->close();
 
+        descriptions.clear();
         initialized = false;
     }
 }
@@ -180,11 +210,11 @@ void rootdevice::write_device_description(device_description &desc)
     desc.set_presentation_url("/");
 }
 
-int rootdevice::http_request(const upnp::request &request, std::string &content_type, std::shared_ptr<std::istream> &response)
+std::string rootdevice::render_description(const std::string &host, const std::string &name)
 {
-    if (starts_with(request.url.path, basedir + devicedescriptionfile))
+    if (name == devicedescriptionfile)
     {
-        ixml_structures::device_description desc(request.url.host, "/");
+        ixml_structures::device_description desc(host, "/");
         write_device_description(desc);
 
         for (auto &i : services)
@@ -197,39 +227,43 @@ int rootdevice::http_request(const upnp::request &request, std::string &content_
                         basedir + serviceeventfile + i.second.second);
         }
 
-        auto buffer = std::make_shared<std::stringstream>();
         DOMString s = ixmlDocumenttoString(desc.doc);
-        *buffer << s;
+        const std::string result = s;
         ixmlFreeDOMString(s);
-        content_type = upnp::mime_text_xml_utf8;
-        response = buffer;
 
-        return upnp::http_ok;
+        return result;
     }
-    else if (starts_with(request.url.path, basedir + servicedescriptionfile))
+    else for (auto &i : services)
     {
-        const size_t l = basedir.length() + strlen(servicedescriptionfile);
-        const std::string path = request.url.path;
-        const std::string ext = path.substr(l, path.length() - 4 - l);
-
-        for (auto &i : services)
+        if ((servicedescriptionfile + i.second.second) == name)
         {
-            if (i.second.second == ext)
-            {
-                ixml_structures::service_description desc;
-                i.second.first->write_service_description(desc);
+            ixml_structures::service_description desc;
+            i.second.first->write_service_description(desc);
 
-                auto buffer = std::make_shared<std::stringstream>();
-                DOMString s = ixmlDocumenttoString(desc.doc);
-                *buffer << s;
-                ixmlFreeDOMString(s);
-                content_type = upnp::mime_text_xml_utf8;
-                response = buffer;
+            DOMString s = ixmlDocumenttoString(desc.doc);
+            const std::string result = s;
+            ixmlFreeDOMString(s);
 
-                return upnp::http_ok;
-            }
+            return result;
         }
     }
+
+    return std::string();
+}
+
+int rootdevice::http_request(const upnp::request &request, std::string &content_type, std::shared_ptr<std::istream> &response)
+{
+    std::string name;
+    if (starts_with(request.url.path, basedir + devicedescriptionfile))
+    {
+        name = devicedescriptionfile;
+    }
+    else if (starts_with(request.url.path, basedir + servicedescriptionfile))
+    {
+        const std::string &path = request.url.path;
+        if (path.length() >= (basedir.length() + 4))
+            name = path.substr(basedir.length(), path.length() - 4 - basedir.length());
+    }
     else for (auto &icon : icons)
     {
         const std::string iconpath = basedir + icon;
@@ -242,6 +276,34 @@ int rootdevice::http_request(const upnp::request &request, std::string &content_
         }
     }
 
+    if (!name.empty())
+    {
+        // The descriptions only depend on the address the device is accessed
+        // through, they are cached until the device changes.
+        const auto key = std::make_pair(request.url.host, name);
+        auto i = descriptions.find(key);
+        if (i == descriptions.end())
+        {
+            std::string description = render_description(request.url.host, name);
+            if (description.empty())
+                return upnp::http_not_found;
+
+            if (descriptions.size() >= max_descriptions)
+                descriptions.clear();
+
+            i = descriptions.emplace(key, std::move(description)).first;
+            num_description_renders++;
+
+            std::clog << "pupnp::rootdevice: rendered " << name << " for " << request.url.host
+                      << " (" << num_description_renders << " renders)" << std::endl;
+        }
+
+        content_type = upnp::mime_text_xml_utf8;
+        response = std::make_shared<std::istringstream>(i->second);
+
+        return upnp::http_ok;
+    }
+
     return upnp::http_not_found;
 }
 
@@ -268,19 +330,18 @@ bool rootdevice::enable_rootdevice(void)
             if (eventtype == UPNP_CONTROL_ACTION_REQUEST)
             {
                 Upnp_Action_Request * const action_request = reinterpret_cast<Upnp_Action_Request *>(event);
-                me->messageloop.send([me, action_request]
+                const auto handle_action = [me, action_request](struct service *target)
                 {
-                    auto i = me->services.find(action_request->ServiceID);
-                    if ((i != me->services.end()) && me->rootdevice_registred)
+                    if (me->rootdevice_registred)
                     {
                         upnp::request request;
                         request.user_agent = action_request->RequestInfo.userAgent;
                         request.source_address = action_request->RequestInfo.sourceAddress;
                         request.url.host = action_request->RequestInfo.host;
 
-                        if ((strcmp(i->second.first->get_service_type(), connection_manager::service_type) == 0))
+                        if ((strcmp(target->get_service_type(), connection_manager::service_type) == 0))
                         {
-                            connection_manager * const service = static_cast<connection_manager *>(i->second.first);
+                            connection_manager * const service = static_cast<connection_manager *>(target);
 
                             IXML_NodeList * const children = ixmlNode_getChildNodes(&action_request->ActionRequest->n);
                             for (IXML_NodeList *i = children; i; i = i->next)
@@ -307,9 +368,9 @@ bool rootdevice::enable_rootdevice(void)
 
                             ixmlNodeList_free(children);
                         }
-                        else if ((strcmp(i->second.first->get_service_type(), content_directory::service_type) == 0))
+                        else if ((strcmp(target->get_service_type(), content_directory::service_type) == 0))
                         {
-                            content_directory * const service = static_cast<content_directory *>(i->second.first);
+                            content_directory * const service = static_cast<content_directory *>(target);
 
                             IXML_NodeList * const children = ixmlNode_getChildNodes(&action_request->ActionRequest->n);
                             for (IXML_NodeList *i = children; i; i = i->next)
@@ -351,9 +412,9 @@ bool rootdevice::enable_rootdevice(void)
 
                             ixmlNodeList_free(children);
                         }
-                        else if ((strcmp(i->second.first->get_service_type(), mediareceiver_registrar::service_type) == 0))
+                        else if ((strcmp(target->get_service_type(), mediareceiver_registrar::service_type) == 0))
                         {
-                            mediareceiver_registrar * const service = static_cast<mediareceiver_registrar *>(i->second.first);
+                            mediareceiver_registrar * const service = static_cast<mediareceiver_registrar *>(target);
 
                             IXML_NodeList * const children = ixmlNode_getChildNodes(&action_request->ActionRequest->n);
                             for (IXML_NodeList *i = children; i; i = i->next)
@@ -381,9 +442,52 @@ bool rootdevice::enable_rootdevice(void)
                             ixmlNodeList_free(children);
                         }
                     }
+                };
 
-                    for (auto &i : me->handled_action) if (i.second) i.second();
-                });
+                // Browse and Search are handled on this thread, so multiple
+                // requests can be handled at once. The content directory uses
+                // the messageloop for item sources that are not thread safe.
+                struct service *concurrent = nullptr;
+                {
+                    std::lock_guard<std::mutex> _(me->services_mutex);
+
+                    auto i = me->services.find(action_request->ServiceID);
+                    if ((i != me->services.end()) &&
+                        (strcmp(i->second.first->get_service_type(), content_directory::service_type) == 0) &&
+                        ((strcmp(action_request->ActionName, "Browse") == 0) ||
+                         (strcmp(action_request->ActionName, "Search") == 0)))
+                    {
+                        concurrent = i->second.first;
+                        me->concurrent_actions[concurrent]++;
+                    }
+                }
+
+                if (concurrent)
+                {
+                    handle_action(concurrent);
+
+                    me->messageloop.post([me]
+                    {
+                        for (auto &i : me->handled_action) if (i.second) i.second();
+                    });
+
+                    std::lock_guard<std::mutex> _(me->services_mutex);
+
+                    auto i = me->concurrent_actions.find(concurrent);
+                    if (--(i->second) == 0)
+                        me->concurrent_actions.erase(i);
+                }
+                else
+                {
+                    me->messageloop.send([me, action_request, &handle_action]
+                    {
+                        auto i = me->services.find(action_request->ServiceID);
+                        if (i != me->services.end())
+                            handle_action(i->second.first);
+
+                        for (auto &i : me->handled_action) if (i.second) i.second();
+                    });
+                }
 
                 return 0;
             }
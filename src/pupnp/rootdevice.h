@@ -20,9 +20,11 @@
 
 #include "upnp.h"
 #include "platform/uuid.h"
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -87,11 +89,17 @@ public:
 
     std::string udn() const;
 
+    /*! Returns how often the device and service descriptions were rendered,
+        they are cached until the device or the bound interfaces change.
+     */
+    size_t description_renders() const { return num_description_renders; }
+
     std::map<void *, std::function<void()>> handled_action;
 
 private:
     void handle_event(const std::string &service_id, eventable_propertyset &);
     void write_device_description(device_description &);
+    std::string render_description(const std::string &host, const std::string &name);
     int http_request(const upnp::request &, std::string &, std::shared_ptr<std::istream> &);
     bool enable_rootdevice(void);
 
@@ -110,9 +118,19 @@ private:
     std::vector<std::string> icons;
     bool initialized;
 
+    // Browse and Search are handled on the threads of libupnp, so services
+    // is only modified on the messageloop with services_mutex locked. The
+    // services in concurrent_actions are not unregistered until their
+    // actions have finished.
+    std::mutex services_mutex;
     std::map<std::string, std::pair<struct service *, std::string>> services;
+    std::map<struct service *, size_t> concurrent_actions;
+
+    static const size_t max_descriptions;
+    std::map<std::pair<std::string, std::string>, std::string> descriptions;
+    size_t num_description_renders;
 
-    bool rootdevice_registred;
+    std::atomic<bool> rootdevice_registred;
     std::map<std::string, int> rootdevice_handles;
 };
 
@@ -0,0 +1,646 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "search_index.h"
+#include "platform/string.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+namespace pupnp {
+
+search_criteria::search_criteria()
+    : type(relation::all)
+{
+}
+
+search_criteria::~search_criteria()
+{
+}
+
+static void skip_space(const std::string &text, size_t &pos)
+{
+    while ((pos < text.length()) && isspace(uint8_t(text[pos])))
+        pos++;
+}
+
+static std::string read_word(const std::string &text, size_t &pos)
+{
+    skip_space(text, pos);
+
+    const size_t start = pos;
+    if ((pos < text.length()) && (strchr("=!<>", text[pos]) != nullptr))
+    {
+        while ((pos < text.length()) && (strchr("=!<>", text[pos]) != nullptr))
+            pos++;
+    }
+    else while ((pos < text.length()) &&
+                !isspace(uint8_t(text[pos])) &&
+                (strchr("()\"", text[pos]) == nullptr))
+    {
+        pos++;
+    }
+
+    return text.substr(start, pos - start);
+}
+
+static bool read_quoted(const std::string &text, size_t &pos, std::string &value)
+{
+    skip_space(text, pos);
+    if ((pos >= text.length()) || (text[pos] != '"'))
+        return false;
+
+    for (pos++; pos < text.length(); pos++)
+        if (text[pos] == '"')
+        {
+            pos++;
+            return true;
+        }
+        else if ((text[pos] == '\\') && (pos + 1 < text.length()))
+            value.push_back(text[++pos]);
+        else
+            value.push_back(text[pos]);
+
+    return false;
+}
+
+// Limits the recursion on nested parentheses.
+static const unsigned max_nesting = 64;
+
+static bool parse_or(const std::string &, size_t &, search_criteria &, unsigned);
+
+static bool parse_relation(const std::string &text, size_t &pos, search_criteria &criteria, unsigned nesting)
+{
+    skip_space(text, pos);
+    if ((pos < text.length()) && (text[pos] == '('))
+    {
+        pos++;
+        if ((nesting >= max_nesting) || !parse_or(text, pos, criteria, nesting + 1))
+            return false;
+
+        skip_space(text, pos);
+        if ((pos >= text.length()) || (text[pos] != ')'))
+            return false;
+
+        pos++;
+        return true;
+    }
+
+    criteria.property = read_word(text, pos);
+    if (criteria.property.empty())
+        return false;
+
+    const auto op = to_lower(read_word(text, pos));
+    if      (op == "="              ) criteria.type = search_criteria::relation::equals;
+    else if (op == "!="             ) criteria.type = search_criteria::relation::not_equals;
+    else if (op == "<"              ) criteria.type = search_criteria::relation::less;
+    else if (op == "<="             ) criteria.type = search_criteria::relation::less_equal;
+    else if (op == ">"              ) criteria.type = search_criteria::relation::greater;
+    else if (op == ">="             ) criteria.type = search_criteria::relation::greater_equal;
+    else if (op == "contains"       ) criteria.type = search_criteria::relation::contains;
+    else if (op == "doesnotcontain" ) criteria.type = search_criteria::relation::does_not_contain;
+    else if (op == "derivedfrom"    ) criteria.type = search_criteria::relation::derived_from;
+    else if (op == "startswith"     ) criteria.type = search_criteria::relation::starts_with;
+    else if (op == "exists"         ) criteria.type = search_criteria::relation::exists;
+    else                              return false;
+
+    if (criteria.type == search_criteria::relation::exists)
+    {
+        criteria.value = to_lower(read_word(text, pos));
+        return (criteria.value == "true") || (criteria.value == "false");
+    }
+
+    return read_quoted(text, pos, criteria.value);
+}
+
+static bool parse_logical(
+        const std::string &text, size_t &pos,
+        search_criteria &criteria,
+        const char *keyword,
+        search_criteria::relation type,
+        bool(* parse_operand)(const std::string &, size_t &, search_criteria &, unsigned),
+        unsigned nesting)
+{
+    search_criteria operand;
+    if (!parse_operand(text, pos, operand, nesting))
+        return false;
+
+    for (;;)
+    {
+        size_t next = pos;
+        if (to_lower(read_word(text, next)) != keyword)
+            break;
+
+        if (operand.type != type)
+        {
+            search_criteria left;
+            left.type = type;
+            left.operands.emplace_back(std::move(operand));
+            operand = std::move(left);
+        }
+
+        pos = next;
+        operand.operands.emplace_back();
+        if (!parse_operand(text, pos, operand.operands.back(), nesting))
+            return false;
+    }
+
+    criteria = std::move(operand);
+    return true;
+}
+
+static bool parse_and(const std::string &text, size_t &pos, search_criteria &criteria, unsigned nesting)
+{
+    return parse_logical(text, pos, criteria, "and", search_criteria::relation::and_, &parse_relation, nesting);
+}
+
+static bool parse_or(const std::string &text, size_t &pos, search_criteria &criteria, unsigned nesting)
+{
+    return parse_logical(text, pos, criteria, "or", search_criteria::relation::or_, &parse_and, nesting);
+}
+
+bool search_criteria::parse(const std::string &text)
+{
+    *this = search_criteria();
+
+    size_t pos = 0;
+    skip_space(text, pos);
+    if ((pos < text.length()) && (text[pos] == '*'))
+        pos++;
+    else if (!parse_or(text, pos, *this, 0))
+        return false;
+
+    skip_space(text, pos);
+    return pos == text.length();
+}
+
+
+// Only the properties the media server fills in; the media cache does not
+// read artists and albums.
+const char search_index::capabilities[] = "dc:title,upnp:class";
+
+search_index::search_index()
+    : removed(0)
+{
+}
+
+search_index::~search_index()
+{
+}
+
+static bool is_word_char(char c)
+{
+    return isalnum(uint8_t(c)) || (uint8_t(c) >= 0x80);
+}
+
+static std::vector<std::string> split_words(const std::string &text)
+{
+    std::vector<std::string> result;
+
+    std::string word;
+    for (char c : text)
+        if (is_word_char(c))
+        {
+            word.push_back(c);
+        }
+        else if (!word.empty())
+        {
+            result.emplace_back(std::move(word));
+            word.clear();
+        }
+
+    if (!word.empty())
+        result.emplace_back(std::move(word));
+
+    return result;
+}
+
+void search_index::add(
+        const std::string &path,
+        const std::string &upnp_class,
+        const std::string &title,
+        const std::string &artist,
+        const std::string &album)
+{
+    remove(path);
+
+    struct document document;
+    document.path = path;
+    document.removed = false;
+    document.text[field::title] = to_lower(title);
+    document.text[field::artist] = to_lower(artist);
+    document.text[field::album] = to_lower(album);
+    document.text[field::path] = to_lower(path.substr(0, path.find_last_of('/') + 1));
+
+    auto i = std::find(classes.begin(), classes.end(), upnp_class);
+    if (i == classes.end())
+    {
+        classes.emplace_back(upnp_class);
+        class_documents.emplace_back();
+        i = classes.end() - 1;
+    }
+
+    document.upnp_class = uint8_t(i - classes.begin());
+
+    const uint32_t id = uint32_t(documents.size());
+    class_documents[document.upnp_class].push_back(id);
+    for (int f = 0; f < num_fields; f++)
+        for (auto &word : split_words(document.text[f]))
+        {
+            auto &ids = words[f][word];
+            if (ids.empty() || (ids.back() != id))
+                ids.push_back(id);
+        }
+
+    documents.emplace_back(std::move(document));
+    document_ids[path] = id;
+}
+
+void search_index::remove(const std::string &path)
+{
+    if (!path.empty() && (path[path.length() - 1] == '/'))
+    {
+        for (auto &i : documents)
+            if (!i.removed && starts_with(i.path, path))
+            {
+                i.removed = true;
+                document_ids.erase(i.path);
+                removed++;
+            }
+    }
+    else
+    {
+        auto i = document_ids.find(path);
+        if (i == document_ids.end())
+            return;
+
+        documents[i->second].removed = true;
+        document_ids.erase(i);
+        removed++;
+    }
+
+    if ((removed > 1024) && (removed > (documents.size() / 2)))
+        compact();
+}
+
+void search_index::clear()
+{
+    classes.clear();
+    class_documents.clear();
+    documents.clear();
+    document_ids.clear();
+    for (auto &i : words)
+        i.clear();
+
+    removed = 0;
+}
+
+void search_index::compact()
+{
+    const auto classes = std::move(this->classes);
+    const auto documents = std::move(this->documents);
+    clear();
+
+    for (auto &i : documents)
+        if (!i.removed)
+        {
+            add(i.path,
+                classes[i.upnp_class],
+                i.text[field::title],
+                i.text[field::artist],
+                i.text[field::album]);
+        }
+}
+
+static std::vector<uint32_t> set_union(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b)
+{
+    std::vector<uint32_t> result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+static std::vector<uint32_t> set_intersection(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b)
+{
+    std::vector<uint32_t> result;
+    result.reserve(std::min(a.size(), b.size()));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+static std::vector<uint32_t> set_union(const std::vector<const std::vector<uint32_t> *> &lists)
+{
+    std::vector<uint32_t> result;
+    if (lists.size() <= 4)
+    {
+        for (auto i : lists)
+            result = result.empty() ? *i : set_union(result, *i);
+    }
+    else
+    {
+        for (auto i : lists)
+            result.insert(result.end(), i->begin(), i->end());
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+
+    return result;
+}
+
+static void lower_values(search_criteria &criteria)
+{
+    if (criteria.property != "upnp:class")
+        criteria.value = to_lower(criteria.value);
+
+    for (auto &i : criteria.operands)
+        lower_values(i);
+}
+
+std::vector<std::string> search_index::find(
+        const search_criteria &criteria,
+        const std::string &scope,
+        size_t start, size_t &count) const
+{
+    search_criteria lower = criteria;
+    lower_values(lower);
+
+    std::vector<uint32_t> ids;
+    if (!candidates(lower, ids))
+        ids = all();
+
+    const bool return_all = count == 0;
+    size_t total = 0;
+
+    std::vector<std::string> result;
+    for (auto id : ids)
+    {
+        const auto &document = documents[id];
+        if (!document.removed && starts_with(document.path, scope) && matches(document, lower))
+        {
+            if ((total >= start) && (return_all || (result.size() < count)))
+                result.emplace_back(document.path);
+
+            total++;
+        }
+    }
+
+    count = total;
+    return result;
+}
+
+std::vector<search_index::field> search_index::fields_of(const search_criteria &criteria)
+{
+    std::vector<field> result;
+    if (criteria.property == "dc:title")
+    {
+        result.push_back(field::title);
+
+        // Directory names only take part in word matches.
+        if ((criteria.type == search_criteria::relation::contains) ||
+            (criteria.type == search_criteria::relation::starts_with))
+        {
+            result.push_back(field::path);
+        }
+    }
+    else if ((criteria.property == "upnp:artist") || (criteria.property == "dc:creator"))
+        result.push_back(field::artist);
+    else if (criteria.property == "upnp:album")
+        result.push_back(field::album);
+
+    return result;
+}
+
+bool search_index::candidates(const search_criteria &criteria, std::vector<uint32_t> &result) const
+{
+    switch (criteria.type)
+    {
+    case search_criteria::relation::and_:
+        {
+            bool restricted = false;
+            for (auto &i : criteria.operands)
+            {
+                std::vector<uint32_t> ids;
+                if (candidates(i, ids))
+                {
+                    result = restricted ? set_intersection(result, ids) : std::move(ids);
+                    restricted = true;
+                }
+            }
+
+            return restricted;
+        }
+
+    case search_criteria::relation::or_:
+        result.clear();
+        for (auto &i : criteria.operands)
+        {
+            std::vector<uint32_t> ids;
+            if (!candidates(i, ids))
+                return false;
+
+            result = set_union(result, ids);
+        }
+
+        return true;
+
+    case search_criteria::relation::equals:
+    case search_criteria::relation::contains:
+    case search_criteria::relation::starts_with:
+        if (criteria.property == "upnp:class")
+        {
+            if (criteria.type != search_criteria::relation::equals)
+                return false;
+
+            result = find_class(criteria.value, false);
+            return true;
+        }
+        else
+        {
+            const auto fields = fields_of(criteria);
+            if (fields.empty()) // Unknown properties never match.
+            {
+                result.clear();
+                return true;
+            }
+
+            return find_words(
+                        fields, criteria.value,
+                        criteria.type == search_criteria::relation::contains,
+                        result);
+        }
+
+    case search_criteria::relation::derived_from:
+        if (criteria.property == "upnp:class")
+        {
+            result = find_class(criteria.value, true);
+            return true;
+        }
+
+        return false;
+
+    default:
+        return false;
+    }
+}
+
+bool search_index::find_words(
+        const std::vector<field> &fields,
+        const std::string &value,
+        bool contains,
+        std::vector<uint32_t> &result) const
+{
+    const auto value_words = split_words(value);
+    if (value_words.empty())
+        return false;
+
+    // All words of a value start at the start of a word in the text, except
+    // the first word of a "contains" value, which may start within a word.
+    const bool first_within_word = contains && is_word_char(value[0]);
+
+    for (size_t w = 0; w < value_words.size(); w++)
+    {
+        const auto &word = value_words[w];
+
+        std::vector<const std::vector<uint32_t> *> lists;
+        for (auto f : fields)
+            if ((w == 0) && first_within_word)
+            {
+                for (auto &i : words[f])
+                    if (i.first.find(word) != i.first.npos)
+                        lists.push_back(&i.second);
+            }
+            else for (auto i = words[f].lower_bound(word);
+                      (i != words[f].end()) && starts_with(i->first, word);
+                      i++)
+            {
+                lists.push_back(&i->second);
+            }
+
+        result = (w == 0) ? set_union(lists) : set_intersection(result, set_union(lists));
+    }
+
+    return true;
+}
+
+static bool derived_from(const std::string &upnp_class, const std::string &base)
+{
+    return
+            starts_with(upnp_class, base) &&
+            ((upnp_class.length() == base.length()) || (upnp_class[base.length()] == '.'));
+}
+
+std::vector<uint32_t> search_index::find_class(const std::string &upnp_class, bool derived) const
+{
+    std::vector<const std::vector<uint32_t> *> lists;
+    for (size_t i = 0; i < classes.size(); i++)
+        if (derived ? derived_from(classes[i], upnp_class) : (classes[i] == upnp_class))
+            lists.push_back(&class_documents[i]);
+
+    return set_union(lists);
+}
+
+std::vector<uint32_t> search_index::all() const
+{
+    std::vector<uint32_t> result;
+    result.reserve(documents.size() - removed);
+    for (uint32_t i = 0; i < documents.size(); i++)
+        if (!documents[i].removed)
+            result.push_back(i);
+
+    return result;
+}
+
+static bool compare(search_criteria::relation type, const std::string &text, const std::string &value)
+{
+    switch (type)
+    {
+    case search_criteria::relation::equals:             return text == value;
+    case search_criteria::relation::not_equals:         return text != value;
+    case search_criteria::relation::less:               return text < value;
+    case search_criteria::relation::less_equal:         return text <= value;
+    case search_criteria::relation::greater:            return text > value;
+    case search_criteria::relation::greater_equal:      return text >= value;
+    case search_criteria::relation::contains:           return text.find(value) != text.npos;
+    case search_criteria::relation::does_not_contain:   return text.find(value) == text.npos;
+    case search_criteria::relation::starts_with:        return starts_with(text, value);
+    case search_criteria::relation::derived_from:       return derived_from(text, value);
+    default:                                            return false;
+    }
+}
+
+bool search_index::matches(const document &document, const search_criteria &criteria) const
+{
+    switch (criteria.type)
+    {
+    case search_criteria::relation::all:
+        return true;
+
+    case search_criteria::relation::and_:
+        for (auto &i : criteria.operands)
+            if (!matches(document, i))
+                return false;
+
+        return true;
+
+    case search_criteria::relation::or_:
+        for (auto &i : criteria.operands)
+            if (matches(document, i))
+                return true;
+
+        return false;
+
+    case search_criteria::relation::exists:
+        {
+            bool exists = false;
+            if ((criteria.property == "upnp:class") ||
+                (criteria.property == "dc:title") ||
+                (criteria.property == "res"))
+            {
+                exists = true;
+            }
+            else for (auto f : fields_of(criteria))
+                exists |= !document.text[f].empty();
+
+            return exists == (criteria.value == "true");
+        }
+
+    case search_criteria::relation::not_equals:
+    case search_criteria::relation::does_not_contain:
+        if (criteria.property == "upnp:class")
+            return compare(criteria.type, classes[document.upnp_class], criteria.value);
+
+        for (auto f : fields_of(criteria))
+            if (!compare(criteria.type, document.text[f], criteria.value))
+                return false;
+
+        return true;
+
+    default:
+        if (criteria.property == "upnp:class")
+            return compare(criteria.type, classes[document.upnp_class], criteria.value);
+
+        for (auto f : fields_of(criteria))
+            if (compare(criteria.type, document.text[f], criteria.value))
+                return true;
+
+        return false;
+    }
+}
+
+} // End of namespace
@@ -0,0 +1,114 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef PUPNP_SEARCH_INDEX_H
+#define PUPNP_SEARCH_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pupnp {
+
+/*! A parsed SearchCriteria expression, see section 2.5.5 of the
+    ContentDirectory:1 specification.
+ */
+struct search_criteria
+{
+    enum class relation
+    {
+        all, and_, or_,
+        equals, not_equals, less, less_equal, greater, greater_equal,
+        contains, does_not_contain, derived_from, starts_with, exists
+    };
+
+    search_criteria();
+    ~search_criteria();
+
+    bool parse(const std::string &);
+
+    enum relation type;
+    std::string property;
+    std::string value;
+    std::vector<search_criteria> operands;
+};
+
+/*! An inverted index of the words in the titles, artists, albums and paths
+    of items. The index finds the items with words starting with each of the
+    words in a value, these are then checked against the full criteria. For
+    a "contains" the first word of the value is looked up in all indexed
+    words, as it may start within a word. Titles are matched against the
+    directory names in the path too, as those often hold the name of the
+    series or album.
+ */
+class search_index
+{
+public:
+    search_index();
+    ~search_index();
+
+    static const char capabilities[];
+
+    void add(
+            const std::string &path,
+            const std::string &upnp_class,
+            const std::string &title,
+            const std::string &artist = std::string(),
+            const std::string &album = std::string());
+
+    /*! Removes the item, or all items in the directory if the path ends
+        with a '/'.
+     */
+    void remove(const std::string &path);
+    void clear();
+    size_t size() const { return document_ids.size(); }
+
+    std::vector<std::string> find(const search_criteria &, const std::string &scope, size_t start, size_t &count) const;
+
+private:
+    enum field { title, artist, album, path, num_fields };
+
+    struct document
+    {
+        std::string path;
+        uint8_t upnp_class;
+        bool removed;
+        std::string text[num_fields];
+    };
+
+    static std::vector<field> fields_of(const search_criteria &);
+    bool candidates(const search_criteria &, std::vector<uint32_t> &) const;
+    bool find_words(const std::vector<field> &, const std::string &, bool contains, std::vector<uint32_t> &) const;
+    std::vector<uint32_t> find_class(const std::string &, bool derived) const;
+    std::vector<uint32_t> all() const;
+    bool matches(const document &, const search_criteria &) const;
+    void compact();
+
+private:
+    std::vector<std::string> classes;
+    std::vector<std::vector<uint32_t>> class_documents;
+    std::vector<document> documents;
+    std::unordered_map<std::string, uint32_t> document_ids;
+    std::map<std::string, std::vector<uint32_t>> words[num_fields];
+    size_t removed;
+};
+
+} // End of namespace
+
+#endif
@@ -20,6 +20,8 @@
 #include "platform/string.h"
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <thread>
@@ -60,7 +62,8 @@ upnp::upnp(class platform::messageloop_ref &messageloop)
       update_interfaces_timer(messageloop, std::bind(&upnp::update_interfaces, this)),
       update_interfaces_interval(10),
       clear_responses_timer(messageloop, std::bind(&upnp::clear_responses, this)),
-      clear_responses_interval(15)
+      clear_responses_interval(15),
+      static_files(std::make_shared<std::map<std::string, std::shared_ptr<const static_file>>>())
 {
     assert(me == nullptr);
 
@@ -130,6 +133,185 @@ void upnp::http_callback_unregister(const std::string &path)
         http_callbacks.erase(i);
 }
 
+extern "C" void * tdefl_compress_mem_to_heap(const void *pSrc_buf, size_t src_buf_len, size_t *pOut_len, int flags);
+extern "C" unsigned tdefl_create_comp_flags_from_zip_params(int level, int window_bits, int strategy);
+extern "C" unsigned long mz_crc32(unsigned long crc, const unsigned char *ptr, size_t buf_len);
+extern "C" unsigned long mz_adler32(unsigned long adler, const unsigned char *ptr, size_t buf_len);
+extern "C" void mz_free(void *p);
+
+struct upnp::static_file
+{
+    struct representation
+    {
+        std::string etag;
+        const char *encoding;
+        const char *data;
+        size_t size;
+    };
+
+    const representation & select(const char *accept_encoding) const;
+
+    std::string content_type;
+    std::string gzip_data, deflate_data;
+    representation identity, gzip, deflate;
+};
+
+static bool accepts_encoding(const char *accept_encoding, const char *encoding)
+{
+    const std::string header = to_lower(accept_encoding);
+
+    // An entry for the encoding itself takes precedence over "*".
+    bool wildcard = false;
+    for (size_t pos = 0; pos < header.length(); )
+    {
+        const size_t comma = std::min(header.find_first_of(',', pos), header.length());
+        const std::string token = header.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        const size_t semicolon = token.find_first_of(';');
+        const size_t begin = token.find_first_not_of(" \t");
+        const size_t end = token.find_last_not_of(" \t", semicolon - 1);
+        if ((begin == token.npos) || (end == token.npos) || (end < begin))
+            continue;
+
+        const std::string name = token.substr(begin, end - begin + 1);
+        if ((name == encoding) || (name == "*"))
+        {
+            const size_t q = token.find("q=", semicolon);
+            const bool accepted = (semicolon == token.npos) || (q == token.npos) || (std::strtod(token.c_str() + q + 2, nullptr) > 0.0);
+            if (name == encoding)
+                return accepted;
+
+            wildcard = accepted;
+        }
+    }
+
+    return wildcard;
+}
+
+const upnp::static_file::representation & upnp::static_file::select(const char *accept_encoding) const
+{
+    if ((gzip.size > 0) && accepts_encoding(accept_encoding, "gzip"))
+        return gzip;
+    else if ((deflate.size > 0) && accepts_encoding(accept_encoding, "deflate"))
+        return deflate;
+    else
+        return identity;
+}
+
+namespace {
+
+class static_stream : public std::istream
+{
+public:
+    static_stream(const std::shared_ptr<const void> &owner, const char *data, size_t size)
+        : std::istream(nullptr),
+          owner(owner),
+          buffer(data, size)
+    {
+        rdbuf(&buffer);
+    }
+
+private:
+    class streambuf : public std::streambuf
+    {
+    public:
+        streambuf(const char *data, size_t size)
+        {
+            char * const p = const_cast<char *>(data);
+            setg(p, p, p + size);
+        }
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override
+        {
+            switch (dir)
+            {
+            case std::ios_base::beg: break;
+            case std::ios_base::cur: off += gptr() - eback(); break;
+            case std::ios_base::end: off += egptr() - eback(); break;
+            default: return pos_type(off_type(-1));
+            }
+
+            if ((off < 0) || (off > (egptr() - eback())))
+                return pos_type(off_type(-1));
+
+            setg(eback(), eback() + off, egptr());
+            return pos_type(off);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+    };
+
+    const std::shared_ptr<const void> owner;
+    streambuf buffer;
+};
+
+} // End of namespace
+
+void upnp::http_file_register(const std::string &path, const char *content_type, const char *data, size_t size)
+{
+    const auto file = std::make_shared<static_file>();
+    file->content_type = content_type;
+
+    const unsigned char * const bytes = reinterpret_cast<const unsigned char *>(data);
+    const unsigned long crc = mz_crc32(0, bytes, size);
+    char tag[64];
+    snprintf(tag, sizeof(tag), "\"%08lx-%lx", crc, (unsigned long)size);
+
+    file->identity = static_file::representation { std::string(tag) + '"', "", data, size };
+    file->gzip = file->deflate = static_file::representation { std::string(), "", nullptr, 0 };
+
+    size_t compressed_size = 0;
+    void * const compressed = tdefl_compress_mem_to_heap(
+                data, size, &compressed_size,
+                int(tdefl_create_comp_flags_from_zip_params(9, -15, 0)));
+
+    if (compressed)
+    {
+        // Images are usually compressed already, only use the compressed
+        // data if it is smaller.
+        if ((compressed_size + 32) < size)
+        {
+            static const char gzip_header[] = { '\x1F', '\x8B', '\x08', 0, 0, 0, 0, 0, '\x02', '\xFF' };
+            file->gzip_data.assign(gzip_header, sizeof(gzip_header));
+            file->gzip_data.append(reinterpret_cast<const char *>(compressed), compressed_size);
+            for (unsigned long v : { crc, (unsigned long)size })
+                for (int i = 0; i < 32; i += 8)
+                    file->gzip_data.push_back(char((v >> i) & 0xFF));
+
+            static const char zlib_header[] = { '\x78', '\xDA' };
+            file->deflate_data.assign(zlib_header, sizeof(zlib_header));
+            file->deflate_data.append(reinterpret_cast<const char *>(compressed), compressed_size);
+            const unsigned long adler = mz_adler32(1, bytes, size);
+            for (int i = 24; i >= 0; i -= 8)
+                file->deflate_data.push_back(char((adler >> i) & 0xFF));
+
+            file->identity.encoding = "identity";
+            file->gzip = static_file::representation { std::string(tag) + "-gzip\"", "gzip", file->gzip_data.data(), file->gzip_data.size() };
+            file->deflate = static_file::representation { std::string(tag) + "-deflate\"", "deflate", file->deflate_data.data(), file->deflate_data.size() };
+        }
+
+        mz_free(compressed);
+    }
+
+    auto files = std::make_shared<std::map<std::string, std::shared_ptr<const static_file>>>(*std::atomic_load(&static_files));
+    (*files)[path] = file;
+    std::atomic_store(&static_files, std::shared_ptr<const std::map<std::string, std::shared_ptr<const static_file>>>(files));
+}
+
+std::shared_ptr<const upnp::static_file> upnp::find_static_file(const std::string &path) const
+{
+    const auto files = std::atomic_load(&static_files);
+    auto i = files->find(path.substr(0, path.find_first_of('?')));
+    if (i != files->end())
+        return i->second;
+
+    return nullptr;
+}
+
 bool upnp::initialize(uint16_t port, bool bind_public)
 {
     if (!initialized || ((this->port != port) && (port != 0)) || (this->bind_public != bind_public))
@@ -306,6 +488,21 @@ void upnp::enable_webserver()
     {
         static int get_info(::Request_Info *request_info, const char *url, ::File_Info *info)
         {
+            if (auto file = me->find_static_file(url))
+            {
+                const auto &representation = file->select(request_info->acceptEncoding);
+                info->file_length = representation.size;
+                info->last_modified = 0;
+                info->is_directory = FALSE;
+                info->is_readable = TRUE;
+                info->is_cacheable = TRUE;
+                strncpy(info->etag, representation.etag.c_str(), sizeof(info->etag) - 1);
+                strncpy(info->content_encoding, representation.encoding, sizeof(info->content_encoding) - 1);
+                info->content_type = ::ixmlCloneDOMString(file->content_type.c_str());
+
+                return 0;
+            }
+
             struct request request;
             request.user_agent = request_info->userAgent;
             request.source_address = request_info->sourceAddress;
@@ -316,7 +513,11 @@ void upnp::enable_webserver()
             if (me->get_response(request, content_type, response, false) != http_not_found)
             {
                 info->file_length = -1;
-                if (response)
+                if (auto deferred = std::dynamic_pointer_cast<deferred_stream>(response))
+                {
+                    info->file_length = deferred->length;
+                }
+                else if (response)
                 {
                     auto i = response->tellg();
                     if ((i != decltype(i)(-1)) && response->seekg(0, std::ios_base::end))
@@ -343,6 +544,17 @@ void upnp::enable_webserver()
 
         static ::UpnpWebFileHandle open(::Request_Info *request_info, const char *url, ::UpnpOpenFileMode mode)
         {
+            if (auto file = me->find_static_file(url))
+            {
+                const auto &representation = file->select(request_info->acceptEncoding);
+                std::shared_ptr<std::istream> stream = std::make_shared<static_stream>(file, representation.data, representation.size);
+
+                std::lock_guard<std::mutex> _(me->static_handles_mutex);
+
+                me->static_handles[stream.get()] = stream;
+                return stream.get();
+            }
+
             struct request request;
             request.user_agent = request_info->userAgent;
             request.source_address = request_info->sourceAddress;
@@ -354,10 +566,15 @@ void upnp::enable_webserver()
             {
                 me->messageloop.send([&response]
                 {
-                    me->handles[response.get()] = response;
+                    if (auto deferred = std::dynamic_pointer_cast<deferred_stream>(response))
+                        response = deferred->open();
+
+                    if (response)
+                        me->handles[response.get()] = response;
                 });
 
-                return response.get();
+                if (response)
+                    return response.get();
             }
 
             std::clog << "pupnp::upnp: webserver open(\"" << url << "\") failed" << std::endl;
@@ -402,6 +619,17 @@ void upnp::enable_webserver()
         {
             if (fileHnd)
             {
+                {
+                    std::lock_guard<std::mutex> _(me->static_handles_mutex);
+
+                    auto i = me->static_handles.find(fileHnd);
+                    if (i != me->static_handles.end())
+                    {
+                        me->static_handles.erase(i);
+                        return UPNP_E_SUCCESS;
+                    }
+                }
+
                 me->messageloop.post([fileHnd]
                 {
                     auto i = me->handles.find(fileHnd);
@@ -470,6 +698,23 @@ int upnp::get_response(const struct request &request, std::string &content_type,
 }
 
 
+upnp::deferred_stream::deferred_stream(std::streamoff length, const std::function<std::shared_ptr<std::istream>()> &factory)
+    : std::istream(nullptr),
+      length(length),
+      factory(factory)
+{
+}
+
+upnp::deferred_stream::~deferred_stream()
+{
+}
+
+std::shared_ptr<std::istream> upnp::deferred_stream::open() const
+{
+    return factory();
+}
+
+
 upnp::url::url()
 {
 }
@@ -59,6 +59,24 @@ public:
 
     typedef std::function<int(const request &, std::string &, std::shared_ptr<std::istream> &)> http_callback;
 
+    /*! A response of an http_callback that is only created when the stream
+        is opened, so HEAD requests can be answered without starting a
+        transcode. The length is -1 if it is not known in advance.
+     */
+    class deferred_stream : public std::istream
+    {
+    public:
+        deferred_stream(std::streamoff length, const std::function<std::shared_ptr<std::istream>()> &);
+        ~deferred_stream();
+
+        std::shared_ptr<std::istream> open() const;
+
+        const std::streamoff length;
+
+    private:
+        const std::function<std::shared_ptr<std::istream>()> factory;
+    };
+
     static const int http_ok = 200;
     static const int http_no_content = 204;
     static const int http_not_found = 404;
@@ -78,6 +96,15 @@ public:
     void http_callback_register(const std::string &path, const http_callback &);
     void http_callback_unregister(const std::string &path);
 
+    /*! Registers a file that never changes, like a stylesheet or an icon.
+        The file is compressed once and then served directly from the
+        webserver threads with an ETag, without using the messageloop. The
+        data is not copied and has to stay valid while the upnp object
+        exists. The path has to be in a directory that has an http_callback
+        registered.
+     */
+    void http_file_register(const std::string &path, const char *content_type, const char *data, size_t size);
+
     bool initialize(uint16_t port, bool bind_public = false);
     void close(void);
 
@@ -97,6 +124,9 @@ private:
     void enable_webserver();
     int get_response(const struct request &, std::string &, std::shared_ptr<std::istream> &, bool);
 
+    struct static_file;
+    std::shared_ptr<const static_file> find_static_file(const std::string &path) const;
+
 public:
     static const char             mime_audio_ac3[];
     static const char             mime_audio_lpcm_48000_2[];
@@ -138,6 +168,12 @@ private:
     const std::chrono::seconds clear_responses_interval;
 
     std::map<void *, std::shared_ptr<std::istream>> handles;
+
+    // Replaced as a whole when a file is registered, so the webserver
+    // threads can read it without a lock.
+    std::shared_ptr<const std::map<std::string, std::shared_ptr<const static_file>>> static_files;
+    std::mutex static_handles_mutex;
+    std::map<void *, std::shared_ptr<std::istream>> static_handles;
 };
 
 } // End of namespace
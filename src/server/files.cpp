@@ -38,6 +38,8 @@
 
 using std::chrono::duration_cast;
 
+const std::chrono::milliseconds files::file_changes_delay(500);
+
 files::files(
         class platform::messageloop_ref &messageloop,
         class pupnp::connection_manager &connection_manager,
@@ -45,18 +47,22 @@ files::files(
         class recommended &recommended,
         const class settings &settings,
         class platform::inifile &media_cache_file,
+        class platform::inifile &media_fingerprints_file,
+        class platform::recordfile &media_store_file,
         class platform::inifile &watchlist_file)
     : messageloop(messageloop),
-      media_cache(messageloop, media_cache_file),
+      media_cache(messageloop, media_cache_file, media_fingerprints_file, media_store_file),
       connection_manager(connection_manager),
       content_directory(content_directory),
       recommended(recommended),
       settings(settings),
       watchlist(watchlist_file),
       basedir('/' + tr("Files") + '/'),
-      min_parse_time(3000),
-      max_parse_time(30000),
-      item_parse_time(500)
+      file_changes_timer(messageloop, std::bind(&files::process_file_changes, this)),
+      file_watcher(
+          messageloop,
+          std::bind(&files::file_changed, this, std::placeholders::_1, std::placeholders::_2)),
+      search_index_built(false)
 {
     content_directory.item_source_register(basedir, *this);
     recommended.item_source_register(basedir, *this);
@@ -185,37 +191,67 @@ std::vector<pupnp::content_directory::item> files::list_contentdir_items(
         const std::string &client,
         const std::string &path,
         size_t start, size_t &count)
+{
+    return list_sorted_contentdir_items(client, path, std::vector<pupnp::content_directory::sort_criterion>(), start, count);
+}
+
+std::vector<pupnp::content_directory::item> files::list_sorted_contentdir_items(
+        const std::string &client,
+        const std::string &path,
+        const std::vector<pupnp::content_directory::sort_criterion> &sort_criteria,
+        size_t start, size_t &count)
 {
     const bool return_all = count == 0;
-    const auto &files = list_files(path, start == 0);
+    const auto listing = list_files(path, start == 0);
+    const auto order = sort_order(path, listing, sort_criteria);
+    const auto &files = listing->files;
 
+    // Only the requested items are made.
     std::vector<std::string> paths;
-    for (auto &file : files)
-        if (return_all || (count > 0))
-        {
-            if (start == 0)
-            {
-                paths.emplace_back(path + file);
+    for (size_t i = start; (i < files.size()) && (return_all || (paths.size() < count)); i++)
+        paths.emplace_back(path + files[order ? (*order)[i] : i]);
 
-                if (count > 0)
-                    count--;
-            }
-            else
-                start--;
-        }
-        else
-            break;
+    // Files that have not been scanned yet are returned as placeholders, the
+    // renderers are notified to refresh when the background scan finishes.
+    std::vector<std::string> unscanned;
+    for (auto &mrl : scan_files_mrls(paths))
+        if (!media_cache.has_media_info(mrl))
+            unscanned.emplace_back(mrl);
 
-    media_cache.scan_all(scan_files_mrls(paths));
+    if (!unscanned.empty())
+        media_cache.scan_all_async(unscanned, std::bind(&files::media_scanned, this, unscanned, path));
 
     std::vector<pupnp::content_directory::item> result;
     for (auto &path : paths)
-        result.emplace_back(make_item(client, path));
+        result.emplace_back(make_item(client, path, false));
 
     count = files.size();
     return result;
 }
 
+std::vector<pupnp::content_directory::item> files::search_contentdir_items(
+        const std::string &client,
+        const std::string &path,
+        const pupnp::search_criteria &criteria,
+        size_t start, size_t &count)
+{
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        if (!search_index_built)
+            build_search_index();
+
+        paths = search_index.find(criteria, path, start, count);
+    }
+
+    std::vector<pupnp::content_directory::item> result;
+    for (auto &i : paths)
+        result.emplace_back(make_item(client, i, false));
+
+    return result;
+}
+
 std::vector<pupnp::content_directory::item> files::list_recommended_items(
         const std::string &client,
         size_t start, size_t &count)
@@ -261,7 +297,7 @@ std::vector<pupnp::content_directory::item> files::list_recommended_items(
         std::string last_path;
         double last_score = 0.0;
 
-        for (auto &j : list_files(i, false))
+        for (auto &j : list_files(i, false)->files)
         {
             std::string full_path = i + j, file_path, track_name;
             split_path(full_path, file_path, track_name);
@@ -303,7 +339,20 @@ std::vector<pupnp::content_directory::item> files::list_recommended_items(
                 start--;
         }
 
-    media_cache.scan_all(scan_files_mrls(paths));
+    const auto mrls = scan_files_mrls(paths);
+    media_cache.scan_all(mrls);
+
+    std::vector<vlc::media_type> media_types;
+    for (auto &mrl : mrls)
+        media_types.emplace_back(media_cache.media_type(mrl));
+
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        if (search_index_built)
+            for (size_t i = 0; i < mrls.size(); i++)
+                index_media(mrls[i], media_types[i]);
+    }
 
     std::vector<pupnp::content_directory::item> result;
     for (auto &path : paths)
@@ -343,6 +392,17 @@ static void min_scale(const std::string &codec, unsigned srcw, unsigned srch, un
     }
 }
 
+bool files::cache_contentdir_items(const std::string &)
+{
+    // Changes to the listings are reported with update_path().
+    return true;
+}
+
+bool files::concurrent_contentdir_items()
+{
+    return true;
+}
+
 bool files::correct_protocol(const pupnp::content_directory::item &item, pupnp::connection_manager::protocol &protocol)
 {
     if ((settings.canvas_mode() == canvas_mode::none) || item.is_image())
@@ -368,8 +428,6 @@ int files::play_audio_video_item(
         std::string &content_type,
         std::shared_ptr<std::istream> &response)
 {
-    using namespace std::placeholders;
-
     std::ostringstream transcode;
     if (!protocol.audio_codec.empty() || !protocol.video_codec.empty())
     {
@@ -456,12 +514,31 @@ int files::play_audio_video_item(
     if (item.chapter > 0)               opt << "@C" << item.chapter;
     else if (item.position.count() > 0) opt << "@" << item.position.count();
 
+    // The stream is only created when it is opened, so HEAD requests do not
+    // start a transcode.
+    response = std::make_shared<pupnp::upnp::deferred_stream>(
+                -1,
+                std::bind(&files::open_audio_video_stream, this, source_address, item, protocol, transcode.str(), opt.str()));
+
+    content_type = protocol.content_format;
+    return pupnp::upnp::http_ok;
+}
+
+std::shared_ptr<std::istream> files::open_audio_video_stream(
+        const std::string &source_address,
+        const pupnp::content_directory::item &item,
+        const pupnp::connection_manager::protocol &protocol,
+        const std::string &transcode,
+        const std::string &opt)
+{
+    using namespace std::placeholders;
+
     // First try to attach to an already running stream.
-    response = connection_manager.try_attach_output_connection(protocol, item.mrl, source_address, opt.str());
+    std::shared_ptr<std::istream> response = connection_manager.try_attach_output_connection(protocol, item.mrl, source_address, opt);
     if (!response)
     {
         std::clog << "files: creating new stream " << item.mrl
-                  << " transcode=" << transcode.str()
+                  << " transcode=" << transcode
                   << " mux=" << protocol.mux << std::endl;
 
         std::unique_ptr<vlc::transcode_stream> stream(
@@ -517,15 +594,17 @@ int files::play_audio_video_item(
 
         const std::string vlc_mux = (protocol.mux == "m2ts") ? "ts" : protocol.mux;
 
-        if (stream->open(item.mrl, transcode.str(), vlc_mux))
+        if (stream->open(item.mrl, transcode, vlc_mux))
         {
             std::shared_ptr<pupnp::connection_proxy> proxy;
             if (protocol.mux == "ps")
             {
                 std::unique_ptr<mpeg::ps_filter> filter(new mpeg::ps_filter(std::move(stream)));
+                auto &ps_filter = *filter;
                 proxy = std::make_shared<pupnp::connection_proxy>(
                             std::move(filter),
-                            protocol.data_rate());
+                            protocol.data_rate(),
+                            [&ps_filter] { return ps_filter.take_random_access_points(); });
             }
             else if (protocol.mux == "m2ts")
             {
@@ -541,18 +620,12 @@ int files::play_audio_video_item(
                             protocol.data_rate());
             }
 
-            connection_manager.add_output_connection(proxy, protocol, item.mrl, source_address, opt.str());
+            connection_manager.add_output_connection(proxy, protocol, item.mrl, source_address, opt);
             response = proxy;
         }
     }
 
-    if (response)
-    {
-        content_type = protocol.content_format;
-        return pupnp::upnp::http_ok;
-    }
-
-    return pupnp::upnp::http_not_found;
+    return response;
 }
 
 int files::get_image_item(
@@ -724,27 +797,42 @@ static void fill_item(
     }
 }
 
-const std::vector<std::string> & files::list_files(const std::string &path, bool flush_cache)
+std::shared_ptr<struct files::listing> files::list_files(const std::string &path, bool flush_cache)
 {
     static const char dir_prefix = 'D', file_prefix = 'F';
 
-    auto files_cache_item = (!flush_cache) ? files_cache.find(path) : files_cache.end();
-    if (files_cache_item == files_cache.end())
+    // Watched directories are refreshed by file_changed(), so they don't have
+    // to be listed again.
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        if (!flush_cache || (watched_paths.find(path) != watched_paths.end()))
+        {
+            auto files_cache_item = files_cache.find(path);
+            if (files_cache_item != files_cache.end())
+                return files_cache_item->second;
+        }
+    }
+
+    // The directory is listed without holding the mutex, two threads may list
+    // the same directory at the same time.
+    auto listing = std::make_shared<struct listing>();
+    bool watched = false;
     {
-        std::multimap<std::string, std::string, alphanum_less> files;
+        std::vector<std::pair<std::string, std::string>> files;
         if (path == basedir)
         {
             for (auto &i : settings.root_paths())
             {
                 const auto name = root_path_name(i.path) + '/';
-                files.insert(std::make_pair(dir_prefix + to_lower(name), name));
+                files.emplace_back(dir_prefix + alphanum_key(to_lower(name)), name);
             }
 
             if (settings.share_removable_media())
                 for (auto &i : platform::list_removable_media())
                 {
                     const auto name = root_path_name(i) + '/';
-                    files.insert(std::make_pair(dir_prefix + to_lower(name), name));
+                    files.emplace_back(dir_prefix + alphanum_key(to_lower(name)), name);
                 }
         }
         else if (starts_with(path, basedir))
@@ -755,40 +843,343 @@ const std::vector<std::string> & files::list_files(const std::string &path, bool
                 auto mrl = platform::mrl_from_path(system_path.path);
 
                 for (auto &track : list_tracks(media_cache.media_info(mrl)))
-                    files.insert(std::make_pair(file_prefix + to_lower(track.first), track.first));
+                    files.emplace_back(file_prefix + alphanum_key(to_lower(track.first)), track.first);
             }
             else
             {
                 const auto system_path = to_system_path(path).path;
+                media_cache.flush_subtitle_index(system_path);
+
+                // Subdirectories are watched too, as they may be shown as the
+                // single file they contain.
+                watched = file_watcher.watch(system_path);
+                std::vector<std::string> dirs, dir_paths;
                 for (auto &i : platform::list_files(system_path))
                 {
                     if (ends_with(i, "/"))
                     {
-                        const auto children = platform::list_files(
-                                    system_path + i,
-                                    platform::file_filter::large_files,
-                                    2);
-
-                        if ((children.size() == 1) && !ends_with(children.front(), "/"))
-                            files.insert(std::make_pair(file_prefix + to_lower(children.front()), i + children.front()));
-                        else if (children.size() > 0)
-                            files.insert(std::make_pair(dir_prefix + to_lower(i), i));
+                        media_cache.flush_subtitle_index(system_path + i);
+                        watched &= file_watcher.watch(system_path + i);
+
+                        dirs.emplace_back(i);
+                        dir_paths.emplace_back(system_path + i);
                     }
                     else
-                        files.insert(std::make_pair(file_prefix + to_lower(i), i));
+                        files.emplace_back(file_prefix + alphanum_key(to_lower(i)), i);
+                }
+
+                const auto children = platform::list_files(
+                            dir_paths,
+                            platform::file_filter::large_files,
+                            2);
+
+                for (size_t i = 0; i < dirs.size(); i++)
+                {
+                    if ((children[i].size() == 1) && !ends_with(children[i].front(), "/"))
+                        files.emplace_back(file_prefix + alphanum_key(to_lower(children[i].front())), dirs[i] + children[i].front());
+                    else if (children[i].size() > 0)
+                        files.emplace_back(dir_prefix + alphanum_key(to_lower(dirs[i])), dirs[i]);
                 }
             }
         }
 
-        std::vector<std::string> sorted_files;
+        std::stable_sort(
+                    files.begin(), files.end(),
+                    [](const std::pair<std::string, std::string> &a, const std::pair<std::string, std::string> &b)
+                    {
+                        return a.first < b.first;
+                    });
+
+        listing->files.reserve(files.size());
+        listing->sort_keys.reserve(files.size());
         for (auto &i : files)
-            sorted_files.emplace_back(std::move(i.second));
+        {
+            listing->sort_keys.emplace_back(std::move(i.first));
+            listing->files.emplace_back(std::move(i.second));
+        }
+    }
+
+    std::lock_guard<std::mutex> _(mutex);
+
+    if (watched)
+        watched_paths.insert(path);
+    else
+        watched_paths.erase(path);
+
+    files_cache[path] = listing;
+    return listing;
+}
+
+std::shared_ptr<const std::vector<uint32_t>> files::sort_order(
+        const std::string &path,
+        const std::shared_ptr<struct listing> &listing,
+        const std::vector<pupnp::content_directory::sort_criterion> &sort_criteria)
+{
+    if (sort_criteria.empty())
+        return nullptr;
+
+    std::string name;
+    for (auto &i : sort_criteria)
+        name += std::string(i.ascending ? "+" : "-") + std::to_string(int(i.property));
+
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        auto sort_order = listing->sort_orders.find(name);
+        if (sort_order != listing->sort_orders.end())
+            return sort_order->second;
+    }
+
+    // The listing is not modified after it is made, so it can be sorted
+    // without holding the mutex.
+    const auto &files = listing->files;
+
+    // Numeric keys are gathered once for each property, titles are
+    // compared on the sort keys without the directory prefix.
+    std::vector<std::vector<int64_t>> keys(sort_criteria.size());
+    for (size_t c = 0; c < sort_criteria.size(); c++)
+        switch (sort_criteria[c].property)
+        {
+        case pupnp::content_directory::sort_property::title:
+            break;
+
+        case pupnp::content_directory::sort_property::date:
+            keys[c].resize(files.size(), 0);
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                struct platform::file_stat file_stat;
+                if (platform::stat_file(to_system_path(path + files[i]).path, file_stat))
+                    keys[c][i] = file_stat.mtime;
+            }
+
+            break;
+
+        case pupnp::content_directory::sort_property::duration:
+            keys[c].resize(files.size(), 0);
+            for (size_t i = 0; i < files.size(); i++)
+                if (!ends_with(files[i], "/") && !ends_with(path, "//"))
+                {
+                    const auto mrl = platform::mrl_from_path(to_system_path(path + files[i]).path);
+                    if (media_cache.has_media_info(mrl))
+                        keys[c][i] = media_cache.media_info(mrl).duration.count();
+                }
+
+            break;
+
+        case pupnp::content_directory::sort_property::track:
+            // The track number is taken from the start of the name.
+            keys[c].resize(files.size(), 0);
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                const auto &file = files[i];
+                const size_t sl = file.find_last_of('/', file.length() - 2);
+                const size_t start = (sl != file.npos) ? (sl + 1) : 0;
+                keys[c][i] = std::strtoll(file.c_str() + start, nullptr, 10);
+            }
+
+            break;
+        }
+
+    auto order = std::make_shared<std::vector<uint32_t>>(files.size());
+    for (size_t i = 0; i < order->size(); i++)
+        (*order)[i] = uint32_t(i);
+
+    std::stable_sort(
+                order->begin(), order->end(),
+                [&sort_criteria, &keys, &listing](uint32_t a, uint32_t b)
+                {
+                    for (size_t c = 0; c < sort_criteria.size(); c++)
+                    {
+                        int result = 0;
+                        if (sort_criteria[c].property == pupnp::content_directory::sort_property::title)
+                            result = listing->sort_keys[a].compare(1, std::string::npos, listing->sort_keys[b], 1, std::string::npos);
+                        else if (keys[c][a] != keys[c][b])
+                            result = (keys[c][a] < keys[c][b]) ? -1 : 1;
+
+                        if (result != 0)
+                            return sort_criteria[c].ascending ? (result < 0) : (result > 0);
+                    }
+
+                    return false;
+                });
+
+    std::lock_guard<std::mutex> _(mutex);
+
+    listing->sort_orders[name] = order;
+    return order;
+}
+
+void files::file_changed(const std::string &dir, const std::string &name)
+{
+    if (!dir.empty())
+    {
+        file_changes[dir].insert(name);
+    }
+    else // Events were lost.
+    {
+        std::vector<std::string> paths;
+        {
+            std::lock_guard<std::mutex> _(mutex);
+
+            for (auto &i : files_cache)
+                paths.emplace_back(i.first);
+
+            files_cache.clear();
+            search_index_built = false;
+        }
+
+        for (auto &i : paths)
+            content_directory.update_path(i);
+
+        file_changes.clear();
+    }
+
+    // Changes are collected for a while, as copying many files into a
+    // directory produces an event for each of them.
+    if (!file_changes.empty())
+        file_changes_timer.start(file_changes_delay, true);
+}
+
+void files::process_file_changes()
+{
+    const auto changes = std::move(file_changes);
+    file_changes.clear();
+
+    for (auto &i : changes)
+    {
+        const auto &dir = i.first;
+        const auto virtual_path = to_virtual_path(dir);
+        if (virtual_path.empty())
+            continue;
+
+        media_cache.flush_subtitle_index(dir);
+
+        // The parent directory may show this directory as the single file it
+        // contains.
+        const size_t psl = virtual_path.find_last_of('/', virtual_path.length() - 2);
+        const auto parent = ((psl != virtual_path.npos) && (psl >= basedir.length()))
+                ? virtual_path.substr(0, psl + 1)
+                : std::string();
+
+        const bool removed = i.second.find(std::string()) != i.second.end();
+        bool index_built;
+        {
+            std::lock_guard<std::mutex> _(mutex);
+
+            files_cache.erase(virtual_path);
+            if (!parent.empty())
+                files_cache.erase(parent);
+
+            if (removed)
+            {
+                // The directory itself was removed or moved.
+                watched_paths.erase(virtual_path);
+                search_index.remove(virtual_path);
+            }
+
+            index_built = search_index_built;
+        }
+
+        content_directory.update_path(virtual_path);
+        if (!parent.empty())
+            content_directory.update_path(parent);
+
+        if (removed)
+            continue;
+
+        std::vector<std::string> changed;
+        for (auto &name : i.second)
+            if (!ends_with(name, "/"))
+            {
+                media_cache.flush_uuid(platform::mrl_from_path(dir + name));
+                changed.emplace_back(name);
+            }
+
+        if (!changed.empty())
+        {
+            std::lock_guard<std::mutex> _(mutex);
+
+            for (auto &name : changed)
+                files_cache.erase(virtual_path + name + "//");
+        }
+
+        if (!changed.empty() || index_built)
+        {
+            const auto listing = list_files(virtual_path, true);
+            const auto &files = listing->files;
+
+            // Removed files are dropped from the search index, new files are
+            // added once they are scanned.
+            {
+                std::lock_guard<std::mutex> _(mutex);
+
+                for (auto &name : i.second)
+                    if (std::find(files.begin(), files.end(), name) == files.end())
+                        search_index.remove(virtual_path + name);
+            }
+
+            // Only queue files that are shown in the listing, other files
+            // are too small or not media files.
+            std::vector<std::string> paths;
+            for (auto &name : changed)
+                if (std::find(files.begin(), files.end(), name) != files.end())
+                    paths.emplace_back(virtual_path + name);
+
+            const auto mrls = scan_files_mrls(paths);
+            if (!mrls.empty())
+                media_cache.scan_all_async(mrls, std::bind(&files::media_scanned, this, mrls, virtual_path));
+        }
+    }
+}
+
+void files::media_scanned(const std::vector<std::string> &mrls, const std::string &path)
+{
+    std::vector<std::pair<std::string, vlc::media_type>> media;
+    for (auto &mrl : mrls)
+        if (media_cache.has_media_info(mrl))
+            media.emplace_back(mrl, media_cache.media_type(mrl));
+
+    {
+        std::lock_guard<std::mutex> _(mutex);
+
+        if (search_index_built)
+            for (auto &i : media)
+                index_media(i.first, i.second);
 
-        files_cache[path] = std::move(sorted_files);
-        files_cache_item = files_cache.find(path);
+        // The durations of the scanned files are known now.
+        auto listing = files_cache.find(path);
+        if (listing != files_cache.end())
+            listing->second->sort_orders.clear();
     }
 
-    return files_cache_item->second;
+    content_directory.update_path(path);
+}
+
+// The mutex is held by the caller.
+void files::build_search_index()
+{
+    search_index.clear();
+    for (auto &i : media_cache.list_media())
+        index_media(i.first, i.second);
+
+    search_index_built = true;
+}
+
+// The mutex is held by the caller.
+void files::index_media(const std::string &mrl, vlc::media_type media_type)
+{
+    const auto path = to_virtual_path(platform::path_from_mrl(mrl));
+    if (path.empty())
+        return;
+
+    const auto title = path.substr(path.find_last_of('/') + 1);
+    switch (media_type)
+    {
+    case vlc::media_type::unknown:  search_index.remove(path); break;
+    case vlc::media_type::audio:    search_index.add(path, "object.item.audioItem", title); break;
+    case vlc::media_type::video:    search_index.add(path, "object.item.videoItem", title); break;
+    case vlc::media_type::picture:  search_index.add(path, "object.item.imageItem", title); break;
+    }
 }
 
 std::vector<std::string> files::scan_files_mrls(
@@ -809,7 +1200,7 @@ std::vector<std::string> files::scan_files_mrls(
     return std::move(result);
 }
 
-pupnp::content_directory::item files::make_item(const std::string &client, const std::string &path) const
+pupnp::content_directory::item files::make_item(const std::string &client, const std::string &path, bool scan) const
 {
     std::string file_path, track_name;
     split_path(path, file_path, track_name);
@@ -831,6 +1222,8 @@ pupnp::content_directory::item files::make_item(const std::string &client, const
 
         const auto system_path = to_system_path(file_path);
         auto mrl = platform::mrl_from_path(system_path.path);
+        if (!scan && !media_cache.has_media_info(mrl))
+            return item;
 
         const auto media_type = media_cache.media_type(mrl);
         if (media_type != vlc::media_type::unknown)
@@ -915,6 +1308,7 @@ void files::playback_position_changed(
         std::chrono::system_clock::time_point started,
         std::chrono::milliseconds time)
 {
+    std::chrono::milliseconds last_position(-1);
     if (time.count() >= 0)
     {
         static const int increment = 15000;
@@ -922,11 +1316,28 @@ void files::playback_position_changed(
 
         const auto rounded = ((time.count() / increment) * increment);
         if (rounded > delay)
+            last_position = std::chrono::milliseconds(rounded - delay);
+    }
+    else // finished
+        last_position = item.duration;
+
+    if (last_position.count() >= 0)
+    {
+        const bool changed = watchlist.watched_item(item.uuid).last_position != last_position;
+        watchlist.set_watched_item(item.uuid, watchlist::entry { started, last_position, item.duration, item.mrl });
+
+        // The resume items and watched markers of the item change, also in the
+        // parent directory if the directory is shown as a single file.
+        if (changed)
         {
-            const std::chrono::milliseconds time(rounded - delay);
-            watchlist.set_watched_item(item.uuid, watchlist::entry { started, time, item.duration, item.mrl });
+            std::string file_path, track_name;
+            split_path(item.path, file_path, track_name);
+            std::string dir = file_path.substr(0, file_path.find_last_of('/') + 1);
+            const size_t psl = dir.find_last_of('/', dir.length() - 2);
+            if ((psl != dir.npos) && (psl >= basedir.length()))
+                dir = dir.substr(0, psl + 1);
+
+            messageloop.post([this, dir] { content_directory.flush_cache(dir); });
         }
     }
-    else // finished
-        watchlist.set_watched_item(item.uuid, watchlist::entry { started, item.duration, item.duration, item.mrl });
 }
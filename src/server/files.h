@@ -19,16 +19,22 @@
 #define FILES_H
 
 #include "recommended.h"
+#include "platform/file_watcher.h"
 #include "platform/messageloop.h"
 #include "pupnp/connection_manager.h"
 #include "pupnp/connection_proxy.h"
 #include "pupnp/content_directory.h"
+#include "pupnp/search_index.h"
 #include "vlc/media_cache.h"
 #include "settings.h"
 #include "watchlist.h"
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 class watchlist;
@@ -45,13 +51,19 @@ public:
             class recommended &recommended,
             const class settings &,
             class platform::inifile &media_cache_file,
+            class platform::inifile &media_fingerprints_file,
+            class platform::recordfile &media_store_file,
             class platform::inifile &watchlist_file);
 
     virtual ~files();
 
 private: // From content_directory::item_source
     std::vector<pupnp::content_directory::item> list_contentdir_items(const std::string &client, const std::string &path, size_t start, size_t &count) override;
+    std::vector<pupnp::content_directory::item> list_sorted_contentdir_items(const std::string &client, const std::string &path, const std::vector<pupnp::content_directory::sort_criterion> &, size_t start, size_t &count) override;
+    std::vector<pupnp::content_directory::item> search_contentdir_items(const std::string &client, const std::string &path, const pupnp::search_criteria &, size_t start, size_t &count) override;
     pupnp::content_directory::item get_contentdir_item(const std::string &client, const std::string &path) override;
+    bool cache_contentdir_items(const std::string &path) override;
+    bool concurrent_contentdir_items() override;
     bool correct_protocol(const pupnp::content_directory::item &, pupnp::connection_manager::protocol &) override;
     int play_item(const std::string &, const pupnp::content_directory::item &, const std::string &, std::string &, std::shared_ptr<std::istream> &) override;
 
@@ -59,12 +71,21 @@ private: // From recommended::item_source
     std::vector<pupnp::content_directory::item> list_recommended_items(const std::string &client, size_t start, size_t &count) override;
 
 private:
-    const std::vector<std::string> & list_files(const std::string &, bool flush_cache);
+    struct listing;
+    std::shared_ptr<struct listing> list_files(const std::string &, bool flush_cache);
+    std::shared_ptr<const std::vector<uint32_t>> sort_order(const std::string &, const std::shared_ptr<struct listing> &, const std::vector<pupnp::content_directory::sort_criterion> &);
     std::vector<std::string> scan_files_mrls(const std::vector<std::string> &) const;
-    pupnp::content_directory::item make_item(const std::string &, const std::string &) const;
+    pupnp::content_directory::item make_item(const std::string &, const std::string &, bool scan = true) const;
     root_path to_system_path(const std::string &) const;
     std::string to_virtual_path(const std::string &) const;
 
+    void file_changed(const std::string &dir, const std::string &name);
+    void process_file_changes();
+    void media_scanned(const std::vector<std::string> &mrls, const std::string &path);
+
+    void build_search_index();
+    void index_media(const std::string &mrl, vlc::media_type);
+
     int play_audio_video_item(
             const std::string &source_address,
             const pupnp::content_directory::item &,
@@ -72,6 +93,13 @@ private:
             std::string &content_type,
             std::shared_ptr<std::istream> &response);
 
+    std::shared_ptr<std::istream> open_audio_video_stream(
+            const std::string &source_address,
+            const pupnp::content_directory::item &,
+            const pupnp::connection_manager::protocol &,
+            const std::string &transcode,
+            const std::string &opt);
+
     int get_image_item(
             const std::string &source_address,
             const pupnp::content_directory::item &,
@@ -93,11 +121,34 @@ private:
     const class settings &settings;
     class watchlist watchlist;
     const std::string basedir;
-    const std::chrono::milliseconds min_parse_time;
-    const std::chrono::milliseconds max_parse_time;
-    const std::chrono::milliseconds item_parse_time;
 
-    std::map<std::string, std::vector<std::string>> files_cache;
+    // Browse and Search are handled on multiple threads, the mutex guards the
+    // listings and the search index. It is not held while directories are
+    // listed or files are scanned.
+    std::mutex mutex;
+
+    // The sort keys are the alphanum_key() of each file, prefixed to list
+    // directories first. The files and sort keys do not change once the
+    // listing is cached. The sort orders hold the indices of the files for
+    // each requested SortCriteria.
+    struct listing
+    {
+        std::vector<std::string> files, sort_keys;
+        std::map<std::string, std::shared_ptr<const std::vector<uint32_t>>> sort_orders;
+    };
+
+    std::map<std::string, std::shared_ptr<struct listing>> files_cache;
+    std::unordered_set<std::string> watched_paths;
+
+    static const std::chrono::milliseconds file_changes_delay;
+    std::map<std::string, std::set<std::string>> file_changes;
+    class platform::timer file_changes_timer;
+    class platform::file_watcher file_watcher;
+
+    // Built on the first search, and then kept up to date as files are
+    // scanned or removed.
+    pupnp::search_index search_index;
+    bool search_index_built;
 };
 
 #endif
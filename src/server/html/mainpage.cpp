@@ -105,12 +105,12 @@ void mainpage::remove_page(const std::string &path)
 
 void mainpage::add_file(const std::string &path, const struct file &file)
 {
-    files[path] = file;
+    upnp.http_file_register(path, file.content_type, file.data, file.size);
 }
 
 void mainpage::add_file(const std::string &path, const struct bin_file &file)
 {
-    files[path] = reinterpret_cast<const struct file &>(file);
+    upnp.http_file_register(path, file.content_type, reinterpret_cast<const char *>(file.data), file.size);
 }
 
 int mainpage::handle_http_request(const struct pupnp::upnp::request &request, std::string &content_type, std::shared_ptr<std::istream> &response)
@@ -124,14 +124,6 @@ int mainpage::handle_http_request(const struct pupnp::upnp::request &request, st
         return render_page(request, content_type, *stream, page->second);
     }
 
-    auto file = files.find(request.url.path);
-    if (file != files.end())
-    {
-        content_type = file->second.content_type;
-        response = std::make_shared<std::stringstream>(std::string(file->second.data, file->second.size));
-        return pupnp::upnp::http_ok;
-    }
-
     if (request.url.path == "/quit")
     {
         messageloop.stop(0);
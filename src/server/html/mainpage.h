@@ -87,7 +87,6 @@ private:
 
     std::map<std::string, page> pages;
     std::list<std::string> page_order;
-    std::map<std::string, file> files;
 };
 
 } // End of namespace
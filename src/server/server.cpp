@@ -32,15 +32,20 @@ server::server(
         class pupnp::upnp &upnp,
         const std::string &logfilename,
         class platform::inifile &media_cache_file,
-        class platform::inifile &watchlist_file)
+        class platform::inifile &media_fingerprints_file,
+        class platform::recordfile &media_store_file,
+        class platform::inifile &watchlist_file,
+        class platform::inifile &objectids_file)
     : messageloop(messageloop),
       settings(settings),
       media_cache_file(media_cache_file),
+      media_fingerprints_file(media_fingerprints_file),
+      media_store_file(media_store_file),
       watchlist_file(watchlist_file),
       upnp(upnp),
       rootdevice(messageloop, upnp, settings.uuid(), "urn:schemas-upnp-org:device:MediaServer:1"),
       connection_manager(messageloop, rootdevice),
-      content_directory(messageloop, upnp, rootdevice, connection_manager),
+      content_directory(messageloop, upnp, rootdevice, connection_manager, objectids_file),
       mediareceiver_registrar(messageloop, rootdevice),
       files(),
       setup(),
@@ -93,6 +98,8 @@ bool server::initialize()
                             *recommended,
                             settings,
                             media_cache_file,
+                            media_fingerprints_file,
+                            media_store_file,
                             watchlist_file));
 
             setup.reset(new class setup(
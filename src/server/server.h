@@ -27,6 +27,7 @@
 #include "html/settingspage.h"
 #include "html/setuppage.h"
 #include "platform/messageloop.h"
+#include "platform/recordfile.h"
 #include "pupnp/connection_manager.h"
 #include "pupnp/content_directory.h"
 #include "pupnp/mediareceiver_registrar.h"
@@ -69,7 +70,10 @@ public:
             class pupnp::upnp &,
             const std::string &,
             class platform::inifile &media_cache_file,
-            class platform::inifile &watchlist_file);
+            class platform::inifile &media_fingerprints_file,
+            class platform::recordfile &media_store_file,
+            class platform::inifile &watchlist_file,
+            class platform::inifile &objectids_file);
 
     ~server();
 
@@ -90,6 +94,8 @@ private:
     class platform::messageloop_ref messageloop;
     class settings &settings;
     class platform::inifile &media_cache_file;
+    class platform::inifile &media_fingerprints_file;
+    class platform::recordfile &media_store_file;
     class platform::inifile &watchlist_file;
 
     class pupnp::upnp &upnp;
@@ -282,63 +282,77 @@ int test::play_item(
         if (item.chapter > 0)               opt << "@C" << item.chapter;
         else if (item.position.count() > 0) opt << "@" << item.position.count();
 
-        // First try to attach to an already running stream.
-        response = connection_manager.try_attach_output_connection(protocol, item.mrl, source_address, opt.str());
-        if (!response)
-        {
-            std::clog << "test: creating new stream " << item.mrl << " transcode=" << transcode.str() << " mux=" << protocol.mux << std::endl;
+        // The stream is only created when it is opened, so HEAD requests do
+        // not start a transcode.
+        response = std::make_shared<pupnp::upnp::deferred_stream>(
+                    -1,
+                    std::bind(&test::open_stream, this, source_address, item, protocol, transcode.str(), opt.str(), rate));
+
+        content_type = protocol.content_format;
+        return pupnp::upnp::http_ok;
+    }
 
-            std::unique_ptr<vlc::transcode_stream> stream(
-                        new vlc::transcode_stream(messageloop));
-            stream->add_option(":input-slave=" + platform::mrl_from_path(a440hz_mp2));
+    return pupnp::upnp::http_not_found;
+}
 
-            const std::string vlc_mux = (protocol.mux == "m2ts") ? "ts" : protocol.mux;
+std::shared_ptr<std::istream> test::open_stream(
+        const std::string &source_address,
+        const pupnp::content_directory::item &item,
+        const pupnp::connection_manager::protocol &protocol,
+        const std::string &transcode,
+        const std::string &opt,
+        float rate)
+{
+    // First try to attach to an already running stream.
+    std::shared_ptr<std::istream> response = connection_manager.try_attach_output_connection(protocol, item.mrl, source_address, opt);
+    if (!response)
+    {
+        std::clog << "test: creating new stream " << item.mrl << " transcode=" << transcode << " mux=" << protocol.mux << std::endl;
 
-            if (item.chapter > 0)
-                stream->set_chapter(item.chapter);
-            else if (item.position.count() > 0)
-                stream->set_position(item.position);
+        std::unique_ptr<vlc::transcode_stream> stream(
+                    new vlc::transcode_stream(messageloop));
+        stream->add_option(":input-slave=" + platform::mrl_from_path(a440hz_mp2));
 
-            struct vlc::track_ids track_ids;
-            stream->set_track_ids(track_ids);
+        const std::string vlc_mux = (protocol.mux == "m2ts") ? "ts" : protocol.mux;
 
-            stream->on_end_reached = [this, item] { items.insert(item.path); };
+        if (item.chapter > 0)
+            stream->set_chapter(item.chapter);
+        else if (item.position.count() > 0)
+            stream->set_position(item.position);
 
-            if (stream->open(item.mrl, transcode.str(), vlc_mux, rate))
-            {
-                std::shared_ptr<pupnp::connection_proxy> proxy;
-                if (protocol.mux == "ps")
-                {
-                    std::unique_ptr<mpeg::ps_filter> filter(new mpeg::ps_filter(std::move(stream)));
-                    proxy = std::make_shared<pupnp::connection_proxy>(
-                                std::move(filter),
-                                protocol.data_rate());
-                }
-                else if (protocol.mux == "m2ts")
-                {
-                    std::unique_ptr<mpeg::m2ts_filter> filter(new mpeg::m2ts_filter(std::move(stream)));
-                    proxy = std::make_shared<pupnp::connection_proxy>(
-                                std::move(filter),
-                                protocol.data_rate());
-                }
-                else
-                {
-                    proxy = std::make_shared<pupnp::connection_proxy>(
-                                std::move(stream),
-                                protocol.data_rate());
-                }
+        struct vlc::track_ids track_ids;
+        stream->set_track_ids(track_ids);
 
-                connection_manager.add_output_connection(proxy, protocol, item.mrl, source_address, opt.str());
-                response = proxy;
-            }
-        }
+        stream->on_end_reached = [this, item] { items.insert(item.path); };
 
-        if (response)
+        if (stream->open(item.mrl, transcode, vlc_mux, rate))
         {
-            content_type = protocol.content_format;
-            return pupnp::upnp::http_ok;
+            std::shared_ptr<pupnp::connection_proxy> proxy;
+            if (protocol.mux == "ps")
+            {
+                std::unique_ptr<mpeg::ps_filter> filter(new mpeg::ps_filter(std::move(stream)));
+                proxy = std::make_shared<pupnp::connection_proxy>(
+                            std::move(filter),
+                            protocol.data_rate());
+            }
+            else if (protocol.mux == "m2ts")
+            {
+                std::unique_ptr<mpeg::m2ts_filter> filter(new mpeg::m2ts_filter(std::move(stream)));
+                proxy = std::make_shared<pupnp::connection_proxy>(
+                            std::move(filter),
+                            protocol.data_rate());
+            }
+            else
+            {
+                proxy = std::make_shared<pupnp::connection_proxy>(
+                            std::move(stream),
+                            protocol.data_rate());
+            }
+
+            connection_manager.add_output_connection(proxy, protocol, item.mrl, source_address, opt);
+            response = proxy;
         }
     }
 
-    return pupnp::upnp::http_not_found;
+    return response;
 }
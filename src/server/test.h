@@ -51,6 +51,15 @@ private: // From content_directory::item_source
   bool correct_protocol(const pupnp::content_directory::item &, pupnp::connection_manager::protocol &) override;
   int play_item(const std::string &, const pupnp::content_directory::item &, const std::string &, std::string &, std::shared_ptr<std::istream> &) override;
 
+private:
+  std::shared_ptr<std::istream> open_stream(
+          const std::string &source_address,
+          const pupnp::content_directory::item &,
+          const pupnp::connection_manager::protocol &,
+          const std::string &transcode,
+          const std::string &opt,
+          float rate);
+
 private:
   class platform::messageloop_ref messageloop;
   class pupnp::connection_manager &connection_manager;
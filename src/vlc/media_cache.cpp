@@ -18,6 +18,7 @@
 #include "vlc/media_cache.h"
 #include "vlc/instance.h"
 #include "vlc/media.h"
+#include "vlc/media_probe.h"
 #include "vlc/subtitles.h"
 #include "platform/fstream.h"
 #include "platform/path.h"
@@ -26,6 +27,7 @@
 #include <vlc/vlc.h>
 #include <vlc/libvlc_version.h>
 #include <cstring>
+#include <iostream>
 #include <mutex>
 #include <queue>
 #include <sstream>
@@ -33,31 +35,92 @@
 namespace vlc {
 
 static const char revision_name[] = "rev_2";
+static const uint32_t store_revision = 3;
+static const char quarantine_name[] = "quarantine";
+static const char fingerprints_name[] = "fingerprints";
+static const size_t process_window = 2;
 
 platform::process::function_handle media_cache::scan_all_function =
         platform::process::register_function(&media_cache::scan_all_process);
 
 media_cache::media_cache(
         class platform::messageloop_ref &messageloop,
-        class platform::inifile &inifile)
+        class platform::inifile &inifile,
+        class platform::inifile &fingerprint_file,
+        class platform::recordfile &store)
     : messageloop(messageloop),
-      section(inifile.open_section(revision_name)),
+      store(store),
+      info_cache_size(1024),
+      cache_hits(0),
+      cache_misses(0),
+      max_subtitle_indexes(256),
+      quarantine(inifile.open_section(quarantine_name)),
+      fingerprint_section(fingerprint_file.open_section(fingerprints_name)),
       stop_process_pool_timer(
           this->messageloop,
           std::bind(&media_cache::stop_process_pool, this)),
-      process_pool_timeout(15)
+      process_pool_timeout(15),
+      max_parse_time(30000),
+      scan_thread_stop(false)
 {
+    if (store.version() != store_revision)
+    {
+        store.clear(store_revision);
+
+        // Import the media info stored by previous versions.
+        const auto section = inifile.open_section(revision_name);
+        for (auto &uuid : section.names())
+        {
+            std::istringstream str(section.read(uuid));
+
+            struct media_info media_info;
+            if (str >> media_info)
+                write_record(uuid, media_info);
+        }
+    }
+
     for (auto &i : inifile.sections())
-        if (i != revision_name)
+        if (i != quarantine_name)
             inifile.erase_section(i);
 
+    for (auto &i : fingerprint_file.sections())
+        if (i != fingerprints_name)
+            fingerprint_file.erase_section(i);
+
+    // Load the whole index at once; the names are stored in the same order, so
+    // this reads the section sequentially.
+    for (auto &mrl : fingerprint_section.names())
+    {
+        std::istringstream str(fingerprint_section.read(mrl));
+
+        struct fingerprint fingerprint;
+        if (str >> fingerprint.file_stat.device >> fingerprint.file_stat.inode
+                >> fingerprint.file_stat.size >> fingerprint.file_stat.mtime
+                >> fingerprint.uuid)
+        {
+            fingerprints[mrl] = fingerprint;
+        }
+    }
+
     process_pool.resize(std::max(
                             platform::process::hardware_concurrency(),
                             1u));
+
+    scan_thread = std::thread(&media_cache::process_scan_queue, this);
 }
 
 media_cache::~media_cache()
 {
+    {
+        std::lock_guard<std::mutex> _(scan_queue_mutex);
+
+        scan_thread_stop = true;
+        scan_queue.clear();
+        scan_queue_condition.notify_one();
+    }
+
+    scan_thread.join();
+
     stop_process_pool();
 }
 
@@ -129,15 +192,70 @@ static platform::uuid uuid_from_file(const std::string &path)
 
 platform::uuid media_cache::uuid(const std::string &mrl)
 {
-    auto i = uuids.find(mrl);
-    if (i == uuids.end())
     {
-        const auto uuid = uuid_from_file(platform::path_from_mrl(mrl));
-        uuids[mrl] = uuid;
-        return uuid;
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        auto i = uuids.find(mrl);
+        if (i != uuids.end())
+            return i->second;
+    }
+
+    platform::uuid uuid;
+    if (!uuid_from_index(mrl, uuid))
+    {
+        uuid = uuid_from_file(platform::path_from_mrl(mrl));
+        index_uuid(mrl, uuid);
+    }
+
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    uuids[mrl] = uuid;
+    return uuid;
+}
+
+bool media_cache::uuid_from_index(const std::string &mrl, platform::uuid &uuid)
+{
+    struct fingerprint fingerprint;
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        auto i = fingerprints.find(mrl);
+        if (i == fingerprints.end())
+            return false;
+
+        fingerprint = i->second;
+    }
+
+    struct platform::file_stat file_stat;
+    if (platform::stat_file(platform::path_from_mrl(mrl), file_stat) &&
+        (file_stat.device == fingerprint.file_stat.device) &&
+        (file_stat.inode == fingerprint.file_stat.inode) &&
+        (file_stat.size == fingerprint.file_stat.size) &&
+        (file_stat.mtime == fingerprint.file_stat.mtime))
+    {
+        uuid = fingerprint.uuid;
+        return true;
+    }
+
+    return false;
+}
+
+void media_cache::index_uuid(const std::string &mrl, const platform::uuid &uuid)
+{
+    struct fingerprint fingerprint;
+    fingerprint.uuid = uuid;
+    if (!uuid.is_null() && platform::stat_file(platform::path_from_mrl(mrl), fingerprint.file_stat))
+    {
+        std::ostringstream str;
+        str << fingerprint.file_stat.device << ' ' << fingerprint.file_stat.inode << ' '
+            << fingerprint.file_stat.size << ' ' << fingerprint.file_stat.mtime << ' '
+            << fingerprint.uuid;
+
+        fingerprint_section.write(mrl, str.str());
+
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+        fingerprints[mrl] = fingerprint;
     }
-    else
-        return i->second;
 }
 
 static bool should_read_media_info_from_player(const std::string &path)
@@ -414,12 +532,13 @@ struct media_cache::media_info media_cache::subtitle_info(const std::string &pat
     const auto uuid = this->uuid(mrl);
 
     struct media_info media_info;
-    if (section.has_value(uuid))
+    bool found;
     {
-        std::stringstream str(section.read(uuid));
-        str >> media_info;
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+        found = read_record(uuid, media_info);
     }
-    else
+
+    if (!found)
     {
         struct track track;
         track.type = track_type::text;
@@ -433,9 +552,8 @@ struct media_cache::media_info media_cache::subtitle_info(const std::string &pat
 
         media_info.tracks.push_back(track);
 
-        std::ostringstream str;
-        str << media_info;
-        section.write(uuid, str.str());
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+        write_record(uuid, media_info);
     }
 
     for (auto &track : media_info.tracks)
@@ -475,9 +593,18 @@ int media_cache::scan_all_process(platform::process &process)
         {
             for (; !mrls.empty(); mrls.pop())
             {
-                auto media = media::from_mrl(instance, mrls.front());
-                process << mrls.front() << ' ' << std::flush
-                        << media_info_from_media(media) << std::endl;
+                process << mrls.front() << ' ' << std::flush;
+
+                struct media_info media_info;
+                if (probe_media_info(platform::path_from_mrl(mrls.front()), media_info))
+                {
+                    process << media_info << std::endl;
+                }
+                else
+                {
+                    auto media = media::from_mrl(instance, mrls.front());
+                    process << media_info_from_media(media) << std::endl;
+                }
             }
 
             process << "(done)" << std::endl;
@@ -493,6 +620,14 @@ int media_cache::scan_all_process(platform::process &process)
 
 void media_cache::stop_process_pool()
 {
+    std::unique_lock<std::mutex> l(process_pool_mutex, std::try_to_lock);
+    if (!l.owns_lock())
+    {
+        // The scan thread is still using the pool, try again later.
+        stop_process_pool_timer.start(process_pool_timeout, true);
+        return;
+    }
+
     for (auto &i : process_pool)
         if (i != nullptr)
         {
@@ -529,11 +664,118 @@ platform::process & media_cache::get_process_from_pool(unsigned index)
     return *process;
 }
 
-void media_cache::process_tasks(
+// Runs the tasks on a number of workers; each worker has up to window tasks in
+// flight and pulls the next task as soon as one finishes, so a single slow
+// task does not hold up the tasks behind it. Tasks are removed from the set
+// when they finish. A worker that spends more than timeout on one task is
+// aborted and the task is moved to timed_out. A task that crashes its worker
+// is dropped, other tasks in flight on a failed worker are left in the set.
+static void dispatch_tasks(
+        size_t num_workers, size_t window,
+        std::chrono::milliseconds timeout,
+        std::set<std::string> &tasks,
+        const std::function<bool(size_t, const std::string &)> &send,
+        const std::function<bool(size_t)> &receive,
+        const std::function<void(size_t)> &abort,
+        std::set<std::string> &timed_out)
+{
+    struct worker_state
+    {
+        std::string task;
+        std::chrono::steady_clock::time_point started;
+        std::string aborted_task;
+    };
+
+    std::mutex mutex;
+    std::condition_variable state_changed;
+    std::vector<worker_state> state(num_workers);
+    size_t running = num_workers;
+    auto next = tasks.begin();
+
+    auto worker = [&](size_t index)
+    {
+        std::deque<std::string> in_flight;
+        std::unique_lock<std::mutex> l(mutex);
+        for (bool ok = true; ok; )
+        {
+            while ((in_flight.size() < window) && (next != tasks.end()))
+            {
+                auto task = *next++;
+                l.unlock();
+                ok = send(index, task);
+                l.lock();
+
+                if (ok)
+                    in_flight.emplace_back(std::move(task));
+                else
+                    break;
+            }
+
+            if (!ok || in_flight.empty())
+                break;
+
+            if (state[index].task != in_flight.front())
+            {
+                state[index].task = in_flight.front();
+                state[index].started = std::chrono::steady_clock::now();
+                state_changed.notify_one();
+            }
+
+            l.unlock();
+            ok = receive(index);
+            l.lock();
+
+            if (ok || state[index].aborted_task.empty())
+                tasks.erase(in_flight.front());
+            else if (state[index].aborted_task == in_flight.front())
+            {
+                tasks.erase(in_flight.front());
+                timed_out.insert(in_flight.front());
+            }
+
+            in_flight.pop_front();
+        }
+
+        state[index].task.clear();
+        running--;
+        state_changed.notify_one();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_workers; i++)
+        threads.emplace_back(worker, i);
+
+    std::unique_lock<std::mutex> l(mutex);
+    while (running > 0)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        auto deadline = now + timeout;
+        for (size_t i = 0; i < state.size(); i++)
+            if (!state[i].task.empty() && state[i].aborted_task.empty())
+            {
+                if (now >= (state[i].started + timeout))
+                {
+                    state[i].aborted_task = state[i].task;
+                    abort(i);
+                }
+                else
+                    deadline = std::min(deadline, state[i].started + timeout);
+            }
+
+        state_changed.wait_until(l, deadline);
+    }
+
+    l.unlock();
+    for (auto &i : threads)
+        i.join();
+}
+
+std::set<std::string> media_cache::process_tasks(
         std::set<std::string> &tasks,
         const std::string &action,
         const std::function<void(platform::process &, const std::string &)> &f)
 {
+    std::set<std::string> timed_out;
     while (!tasks.empty())
     {
         std::vector<platform::process *> pool;
@@ -541,129 +783,663 @@ void media_cache::process_tasks(
         for (size_t i = 0; i < pool.size(); i++)
             pool[i] = &get_process_from_pool(i);
 
-        unsigned count = 0;
-        for (auto i = tasks.begin(); i != tasks.end(); i++)
-            *pool[count++ % pool.size()] << *i << std::endl;
-
-        for (auto &i : pool)
-            *i << action << std::endl;
-
-        for (bool done = false; !done; )
+        const auto send = [&pool, &action](size_t i, const std::string &mrl)
         {
-            done = true;
+            *pool[i] << mrl << '\n' << action << std::endl;
+            return bool(*pool[i]);
+        };
 
-            for (auto &i : pool)
+        std::mutex mutex;
+        const auto receive = [&pool, &mutex, &f](size_t i)
+        {
+            for (;;)
             {
-                if (i && *i)
-                {
-                    std::string mrl;
-                    *i >> mrl;
-                    if (!mrl.empty() && (mrl != "(done)"))
-                    {
-                        tasks.erase(mrl);
-
-                        f(*i, mrl);
-
-                        done = false;
-                        continue;
-                    }
-                }
+                std::string mrl;
+                *pool[i] >> mrl;
+                if (mrl.empty())
+                    return false;
+                else if (mrl == "(done)")
+                    return true;
 
-                i = nullptr;
+                std::lock_guard<std::mutex> _(mutex);
+                f(*pool[i], mrl);
             }
-        }
+        };
+
+        // The process is restarted by get_process_from_pool().
+        const auto abort = [&pool](size_t i)
+        {
+            pool[i]->send_kill();
+        };
+
+        dispatch_tasks(
+                    pool.size(), process_window, max_parse_time,
+                    tasks,
+                    send, receive, abort,
+                    timed_out);
     }
+
+    return timed_out;
 }
 
 void media_cache::scan_all(const std::vector<std::string> &mrls)
 {
+    std::lock_guard<std::mutex> _(process_pool_mutex);
+
     std::set<std::string> tasks;
 
     // Compute UUIDs.
     for (auto &mrl : mrls)
     {
-        auto i = uuids.find(mrl);
-        if (i == uuids.end())
-            tasks.insert(mrl);
+        bool known;
+        {
+            std::lock_guard<std::recursive_mutex> _(cache_mutex);
+            known = uuids.find(mrl) != uuids.end();
+        }
+
+        if (!known && !is_quarantined(mrl))
+        {
+            platform::uuid uuid;
+            if (uuid_from_index(mrl, uuid))
+            {
+                std::lock_guard<std::recursive_mutex> _(cache_mutex);
+                uuids[mrl] = uuid;
+            }
+            else
+                tasks.insert(mrl);
+        }
     }
 
-    process_tasks(tasks, "uuid", [this](
+    quarantine_files(process_tasks(tasks, "uuid", [this](
                   platform::process &process,
                   const std::string &mrl)
     {
         platform::uuid uuid;
         if (process >> uuid)
+        {
+            index_uuid(mrl, uuid);
+
+            std::lock_guard<std::recursive_mutex> _(cache_mutex);
             uuids[mrl] = uuid;
-    });
+        }
+    }));
 
     // Scan files.
     for (auto &mrl : mrls)
     {
-        auto i = uuids.find(mrl);
-        if ((i != uuids.end()) && !section.has_value(i->second))
+        bool scan;
+        {
+            std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+            auto i = uuids.find(mrl);
+            scan = (i != uuids.end()) && !store.has_record(i->second);
+        }
+
+        if (scan && !is_quarantined(mrl))
             tasks.insert(mrl);
     }
 
-    process_tasks(tasks, "scan", [this](
+    quarantine_files(process_tasks(tasks, "scan", [this](
                   platform::process &process,
                   const std::string &mrl)
     {
         struct media_info media_info;
         if (process >> media_info)
         {
+            std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
             auto i = uuids.find(mrl);
             if (i != uuids.end())
+                write_record(i->second, media_info);
+        }
+    }));
+}
+
+void media_cache::scan_all_async(
+        const std::vector<std::string> &mrls,
+        const std::function<void()> &on_finished)
+{
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    std::set<std::string> batch, uuid_tasks, scan_tasks;
+    for (auto &mrl : mrls)
+        if (!has_media_info(mrl))
+        {
+            batch.insert(mrl);
+            if (scan_pending.insert(mrl).second)
+            {
+                if (uuids.find(mrl) == uuids.end())
+                    uuid_tasks.insert(mrl);
+                else
+                    scan_tasks.insert(mrl);
+            }
+        }
+
+    if (!batch.empty())
+    {
+        scan_batches.emplace_back(scan_batch { std::move(batch), on_finished });
+
+        queue_scan_tasks("uuid", uuid_tasks);
+        queue_scan_tasks("scan", scan_tasks);
+    }
+    else if (on_finished)
+        messageloop.post(on_finished);
+}
+
+bool media_cache::has_media_info(const std::string &mrl)
+{
+    platform::uuid uuid;
+    bool known;
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        auto i = uuids.find(mrl);
+        known = i != uuids.end();
+        if (known)
+            uuid = i->second;
+    }
+
+    if (!known && uuid_from_index(mrl, uuid))
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+        uuids.insert(std::make_pair(mrl, uuid));
+        known = true;
+    }
+
+    if (known)
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+        if (store.has_record(uuid))
+            return true;
+    }
+
+    // Quarantined files will not get any media info.
+    return is_quarantined(mrl);
+}
+
+bool media_cache::is_quarantined(const std::string &mrl)
+{
+    if (quarantine.has_value(mrl))
+    {
+        struct platform::file_stat file_stat;
+        if (platform::stat_file(platform::path_from_mrl(mrl), file_stat))
+        {
+            std::istringstream str(quarantine.read(mrl));
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            if ((str >> size >> mtime) &&
+                (size == file_stat.size) && (mtime == file_stat.mtime))
+            {
+                return true;
+            }
+        }
+
+        // The file has changed, give it another try.
+        quarantine.erase(mrl);
+    }
+
+    return false;
+}
+
+void media_cache::quarantine_files(const std::set<std::string> &mrls)
+{
+    for (auto &mrl : mrls)
+    {
+        std::clog << "vlc::media_cache: scanning " << mrl
+                  << " took too long, skipping it until it changes." << std::endl;
+
+        struct platform::file_stat file_stat;
+        if (platform::stat_file(platform::path_from_mrl(mrl), file_stat))
+        {
+            std::ostringstream str;
+            str << file_stat.size << ' ' << file_stat.mtime;
+            quarantine.write(mrl, str.str());
+        }
+    }
+}
+
+void media_cache::queue_scan_tasks(
+        const std::string &action,
+        const std::set<std::string> &mrls)
+{
+    // Split in small tasks so a blocking scan_all() does not have to wait long
+    // for the scan thread to release the process pool.
+    const size_t task_size = process_pool.size() * 4;
+
+    std::lock_guard<std::mutex> _(scan_queue_mutex);
+
+    for (auto &mrl : mrls)
+    {
+        if (scan_queue.empty() ||
+            (scan_queue.back().action != action) ||
+            (scan_queue.back().mrls.size() >= task_size))
+        {
+            scan_queue.emplace_back(scan_task { action, std::set<std::string>() });
+        }
+
+        scan_queue.back().mrls.insert(mrl);
+    }
+
+    scan_queue_condition.notify_one();
+}
+
+void media_cache::process_scan_queue()
+{
+    std::unique_lock<std::mutex> l(scan_queue_mutex);
+    while (!scan_thread_stop)
+    {
+        if (!scan_queue.empty())
+        {
+            const auto task = std::move(scan_queue.front());
+            scan_queue.pop_front();
+            l.unlock();
+
+            std::unique_lock<std::mutex> pool_lock(process_pool_mutex);
+
+            auto tasks = task.mrls;
+            if (task.action == "uuid")
             {
-                std::ostringstream str;
-                str << media_info;
-                section.write(i->second, str.str());
+                std::map<std::string, platform::uuid> result;
+                auto timed_out = process_tasks(tasks, task.action, [&result](
+                              platform::process &process,
+                              const std::string &mrl)
+                {
+                    platform::uuid uuid;
+                    if (process >> uuid)
+                        result[mrl] = uuid;
+                });
+
+                messageloop.post(std::bind(
+                                     &media_cache::uuids_scanned, this,
+                                     task.mrls, std::move(result), std::move(timed_out)));
+            }
+            else if (task.action == "scan")
+            {
+                std::map<std::string, struct media_info> result;
+                auto timed_out = process_tasks(tasks, task.action, [&result](
+                              platform::process &process,
+                              const std::string &mrl)
+                {
+                    struct media_info media_info;
+                    if (process >> media_info)
+                        result[mrl] = std::move(media_info);
+                });
+
+                messageloop.post(std::bind(
+                                     &media_cache::media_scanned, this,
+                                     task.mrls, std::move(result), std::move(timed_out)));
             }
+
+            pool_lock.unlock();
+            l.lock();
         }
-    });
+        else
+            scan_queue_condition.wait(l);
+    }
 }
 
-struct media_cache::media_info media_cache::read_info(const std::string &mrl)
+void media_cache::uuids_scanned(
+        const std::set<std::string> &mrls,
+        const std::map<std::string, platform::uuid> &result,
+        const std::set<std::string> &timed_out)
 {
+    quarantine_files(timed_out);
+
+    std::set<std::string> scan_tasks, finished;
+    for (auto &mrl : mrls)
+    {
+        auto i = result.find(mrl);
+        if (i != result.end())
+        {
+            index_uuid(mrl, i->second);
+
+            std::lock_guard<std::recursive_mutex> _(cache_mutex);
+            uuids[mrl] = i->second;
+            if (!store.has_record(i->second))
+            {
+                scan_tasks.insert(mrl);
+                continue;
+            }
+        }
+
+        finished.insert(mrl);
+    }
+
+    queue_scan_tasks("scan", scan_tasks);
+    finish_scan(finished);
+}
+
+void media_cache::media_scanned(
+        const std::set<std::string> &mrls,
+        const std::map<std::string, struct media_info> &result,
+        const std::set<std::string> &timed_out)
+{
+    quarantine_files(timed_out);
+
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        for (auto &i : result)
+        {
+            auto j = uuids.find(i.first);
+            if (j != uuids.end())
+                write_record(j->second, i.second);
+        }
+    }
+
+    finish_scan(mrls);
+}
+
+void media_cache::finish_scan(const std::set<std::string> &mrls)
+{
+    std::vector<std::function<void()>> finished;
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        for (auto &mrl : mrls)
+            scan_pending.erase(mrl);
+
+        for (auto i = scan_batches.begin(); i != scan_batches.end(); )
+        {
+            for (auto &mrl : mrls)
+                i->mrls.erase(mrl);
+
+            if (i->mrls.empty())
+            {
+                if (i->on_finished)
+                    finished.emplace_back(std::move(i->on_finished));
+
+                i = scan_batches.erase(i);
+            }
+            else
+                i++;
+        }
+    }
+
+    // The callbacks are invoked without holding the lock, as they may use
+    // other objects that call back into the cache from other threads.
+    for (auto &i : finished)
+        i();
+}
+
+std::shared_ptr<const struct media_cache::media_info> media_cache::read_info(const std::string &mrl)
+{
+    static const std::shared_ptr<const struct media_info> empty =
+            std::make_shared<const struct media_info>();
+
+    if (is_quarantined(mrl))
+        return empty;
+
     const auto uuid = this->uuid(mrl);
 
-    if (!section.has_value(uuid))
+    bool has_record;
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        auto i = info_cache_index.find(uuid);
+        if (i != info_cache_index.end())
+        {
+            cache_hits++;
+            info_cache.splice(info_cache.begin(), info_cache, i->second);
+            return i->second->second;
+        }
+
+        cache_misses++;
+        has_record = store.has_record(uuid);
+    }
+
+    if (!has_record)
     {
         std::vector<std::string> mrls;
         mrls.push_back(mrl);
         scan_all(mrls);
     }
 
-    std::stringstream str(section.read(uuid));
-    struct media_info media_info;
-    str >> media_info;
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    auto media_info = std::make_shared<struct media_info>();
+    if (!read_record(uuid, *media_info))
+        return empty;
+
+    // Another thread may have read the same record in the meantime.
+    invalidate_info(uuid);
+
+    info_cache.emplace_front(uuid, media_info);
+    info_cache_index[uuid] = info_cache.begin();
+    while (info_cache.size() > info_cache_size)
+    {
+        info_cache_index.erase(info_cache.back().first);
+        info_cache.pop_back();
+    }
 
     return media_info;
 }
 
+void media_cache::invalidate_info(const platform::uuid &uuid)
+{
+    auto i = info_cache_index.find(uuid);
+    if (i != info_cache_index.end())
+    {
+        info_cache.erase(i->second);
+        info_cache_index.erase(i);
+    }
+}
+
+static void put_u32(std::string &data, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        data.push_back(char(value >> (i * 8)));
+}
+
+static void put_string(std::string &data, const std::string &value)
+{
+    put_u32(data, uint32_t(value.size()));
+    data += value;
+}
+
+static bool get_u32(const uint8_t *&data, const uint8_t *end, uint32_t &value)
+{
+    if ((end - data) >= 4)
+    {
+        value = uint32_t(data[0]) | (uint32_t(data[1]) << 8) |
+                (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+
+        data += 4;
+        return true;
+    }
+
+    return false;
+}
+
+static bool get_string(const uint8_t *&data, const uint8_t *end, std::string &value)
+{
+    uint32_t size = 0;
+    if (get_u32(data, end, size) && (uint32_t(end - data) >= size))
+    {
+        value.assign(reinterpret_cast<const char *>(data), size);
+        data += size;
+        return true;
+    }
+
+    return false;
+}
+
+bool media_cache::read_record(const platform::uuid &uuid, struct media_info &media_info) const
+{
+    const auto record = store.read(uuid);
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(record.data());
+    const uint8_t * const end = data + record.size();
+
+    uint32_t duration_low = 0, duration_high = 0, chapter_count = 0, track_count = 0;
+    if (!get_u32(data, end, duration_low) || !get_u32(data, end, duration_high) ||
+        !get_u32(data, end, chapter_count) || !get_u32(data, end, track_count))
+    {
+        return false;
+    }
+
+    media_info.duration = std::chrono::milliseconds((uint64_t(duration_high) << 32) | duration_low);
+    media_info.chapter_count = int(chapter_count);
+    media_info.tracks.clear();
+
+    for (uint32_t i = 0; i < track_count; i++)
+    {
+        struct track track;
+        uint32_t id = 0, type = 0;
+        if (!get_u32(data, end, id) || !get_u32(data, end, type) ||
+            !get_string(data, end, track.language) ||
+            !get_string(data, end, track.description) ||
+            !get_string(data, end, track.text.encoding))
+        {
+            return false;
+        }
+
+        track.id = int(id);
+        track.type = track_type(type);
+        switch (track.type)
+        {
+        case track_type::unknown:
+        case track_type::text:
+            break;
+
+        case track_type::audio:
+            if (!get_u32(data, end, track.audio.sample_rate) ||
+                !get_u32(data, end, track.audio.channels))
+            {
+                return false;
+            }
+
+            break;
+
+        case track_type::video:
+            if (!get_u32(data, end, track.video.width) ||
+                !get_u32(data, end, track.video.height) ||
+                !get_u32(data, end, track.video.frame_rate_num) ||
+                !get_u32(data, end, track.video.frame_rate_den))
+            {
+                return false;
+            }
+
+            break;
+        }
+
+        media_info.tracks.emplace_back(std::move(track));
+    }
+
+    return true;
+}
+
+void media_cache::write_record(const platform::uuid &uuid, const struct media_info &media_info)
+{
+    const uint64_t duration = media_info.duration.count();
+
+    std::string data;
+    put_u32(data, uint32_t(duration));
+    put_u32(data, uint32_t(duration >> 32));
+    put_u32(data, uint32_t(media_info.chapter_count));
+    put_u32(data, uint32_t(media_info.tracks.size()));
+
+    for (auto &track : media_info.tracks)
+    {
+        put_u32(data, uint32_t(track.id));
+        put_u32(data, uint32_t(track.type));
+        put_string(data, track.language);
+        put_string(data, track.description);
+        put_string(data, track.text.encoding);
+
+        switch (track.type)
+        {
+        case track_type::unknown:
+        case track_type::text:
+            break;
+
+        case track_type::audio:
+            put_u32(data, track.audio.sample_rate);
+            put_u32(data, track.audio.channels);
+            break;
+
+        case track_type::video:
+            put_u32(data, track.video.width);
+            put_u32(data, track.video.height);
+            put_u32(data, track.video.frame_rate_num);
+            put_u32(data, track.video.frame_rate_den);
+            break;
+        }
+    }
+
+    store.write(uuid, data);
+    invalidate_info(uuid);
+}
+
 struct media_cache::media_info media_cache::media_info(const std::string &mrl)
 {
-    auto media_info = read_info(mrl);
+    auto media_info = *read_info(mrl);
 
     int max_track_id = -1;
     for (auto &i : media_info.tracks)
         max_track_id = std::max(max_track_id, i.id);
 
-    for (auto &i : subtitles::find_subtitle_files(platform::path_from_mrl(mrl)))
-        for (auto &j : subtitle_info(i).tracks)
-        {
-            j.id = max_track_id + 1;
-            media_info.tracks.push_back(j);
-        }
+    const auto path = platform::path_from_mrl(mrl);
+    const size_t lsl = path.find_last_of('/');
+    if (lsl != path.npos)
+    {
+        const auto index = subtitle_index(path.substr(0, lsl));
+        for (auto &i : index->find_subtitle_files(path.substr(lsl + 1)))
+            for (auto &j : subtitle_info(i).tracks)
+            {
+                j.id = max_track_id + 1;
+                media_info.tracks.push_back(j);
+            }
+    }
 
     return media_info;
 }
 
-enum media_type media_cache::media_type(const std::string &mrl)
+std::shared_ptr<const subtitles::directory_index> media_cache::subtitle_index(const std::string &dir)
+{
+    {
+        std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+        auto i = subtitle_indexes.find(dir);
+        if (i != subtitle_indexes.end())
+            return i->second;
+    }
+
+    // The directory is listed without holding the lock.
+    std::shared_ptr<const subtitles::directory_index> index =
+            std::make_shared<subtitles::directory_index>(dir);
+
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    if (subtitle_indexes.size() >= max_subtitle_indexes)
+        subtitle_indexes.clear();
+
+    subtitle_indexes[dir] = index;
+    return index;
+}
+
+void media_cache::flush_uuid(const std::string &mrl)
+{
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    // The fingerprint is checked again when the UUID is next requested.
+    uuids.erase(mrl);
+}
+
+void media_cache::flush_subtitle_index(const std::string &dir)
+{
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    subtitle_indexes.erase((!dir.empty() && (dir[dir.length() - 1] == '/'))
+                           ? dir.substr(0, dir.length() - 1)
+                           : dir);
+}
+
+static enum media_type media_type_of(const struct media_cache::media_info &media_info)
 {
     vlc::media_type result = vlc::media_type::unknown;
 
     bool has_audio = false, has_video = false;
-    for (auto &i : read_info(mrl).tracks)
+    for (auto &i : media_info.tracks)
         switch (i.type)
         {
         case track_type::unknown:  break;
@@ -682,6 +1458,30 @@ enum media_type media_cache::media_type(const std::string &mrl)
     return result;
 }
 
+enum media_type media_cache::media_type(const std::string &mrl)
+{
+    return media_type_of(*read_info(mrl));
+}
+
+std::vector<std::pair<std::string, enum media_type>> media_cache::list_media() const
+{
+    std::lock_guard<std::recursive_mutex> _(cache_mutex);
+
+    std::vector<std::pair<std::string, enum media_type>> result;
+    for (auto &i : fingerprints)
+    {
+        struct media_info media_info;
+        if (read_record(i.second.uuid, media_info))
+        {
+            const auto media_type = media_type_of(media_info);
+            if (media_type != vlc::media_type::unknown)
+                result.emplace_back(i.first, media_type);
+        }
+    }
+
+    return result;
+}
+
 
 media_cache::track::track()
     : id(0),
@@ -19,13 +19,25 @@
 #define VLC_MEDIA_CACHE_H
 
 #include "media.h"
+#include "subtitles.h"
 #include "platform/inifile.h"
 #include "platform/messageloop.h"
+#include "platform/path.h"
 #include "platform/process.h"
+#include "platform/recordfile.h"
 #include "platform/uuid.h"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 struct libvlc_media_t;
@@ -95,42 +107,119 @@ private:
         struct media_info media_info;
     };
 
+    struct fingerprint
+    {
+        struct platform::file_stat file_stat;
+        platform::uuid uuid;
+    };
+
+    struct scan_task
+    {
+        std::string action;
+        std::set<std::string> mrls;
+    };
+
+    struct scan_batch
+    {
+        std::set<std::string> mrls;
+        std::function<void()> on_finished;
+    };
+
 public:
     media_cache(
             class platform::messageloop_ref &,
-            class platform::inifile &);
+            class platform::inifile &,
+            class platform::inifile &fingerprint_file,
+            class platform::recordfile &);
 
     ~media_cache();
 
     platform::uuid uuid(const std::string &mrl);
     void scan_all(const std::vector<std::string> &);
+    void scan_all_async(const std::vector<std::string> &, const std::function<void()> &on_finished);
+    bool has_media_info(const std::string &mrl);
     struct media_info media_info(const std::string &mrl);
     enum media_type media_type(const std::string &mrl);
 
+    /*! Returns the files with known media info and their media type, without
+        checking if the files still exist.
+     */
+    std::vector<std::pair<std::string, enum media_type>> list_media() const;
+
+    void flush_uuid(const std::string &mrl);
+    void flush_subtitle_index(const std::string &dir);
+
+    size_t info_cache_hits() const { return cache_hits; }
+    size_t info_cache_misses() const { return cache_misses; }
+
 private:
-    struct media_info read_info(const std::string &mrl);
+    std::shared_ptr<const struct media_info> read_info(const std::string &mrl);
+    void invalidate_info(const platform::uuid &);
 
     static int scan_all_process(platform::process &);
     void stop_process_pool();
     platform::process &get_process_from_pool(unsigned);
-    void process_tasks(
+    std::set<std::string> process_tasks(
             std::set<std::string> &,
             const std::string &action,
             const std::function<void(platform::process &, const std::string &)> &);
 
+    void queue_scan_tasks(const std::string &action, const std::set<std::string> &);
+    void process_scan_queue();
+    void uuids_scanned(const std::set<std::string> &, const std::map<std::string, platform::uuid> &, const std::set<std::string> &);
+    void media_scanned(const std::set<std::string> &, const std::map<std::string, struct media_info> &, const std::set<std::string> &);
+    void finish_scan(const std::set<std::string> &);
+
+    bool uuid_from_index(const std::string &mrl, platform::uuid &);
+    void index_uuid(const std::string &mrl, const platform::uuid &);
+
+    bool is_quarantined(const std::string &mrl);
+    void quarantine_files(const std::set<std::string> &);
+
     struct media_info subtitle_info(const std::string &);
+    std::shared_ptr<const subtitles::directory_index> subtitle_index(const std::string &dir);
+    bool read_record(const platform::uuid &, struct media_info &) const;
+    void write_record(const platform::uuid &, const struct media_info &);
 
 private:
     static platform::process::function_handle scan_all_function;
 
     class platform::messageloop_ref messageloop;
 
+    // Guards the UUIDs, store, info cache, subtitle indexes, fingerprints and
+    // pending scans, so the media info can be read from multiple threads. It
+    // is not held while files are read or scanned.
+    mutable std::recursive_mutex cache_mutex;
+
     std::map<std::string, platform::uuid> uuids;
-    class platform::inifile::section section;
+    class platform::recordfile &store;
+
+    typedef std::list<std::pair<platform::uuid, std::shared_ptr<const struct media_info>>> info_list;
+    const size_t info_cache_size;
+    info_list info_cache;
+    std::map<platform::uuid, info_list::iterator> info_cache_index;
+    std::atomic<size_t> cache_hits, cache_misses;
+
+    const size_t max_subtitle_indexes;
+    std::map<std::string, std::shared_ptr<const subtitles::directory_index>> subtitle_indexes;
+    class platform::inifile::section quarantine;
+    class platform::inifile::section fingerprint_section;
+    std::map<std::string, fingerprint> fingerprints;
 
+    std::mutex process_pool_mutex;
     std::vector<std::unique_ptr<platform::process>> process_pool;
     platform::timer stop_process_pool_timer;
     const std::chrono::seconds process_pool_timeout;
+    const std::chrono::milliseconds max_parse_time;
+
+    std::set<std::string> scan_pending;
+    std::list<scan_batch> scan_batches;
+
+    std::mutex scan_queue_mutex;
+    std::condition_variable scan_queue_condition;
+    std::deque<scan_task> scan_queue;
+    bool scan_thread_stop;
+    std::thread scan_thread;
 };
 
 std::ostream & operator<<(std::ostream &, const struct media_cache::track &);
@@ -0,0 +1,1502 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#include "vlc/media_probe.h"
+#include "platform/fstream.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace vlc {
+
+static const size_t probe_size = 4 * 1024 * 1024;
+static const size_t tail_size = 1024 * 1024;
+
+namespace {
+
+class file_reader
+{
+public:
+    explicit file_reader(const std::string &path)
+        : file(path, std::ios_base::binary),
+          file_size(0)
+    {
+        if (file.is_open() && file.seekg(0, std::ios_base::end))
+            file_size = uint64_t(file.tellg());
+    }
+
+    uint64_t size() const { return file_size; }
+
+    std::vector<uint8_t> read(uint64_t offset, size_t size)
+    {
+        std::vector<uint8_t> result;
+        if (offset < file_size)
+        {
+            result.resize(size_t(std::min(uint64_t(size), file_size - offset)));
+
+            file.clear();
+            if (file.seekg(std::streamoff(offset)))
+            {
+                file.read(reinterpret_cast<char *>(result.data()), result.size());
+                result.resize(size_t(file.gcount()));
+            }
+            else
+                result.clear();
+        }
+
+        return result;
+    }
+
+private:
+    platform::ifstream file;
+    uint64_t file_size;
+};
+
+class bit_reader
+{
+public:
+    bit_reader(const uint8_t *data, size_t size)
+        : data(data), size(size), pos(0)
+    {
+    }
+
+    bool eof() const { return pos >= (size * 8); }
+    void skip(unsigned bits) { pos += bits; }
+
+    uint32_t read(unsigned bits)
+    {
+        uint32_t result = 0;
+        for (unsigned i = 0; i < bits; i++, pos++)
+        {
+            result <<= 1;
+            if (pos < (size * 8))
+                result |= (data[pos / 8] >> (7 - (pos % 8))) & 1;
+        }
+
+        return result;
+    }
+
+    uint32_t read_ue()
+    {
+        unsigned zeros = 0;
+        while (!eof() && (read(1) == 0) && (zeros < 31))
+            zeros++;
+
+        return ((1u << zeros) - 1) + read(zeros);
+    }
+
+    int32_t read_se()
+    {
+        const uint32_t value = read_ue();
+        return (value & 1) ? int32_t((value + 1) / 2) : -int32_t(value / 2);
+    }
+
+private:
+    const uint8_t * const data;
+    const size_t size;
+    size_t pos;
+};
+
+} // End of namespace
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t(p[0]) << 8) | uint16_t(p[1]);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+    return (uint64_t(get_u32(p)) << 32) | uint64_t(get_u32(p + 4));
+}
+
+static uint32_t fourcc(const char *name)
+{
+    return get_u32(reinterpret_cast<const uint8_t *>(name));
+}
+
+static void reduce(unsigned &num, unsigned &den)
+{
+    unsigned a = num, b = den;
+    while (b != 0)
+    {
+        const unsigned t = a % b;
+        a = b;
+        b = t;
+    }
+
+    if (a > 1)
+    {
+        num /= a;
+        den /= a;
+    }
+}
+
+static struct media_cache::track audio_track(int id, unsigned sample_rate, unsigned channels)
+{
+    struct media_cache::track track;
+    track.id = id;
+    track.type = track_type::audio;
+    track.audio.sample_rate = sample_rate;
+    track.audio.channels = channels;
+
+    return track;
+}
+
+static struct media_cache::track video_track(int id, unsigned width, unsigned height)
+{
+    struct media_cache::track track;
+    track.id = id;
+    track.type = track_type::video;
+    track.video.width = width;
+    track.video.height = height;
+    track.video.frame_rate_num = 0;
+    track.video.frame_rate_den = 0;
+
+    return track;
+}
+
+static struct media_cache::track text_track(int id)
+{
+    struct media_cache::track track;
+    track.id = id;
+    track.type = track_type::text;
+
+    return track;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Elementary streams
+
+static bool parse_mpeg_video(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    static const unsigned frame_rates[][2] =
+    {
+        { 0, 0 }, { 24000, 1001 }, { 24, 1 }, { 25, 1 }, { 30000, 1001 },
+        { 30, 1 }, { 50, 1 }, { 60000, 1001 }, { 60, 1 }
+    };
+
+    for (size_t i = 0; (i + 8) <= size; i++)
+        if ((data[i] == 0x00) && (data[i + 1] == 0x00) &&
+            (data[i + 2] == 0x01) && (data[i + 3] == 0xB3))
+        {
+            const uint8_t * const p = data + i + 4;
+            const unsigned frame_rate_code = p[3] & 0x0F;
+
+            track = video_track(track.id, (p[0] << 4) | (p[1] >> 4), ((p[1] & 0x0F) << 8) | p[2]);
+            if (frame_rate_code < (sizeof(frame_rates) / sizeof(*frame_rates)))
+            {
+                track.video.frame_rate_num = frame_rates[frame_rate_code][0];
+                track.video.frame_rate_den = frame_rates[frame_rate_code][1];
+            }
+
+            return (track.video.width > 0) && (track.video.height > 0);
+        }
+
+    return false;
+}
+
+static void skip_scaling_list(bit_reader &reader, unsigned size)
+{
+    for (unsigned i = 0, last = 8, next = 8; i < size; i++)
+    {
+        if (next != 0)
+            next = (last + reader.read_se() + 256) % 256;
+
+        last = (next == 0) ? last : next;
+    }
+}
+
+static bool parse_h264_sps(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    bit_reader reader(data, size);
+
+    const unsigned profile_idc = reader.read(8);
+    reader.skip(16); // constraint_set_flags, level_idc
+    reader.read_ue(); // seq_parameter_set_id
+
+    unsigned chroma_format_idc = 1;
+    bool separate_colour_plane = false;
+    switch (profile_idc)
+    {
+    case 44: case 83: case 86: case 100: case 110: case 118:
+    case 122: case 128: case 134: case 135: case 138: case 139: case 244:
+        chroma_format_idc = reader.read_ue();
+        if (chroma_format_idc == 3)
+            separate_colour_plane = reader.read(1) != 0;
+
+        reader.read_ue(); // bit_depth_luma_minus8
+        reader.read_ue(); // bit_depth_chroma_minus8
+        reader.skip(1); // qpprime_y_zero_transform_bypass_flag
+        if (reader.read(1)) // seq_scaling_matrix_present_flag
+            for (unsigned i = 0, n = (chroma_format_idc != 3) ? 8 : 12; i < n; i++)
+                if (reader.read(1))
+                    skip_scaling_list(reader, (i < 6) ? 16 : 64);
+
+        break;
+    }
+
+    reader.read_ue(); // log2_max_frame_num_minus4
+    const unsigned pic_order_cnt_type = reader.read_ue();
+    if (pic_order_cnt_type == 0)
+    {
+        reader.read_ue(); // log2_max_pic_order_cnt_lsb_minus4
+    }
+    else if (pic_order_cnt_type == 1)
+    {
+        reader.skip(1); // delta_pic_order_always_zero_flag
+        reader.read_se(); // offset_for_non_ref_pic
+        reader.read_se(); // offset_for_top_to_bottom_field
+        for (unsigned i = 0, n = reader.read_ue(); (i < n) && !reader.eof(); i++)
+            reader.read_se(); // offset_for_ref_frame
+    }
+
+    reader.read_ue(); // max_num_ref_frames
+    reader.skip(1); // gaps_in_frame_num_value_allowed_flag
+    const unsigned width_in_mbs = reader.read_ue() + 1;
+    const unsigned height_in_map_units = reader.read_ue() + 1;
+    const unsigned frame_mbs_only = reader.read(1);
+    if (!frame_mbs_only)
+        reader.skip(1); // mb_adaptive_frame_field_flag
+
+    reader.skip(1); // direct_8x8_inference_flag
+
+    unsigned width = width_in_mbs * 16;
+    unsigned height = (2 - frame_mbs_only) * height_in_map_units * 16;
+    if (reader.read(1)) // frame_cropping_flag
+    {
+        const unsigned left = reader.read_ue(), right = reader.read_ue();
+        const unsigned top = reader.read_ue(), bottom = reader.read_ue();
+
+        const bool subsampled = (chroma_format_idc != 0) && !separate_colour_plane;
+        const unsigned crop_x = (subsampled && (chroma_format_idc < 3)) ? 2 : 1;
+        const unsigned crop_y = ((subsampled && (chroma_format_idc == 1)) ? 2 : 1) * (2 - frame_mbs_only);
+
+        width -= std::min(width, (left + right) * crop_x);
+        height -= std::min(height, (top + bottom) * crop_y);
+    }
+
+    if (reader.eof() || (width == 0) || (height == 0))
+        return false;
+
+    track = video_track(track.id, width, height);
+
+    if (reader.read(1)) // vui_parameters_present_flag
+    {
+        if (reader.read(1)) // aspect_ratio_info_present_flag
+            if (reader.read(8) == 255) // aspect_ratio_idc == Extended_SAR
+                reader.skip(32);
+
+        if (reader.read(1)) // overscan_info_present_flag
+            reader.skip(1);
+
+        if (reader.read(1)) // video_signal_type_present_flag
+        {
+            reader.skip(4);
+            if (reader.read(1)) // colour_description_present_flag
+                reader.skip(24);
+        }
+
+        if (reader.read(1)) // chroma_loc_info_present_flag
+        {
+            reader.read_ue();
+            reader.read_ue();
+        }
+
+        if (reader.read(1)) // timing_info_present_flag
+        {
+            const unsigned num_units_in_tick = reader.read(32);
+            const unsigned time_scale = reader.read(32);
+            if (!reader.eof() && (num_units_in_tick > 0) && (time_scale > 0))
+            {
+                track.video.frame_rate_num = time_scale;
+                track.video.frame_rate_den = num_units_in_tick * 2;
+                reduce(track.video.frame_rate_num, track.video.frame_rate_den);
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool parse_h264_video(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    for (size_t i = 0; (i + 4) < size; i++)
+        if ((data[i] == 0x00) && (data[i + 1] == 0x00) &&
+            (data[i + 2] == 0x01) && ((data[i + 3] & 0x1F) == 7))
+        {
+            // Remove the emulation prevention bytes.
+            std::vector<uint8_t> rbsp;
+            for (size_t j = i + 4, zeros = 0; (j < size) && (rbsp.size() < 256); j++)
+            {
+                if ((zeros >= 2) && (data[j] == 0x03))
+                {
+                    zeros = 0;
+                    continue;
+                }
+
+                zeros = (data[j] == 0x00) ? (zeros + 1) : 0;
+                rbsp.push_back(data[j]);
+            }
+
+            return parse_h264_sps(rbsp.data(), rbsp.size(), track);
+        }
+
+    return false;
+}
+
+static bool parse_mpeg_audio(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    static const unsigned sample_rates[] = { 44100, 48000, 32000 };
+
+    for (size_t i = 0; (i + 4) <= size; i++)
+        if ((data[i] == 0xFF) && ((data[i + 1] & 0xE0) == 0xE0))
+        {
+            const unsigned version = (data[i + 1] >> 3) & 3;
+            const unsigned layer = (data[i + 1] >> 1) & 3;
+            const unsigned bitrate_index = data[i + 2] >> 4;
+            const unsigned sample_rate_index = (data[i + 2] >> 2) & 3;
+            if ((version != 1) && (layer != 0) && (bitrate_index != 15) && (sample_rate_index != 3))
+            {
+                const unsigned divider = (version == 3) ? 1 : ((version == 2) ? 2 : 4);
+                track = audio_track(
+                            track.id,
+                            sample_rates[sample_rate_index] / divider,
+                            ((data[i + 3] >> 6) == 3) ? 1 : 2);
+
+                return true;
+            }
+        }
+
+    return false;
+}
+
+static bool parse_adts_audio(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    static const unsigned sample_rates[] =
+    {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000,
+        11025, 8000, 7350
+    };
+
+    for (size_t i = 0; (i + 4) <= size; i++)
+        if ((data[i] == 0xFF) && ((data[i + 1] & 0xF6) == 0xF0))
+        {
+            const unsigned sample_rate_index = (data[i + 2] >> 2) & 0x0F;
+            const unsigned channel_config = ((data[i + 2] & 0x01) << 2) | (data[i + 3] >> 6);
+            if ((sample_rate_index < (sizeof(sample_rates) / sizeof(*sample_rates))) &&
+                (channel_config > 0))
+            {
+                track = audio_track(
+                            track.id,
+                            sample_rates[sample_rate_index],
+                            (channel_config == 7) ? 8 : channel_config);
+
+                return true;
+            }
+        }
+
+    return false;
+}
+
+static bool parse_ac3_audio(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    static const unsigned sample_rates[] = { 48000, 44100, 32000 };
+    static const unsigned reduced_sample_rates[] = { 24000, 22050, 16000 };
+    static const unsigned channels[] = { 2, 1, 2, 3, 3, 4, 4, 5 };
+
+    for (size_t i = 0; (i + 8) <= size; i++)
+        if ((data[i] == 0x0B) && (data[i + 1] == 0x77))
+        {
+            const unsigned bsid = data[i + 5] >> 3;
+            if (bsid <= 10) // AC-3
+            {
+                const unsigned fscod = data[i + 4] >> 6;
+                if (fscod < 3)
+                {
+                    bit_reader reader(data + i + 6, 2);
+                    const unsigned acmod = reader.read(3);
+                    if ((acmod & 1) && (acmod != 1)) reader.skip(2); // cmixlev
+                    if (acmod & 4)                   reader.skip(2); // surmixlev
+                    if (acmod == 2)                  reader.skip(2); // dsurmod
+                    const unsigned lfeon = reader.read(1);
+
+                    track = audio_track(track.id, sample_rates[fscod], channels[acmod] + lfeon);
+                    return true;
+                }
+            }
+            else if ((bsid > 10) && (bsid <= 16)) // E-AC-3
+            {
+                bit_reader reader(data + i + 4, 1);
+                const unsigned fscod = reader.read(2);
+                const unsigned fscod2 = reader.read(2);
+                if ((fscod < 3) || (fscod2 < 3))
+                {
+                    const unsigned acmod = reader.read(3);
+                    const unsigned lfeon = reader.read(1);
+
+                    track = audio_track(
+                                track.id,
+                                (fscod < 3) ? sample_rates[fscod] : reduced_sample_rates[fscod2],
+                                channels[acmod] + lfeon);
+
+                    return true;
+                }
+            }
+        }
+
+    return false;
+}
+
+static bool parse_lpcm_audio(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    // DVD LPCM; the header following the substream ID.
+    if (size >= 5)
+    {
+        track = audio_track(
+                    track.id,
+                    ((data[4] >> 4) & 0x03) == 1 ? 96000 : 48000,
+                    (data[4] & 0x07) + 1);
+
+        return true;
+    }
+
+    return false;
+}
+
+// Returns the offset of the payload in a MPEG-1 or MPEG-2 PES packet.
+static size_t pes_payload_offset(const uint8_t *data, size_t size)
+{
+    if ((size >= 9) && ((data[6] & 0xC0) == 0x80)) // MPEG-2
+        return 9 + size_t(data[8]);
+
+    size_t pos = 6; // MPEG-1
+    while ((pos < size) && (data[pos] == 0xFF) && (pos < 22))
+        pos++;
+
+    if ((pos < size) && ((data[pos] & 0xC0) == 0x40))
+        pos += 2;
+
+    if (pos < size)
+    {
+        if ((data[pos] & 0xF0) == 0x20)
+            pos += 5;
+        else if ((data[pos] & 0xF0) == 0x30)
+            pos += 10;
+        else
+            pos++;
+    }
+
+    return pos;
+}
+
+static uint64_t duration_ms(uint64_t first, uint64_t last)
+{
+    static const uint64_t wrap = uint64_t(1) << 33;
+
+    return (((last + wrap) - first) % wrap) / 90;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MPEG Transport Stream
+
+namespace {
+
+struct ts_stream
+{
+    unsigned stream_type;
+    int pid;
+    std::string language;
+    std::vector<uint8_t> registrations;
+    std::vector<uint8_t> descriptors;
+    std::vector<uint8_t> payload;
+    bool started;
+};
+
+} // End of namespace
+
+static const size_t ts_payload_size = 65536;
+
+static bool find_ts_sync(const std::vector<uint8_t> &data, size_t packet_size, size_t &offset)
+{
+    for (offset = 0; offset < packet_size; offset++)
+    {
+        bool found = true;
+        for (size_t i = 0; (i < 5) && found; i++)
+        {
+            const size_t pos = offset + (i * packet_size) + (packet_size - 188);
+            found = (pos < data.size()) && (data[pos] == 0x47);
+        }
+
+        if (found)
+            return true;
+    }
+
+    return false;
+}
+
+static bool read_ts_pcr(const uint8_t *packet, uint64_t &pcr)
+{
+    const unsigned adaptation_field_control = (packet[3] >> 4) & 3;
+    if ((adaptation_field_control & 2) && (packet[4] >= 7) && (packet[5] & 0x10))
+    {
+        pcr = (uint64_t(packet[6]) << 25) | (uint64_t(packet[7]) << 17) |
+              (uint64_t(packet[8]) << 9) | (uint64_t(packet[9]) << 1) |
+              (uint64_t(packet[10]) >> 7);
+
+        return true;
+    }
+
+    return false;
+}
+
+static void parse_ts_descriptors(const uint8_t *data, size_t size, struct ts_stream &stream)
+{
+    for (size_t i = 0; (i + 2) <= size; i += 2 + data[i + 1])
+    {
+        const uint8_t tag = data[i];
+        const size_t length = std::min(size_t(data[i + 1]), size - i - 2);
+        const uint8_t * const payload = data + i + 2;
+
+        stream.descriptors.push_back(tag);
+        if ((tag == 0x0A) && (length >= 3)) // ISO_639_language_descriptor
+            stream.language = std::string(reinterpret_cast<const char *>(payload), 3);
+        else if ((tag == 0x59) && (length >= 3)) // subtitling_descriptor
+        {
+            stream.language = std::string(reinterpret_cast<const char *>(payload), 3);
+            if (length > 8)
+                stream.descriptors.push_back(0xFF); // Multiple subtitles.
+        }
+        else if ((tag == 0x05) && (length >= 4)) // registration_descriptor
+        {
+            if (memcmp(payload, "AC-3", 4) == 0)
+                stream.registrations.push_back(0x6A);
+            else if (memcmp(payload, "EAC3", 4) == 0)
+                stream.registrations.push_back(0x7A);
+        }
+    }
+}
+
+static bool has_descriptor(const struct ts_stream &stream, uint8_t tag)
+{
+    return
+            (std::find(stream.descriptors.begin(), stream.descriptors.end(), tag) != stream.descriptors.end()) ||
+            (std::find(stream.registrations.begin(), stream.registrations.end(), tag) != stream.registrations.end());
+}
+
+static bool parse_ts_stream(const struct ts_stream &stream, struct media_cache::track &track)
+{
+    const uint8_t * const data = stream.payload.data();
+    const size_t size = stream.payload.size();
+
+    bool result = false;
+    track.id = stream.pid;
+    switch (stream.stream_type)
+    {
+    case 0x01: case 0x02:   result = parse_mpeg_video(data, size, track); break;
+    case 0x1B:              result = parse_h264_video(data, size, track); break;
+    case 0x03: case 0x04:   result = parse_mpeg_audio(data, size, track); break;
+    case 0x0F:              result = parse_adts_audio(data, size, track); break;
+    case 0x81: case 0x87:   result = parse_ac3_audio(data, size, track);  break;
+
+    case 0x06: // Private data
+        if (has_descriptor(stream, 0x6A) || has_descriptor(stream, 0x7A))
+            result = parse_ac3_audio(data, size, track);
+        else if (has_descriptor(stream, 0x59) && !has_descriptor(stream, 0xFF))
+        {
+            track = text_track(track.id);
+            result = true;
+        }
+
+        break;
+    }
+
+    track.language = stream.language;
+    return result;
+}
+
+static bool is_ts_data_stream(unsigned stream_type)
+{
+    switch (stream_type)
+    {
+    case 0x05: // Private sections
+    case 0x0A: case 0x0B: case 0x0C: case 0x0D: // DSM-CC
+    case 0x86: // SCTE-35
+        return true;
+    }
+
+    return false;
+}
+
+static bool probe_ts(file_reader &file, struct media_cache::media_info &media_info)
+{
+    const auto head = file.read(0, probe_size);
+    if (head.empty() || (head[0] != 0x47))
+        return false;
+
+    size_t packet_size = 188, offset = 0;
+    if (!find_ts_sync(head, packet_size, offset) || (offset != 0))
+        return false;
+
+    int pmt_pid = -1, pcr_pid = -1;
+    std::map<int, ts_stream> streams;
+    uint64_t first_pcr = 0;
+    bool has_first_pcr = false;
+    for (size_t pos = 0; (pos + packet_size) <= head.size(); pos += packet_size)
+    {
+        const uint8_t * const packet = &head[pos];
+        if (packet[0] != 0x47)
+            return false;
+
+        const int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        const bool unit_start = (packet[1] & 0x40) != 0;
+        const unsigned adaptation_field_control = (packet[3] >> 4) & 3;
+
+        if ((pid == pcr_pid) && !has_first_pcr)
+            has_first_pcr = read_ts_pcr(packet, first_pcr);
+
+        size_t payload = 4;
+        if (adaptation_field_control & 2)
+            payload += 1 + packet[4];
+
+        if (((adaptation_field_control & 1) == 0) || (payload >= 188))
+            continue;
+
+        const uint8_t * const data = packet + payload;
+        const size_t size = 188 - payload;
+
+        if ((pid == 0) && unit_start && (pmt_pid < 0)) // PAT
+        {
+            const size_t section = 1 + data[0];
+            if ((section + 8) > size)
+                return false;
+
+            const size_t length = std::min(size_t(get_u16(data + section + 1) & 0x0FFF), size - section - 3);
+            for (size_t i = section + 8; (i + 4) <= (section + 3 + length - 4); i += 4)
+                if (get_u16(data + i) != 0) // Skip the network PID.
+                {
+                    if (pmt_pid >= 0)
+                        return false; // Multiple programs.
+
+                    pmt_pid = get_u16(data + i + 2) & 0x1FFF;
+                }
+        }
+        else if ((pid == pmt_pid) && unit_start && (pcr_pid < 0)) // PMT
+        {
+            const size_t section = 1 + data[0];
+            if ((section + 12) > size)
+                return false;
+
+            const size_t length = std::min(size_t(get_u16(data + section + 1) & 0x0FFF), size - section - 3);
+            const size_t end = section + 3 + length - 4;
+            pcr_pid = get_u16(data + section + 8) & 0x1FFF;
+
+            size_t i = section + 12 + (get_u16(data + section + 10) & 0x0FFF);
+            while ((i + 5) <= end)
+            {
+                struct ts_stream stream;
+                stream.stream_type = data[i];
+                stream.pid = get_u16(data + i + 1) & 0x1FFF;
+                stream.started = false;
+
+                const size_t info_length = get_u16(data + i + 3) & 0x0FFF;
+                parse_ts_descriptors(data + i + 5, std::min(info_length, end - std::min(end, i + 5)), stream);
+                i += 5 + info_length;
+
+                if (!is_ts_data_stream(stream.stream_type))
+                    streams[stream.pid] = std::move(stream);
+            }
+        }
+        else
+        {
+            auto stream = streams.find(pid);
+            if ((stream != streams.end()) && (stream->second.payload.size() < ts_payload_size))
+            {
+                if (unit_start)
+                {
+                    const size_t offset = pes_payload_offset(data, size);
+                    if (offset < size)
+                    {
+                        stream->second.payload.insert(stream->second.payload.end(), data + offset, data + size);
+                        stream->second.started = true;
+                    }
+                }
+                else if (stream->second.started)
+                    stream->second.payload.insert(stream->second.payload.end(), data, data + size);
+            }
+        }
+    }
+
+    if (streams.empty() || !has_first_pcr)
+        return false;
+
+    for (auto &i : streams)
+    {
+        struct media_cache::track track;
+        if (!parse_ts_stream(i.second, track))
+            return false;
+
+        media_info.tracks.emplace_back(std::move(track));
+    }
+
+    // Find the last PCR.
+    const uint64_t tail_offset = std::max(file.size(), uint64_t(tail_size)) - tail_size;
+    auto tail = file.read(tail_offset, tail_size);
+    if (find_ts_sync(tail, packet_size, offset))
+    {
+        uint64_t last_pcr = first_pcr;
+        for (size_t pos = offset; (pos + packet_size) <= tail.size(); pos += packet_size)
+        {
+            const uint8_t * const packet = &tail[pos];
+            if ((packet[0] == 0x47) && ((((packet[1] & 0x1F) << 8) | packet[2]) == pcr_pid))
+                read_ts_pcr(packet, last_pcr);
+        }
+
+        media_info.duration = std::chrono::milliseconds(duration_ms(first_pcr, last_pcr));
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MPEG Program Stream
+
+static bool read_ps_scr(const uint8_t *data, size_t size, uint64_t &scr)
+{
+    if ((size >= 14) && ((data[4] & 0xC4) == 0x44)) // MPEG-2
+    {
+        scr = (uint64_t(data[4] & 0x38) << 27) | (uint64_t(data[4] & 0x03) << 28) |
+              (uint64_t(data[5]) << 20) | (uint64_t(data[6] & 0xF8) << 12) |
+              (uint64_t(data[6] & 0x03) << 13) | (uint64_t(data[7]) << 5) |
+              (uint64_t(data[8]) >> 3);
+
+        return true;
+    }
+    else if ((size >= 12) && ((data[4] & 0xF1) == 0x21)) // MPEG-1
+    {
+        scr = (uint64_t(data[4] & 0x0E) << 29) | (uint64_t(data[5]) << 22) |
+              (uint64_t(data[6] & 0xFE) << 14) | (uint64_t(data[7]) << 7) |
+              (uint64_t(data[8]) >> 1);
+
+        return true;
+    }
+
+    return false;
+}
+
+static size_t ps_pack_header_size(const uint8_t *data, size_t size)
+{
+    if ((size >= 14) && ((data[4] & 0xC0) == 0x40))
+        return 14 + (data[13] & 0x07);
+    else if ((size >= 12) && ((data[4] & 0xF0) == 0x20))
+        return 12;
+
+    return 0;
+}
+
+static bool parse_ps_stream(int id, const std::vector<uint8_t> &payload, struct media_cache::track &track)
+{
+    const uint8_t * const data = payload.data();
+    const size_t size = payload.size();
+
+    track.id = id;
+    if ((id >= 0xE0) && (id <= 0xEF))
+        return parse_mpeg_video(data, size, track) || parse_h264_video(data, size, track);
+    else if ((id >= 0xC0) && (id <= 0xDF))
+        return parse_mpeg_audio(data, size, track);
+    else if ((id >= 0xBD80) && (id <= 0xBD87))
+        return parse_ac3_audio(data, size, track);
+    else if ((id >= 0xBDA0) && (id <= 0xBDA7))
+        return parse_lpcm_audio(data, size, track);
+    else if ((id >= 0xBD20) && (id <= 0xBD3F))
+    {
+        track = text_track(id);
+        return true;
+    }
+
+    return false;
+}
+
+static bool probe_ps(file_reader &file, struct media_cache::media_info &media_info)
+{
+    const auto head = file.read(0, probe_size);
+    if ((head.size() < 14) ||
+        (head[0] != 0x00) || (head[1] != 0x00) || (head[2] != 0x01) || (head[3] != 0xBA))
+    {
+        return false;
+    }
+
+    uint64_t first_scr = 0;
+    if (!read_ps_scr(head.data(), head.size(), first_scr))
+        return false;
+
+    std::map<int, std::vector<uint8_t>> streams;
+    for (size_t pos = 0; (pos + 6) <= head.size(); )
+    {
+        const uint8_t * const data = &head[pos];
+        if ((data[0] != 0x00) || (data[1] != 0x00) || (data[2] != 0x01))
+        {
+            pos++; // Resynchronize
+            continue;
+        }
+
+        const uint8_t stream_id = data[3];
+        if (stream_id == 0xB9) // End code
+            break;
+        else if (stream_id == 0xBA)
+        {
+            const size_t size = ps_pack_header_size(data, head.size() - pos);
+            pos += std::max(size, size_t(4));
+        }
+        else if (stream_id >= 0xBB)
+        {
+            const size_t size = std::min(6 + size_t(get_u16(data + 4)), head.size() - pos);
+            if ((stream_id == 0xBD) || ((stream_id >= 0xC0) && (stream_id <= 0xEF)))
+            {
+                size_t offset = pes_payload_offset(data, size);
+                if (offset < size)
+                {
+                    int id = stream_id;
+                    if (stream_id == 0xBD)
+                    {
+                        id = 0xBD00 | data[offset];
+                        if ((data[offset] >= 0x80) && (data[offset] <= 0x87))
+                            offset += 4; // AC-3 substream header
+                        else if ((data[offset] >= 0x20) && (data[offset] <= 0x3F))
+                            offset += 1; // Subpicture substream ID
+                    }
+
+                    auto &payload = streams[id];
+                    if (payload.size() < ts_payload_size)
+                        payload.insert(payload.end(), data + std::min(offset, size), data + size);
+                }
+            }
+
+            pos += size;
+        }
+        else
+            pos++;
+    }
+
+    if (streams.empty())
+        return false;
+
+    for (auto &i : streams)
+    {
+        struct media_cache::track track;
+        if (!parse_ps_stream(i.first, i.second, track))
+            return false;
+
+        media_info.tracks.emplace_back(std::move(track));
+    }
+
+    // Find the last SCR.
+    const uint64_t tail_offset = std::max(file.size(), uint64_t(tail_size)) - tail_size;
+    const auto tail = file.read(tail_offset, tail_size);
+    for (size_t i = tail.size(); i >= 14; i--)
+    {
+        const uint8_t * const data = &tail[i - 14];
+        uint64_t last_scr = 0;
+        if ((data[0] == 0x00) && (data[1] == 0x00) && (data[2] == 0x01) && (data[3] == 0xBA) &&
+            read_ps_scr(data, 14, last_scr))
+        {
+            media_info.duration = std::chrono::milliseconds(duration_ms(first_scr, last_scr));
+            break;
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MP4
+
+static void for_each_box(
+        const uint8_t *data, size_t size,
+        const std::function<void(uint32_t, const uint8_t *, size_t)> &f)
+{
+    for (size_t pos = 0; (pos + 8) <= size; )
+    {
+        uint64_t box_size = get_u32(data + pos);
+        const uint32_t type = get_u32(data + pos + 4);
+        size_t header = 8;
+        if (box_size == 1)
+        {
+            if ((pos + 16) > size)
+                break;
+
+            box_size = get_u64(data + pos + 8);
+            header = 16;
+        }
+        else if (box_size == 0)
+            box_size = size - pos;
+
+        if ((box_size < header) || (box_size > (size - pos)))
+            break;
+
+        f(type, data + pos + header, size_t(box_size) - header);
+        pos += size_t(box_size);
+    }
+}
+
+static std::string mp4_language(uint16_t code)
+{
+    std::string result;
+    if (code != 0)
+        for (int i = 2; i >= 0; i--)
+            result += char(((code >> (i * 5)) & 0x1F) + 0x60);
+
+    return result;
+}
+
+static bool parse_mp4_track(const uint8_t *data, size_t size, struct media_cache::track &track)
+{
+    bool valid = true;
+    uint32_t handler = 0, format = 0;
+    uint32_t timescale = 0, sample_count = 0;
+    uint64_t sample_duration = 0;
+    unsigned width = 0, height = 0, sample_rate = 0, channels = 0;
+
+    for_each_box(data, size, [&](uint32_t type, const uint8_t *data, size_t size)
+    {
+        if ((type == fourcc("tkhd")) && (size >= 84))
+        {
+            track.id = int(get_u32(data + ((data[0] == 1) ? 20 : 12)));
+            width = get_u32(data + size - 8) >> 16;
+            height = get_u32(data + size - 4) >> 16;
+        }
+        else if (type == fourcc("tref"))
+        {
+            // Chapter tracks are handled by libvlc.
+            for_each_box(data, size, [&](uint32_t type, const uint8_t *, size_t)
+            {
+                if (type == fourcc("chap"))
+                    valid = false;
+            });
+        }
+        else if (type == fourcc("mdia"))
+            for_each_box(data, size, [&](uint32_t type, const uint8_t *data, size_t size)
+            {
+                if ((type == fourcc("mdhd")) && (size >= 24))
+                {
+                    const size_t off = (data[0] == 1) ? 20 : 12;
+                    if (size >= (off + ((data[0] == 1) ? 14 : 10)))
+                    {
+                        timescale = get_u32(data + off);
+                        track.language = mp4_language(get_u16(data + off + ((data[0] == 1) ? 12 : 8)) & 0x7FFF);
+                    }
+                }
+                else if ((type == fourcc("hdlr")) && (size >= 12))
+                    handler = get_u32(data + 8);
+                else if (type == fourcc("minf"))
+                    for_each_box(data, size, [&](uint32_t type, const uint8_t *data, size_t size)
+                    {
+                        if (type == fourcc("stbl"))
+                            for_each_box(data, size, [&](uint32_t type, const uint8_t *data, size_t size)
+                            {
+                                if ((type == fourcc("stsd")) && (size >= 16))
+                                {
+                                    const uint8_t * const entry = data + 8;
+                                    const size_t entry_size = std::min(size_t(get_u32(entry)), size - 8);
+                                    format = get_u32(entry + 4);
+                                    if ((handler == fourcc("soun")) && (entry_size >= 36))
+                                    {
+                                        if (get_u16(entry + 16) > 1)
+                                            valid = false; // QuickTime sound description v2
+
+                                        channels = get_u16(entry + 24);
+                                        sample_rate = get_u32(entry + 32) >> 16;
+                                    }
+                                    else if ((handler == fourcc("vide")) && (entry_size >= 36))
+                                    {
+                                        width = get_u16(entry + 32);
+                                        height = get_u16(entry + 34);
+                                    }
+                                }
+                                else if ((type == fourcc("stts")) && (size >= 8))
+                                {
+                                    const uint32_t count = get_u32(data + 4);
+                                    for (uint32_t i = 0; (i < count) && ((16 + (i * 8)) <= size); i++)
+                                    {
+                                        sample_count += get_u32(data + 8 + (i * 8));
+                                        sample_duration += uint64_t(get_u32(data + 8 + (i * 8))) *
+                                                           get_u32(data + 12 + (i * 8));
+                                    }
+                                }
+                            });
+                    });
+            });
+    });
+
+    if (!valid || (format == fourcc("encv")) || (format == fourcc("enca")))
+        return false;
+
+    if (handler == fourcc("vide"))
+    {
+        const auto id = track.id;
+        const auto language = track.language;
+        track = video_track(id, width, height);
+        track.language = language;
+        if ((sample_count > 0) && (sample_duration > 0) && (timescale > 0) &&
+            ((uint64_t(timescale) * sample_count) <= 0xFFFFFFFF) &&
+            (sample_duration <= 0xFFFFFFFF))
+        {
+            track.video.frame_rate_num = timescale * sample_count;
+            track.video.frame_rate_den = unsigned(sample_duration);
+            reduce(track.video.frame_rate_num, track.video.frame_rate_den);
+        }
+
+        return (width > 0) && (height > 0);
+    }
+    else if (handler == fourcc("soun"))
+    {
+        const auto id = track.id;
+        const auto language = track.language;
+        track = audio_track(id, sample_rate, channels);
+        track.language = language;
+
+        return (sample_rate > 0) && (channels > 0);
+    }
+    else if ((handler == fourcc("text")) || (handler == fourcc("sbtl")) ||
+             (handler == fourcc("subt")) || (handler == fourcc("subp")))
+    {
+        const auto id = track.id;
+        const auto language = track.language;
+        track = text_track(id);
+        track.language = language;
+
+        return true;
+    }
+
+    track.type = track_type::unknown;
+    return true;
+}
+
+static bool probe_mp4(file_reader &file, struct media_cache::media_info &media_info)
+{
+    std::vector<uint8_t> moov;
+    for (uint64_t pos = 0; (pos + 8) <= file.size(); )
+    {
+        const auto header = file.read(pos, 16);
+        if (header.size() < 8)
+            return false;
+
+        uint64_t size = get_u32(header.data());
+        const uint32_t type = get_u32(header.data() + 4);
+        if ((pos == 0) && (type != fourcc("ftyp")) && (type != fourcc("moov")))
+            return false;
+
+        size_t header_size = 8;
+        if ((size == 1) && (header.size() >= 16))
+        {
+            size = get_u64(header.data() + 8);
+            header_size = 16;
+        }
+        else if (size == 0)
+            size = file.size() - pos;
+
+        if ((size < header_size) || (size > (file.size() - pos)))
+            return false;
+
+        if (type == fourcc("moov"))
+        {
+            if (size > (64 * 1024 * 1024))
+                return false;
+
+            moov = file.read(pos + header_size, size_t(size - header_size));
+            break;
+        }
+
+        pos += size;
+    }
+
+    if (moov.empty())
+        return false;
+
+    bool valid = true;
+    uint32_t timescale = 0;
+    uint64_t duration = 0;
+    for_each_box(moov.data(), moov.size(), [&](uint32_t type, const uint8_t *data, size_t size)
+    {
+        if ((type == fourcc("mvhd")) && (size >= 32))
+        {
+            if (data[0] == 1)
+            {
+                timescale = get_u32(data + 20);
+                duration = get_u64(data + 24);
+            }
+            else
+            {
+                timescale = get_u32(data + 12);
+                duration = get_u32(data + 16);
+            }
+        }
+        else if (type == fourcc("trak"))
+        {
+            struct media_cache::track track;
+            if (!parse_mp4_track(data, size, track))
+                valid = false;
+            else if (track.type != track_type::unknown)
+                media_info.tracks.emplace_back(std::move(track));
+        }
+        else if ((type == fourcc("cmov")) || (type == fourcc("mvex")))
+            valid = false; // Compressed or fragmented.
+        else if (type == fourcc("udta"))
+        {
+            // Chapters are handled by libvlc.
+            for_each_box(data, size, [&](uint32_t type, const uint8_t *, size_t)
+            {
+                if (type == fourcc("chpl"))
+                    valid = false;
+            });
+        }
+    });
+
+    if (!valid || media_info.tracks.empty() || (timescale == 0))
+        return false;
+
+    media_info.duration = std::chrono::milliseconds((duration * 1000) / timescale);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Matroska
+
+namespace {
+
+struct ebml_element
+{
+    uint32_t id;
+    uint64_t offset;
+    uint64_t size;
+};
+
+} // End of namespace
+
+static const uint64_t ebml_unknown_size = uint64_t(-1);
+
+// Reads an EBML variable size integer, the marker bit is kept for IDs.
+static size_t read_ebml_vint(const uint8_t *data, size_t size, bool id, uint64_t &value)
+{
+    if (size > 0)
+    {
+        size_t length = 1;
+        while ((length <= 8) && ((data[0] & (0x80 >> (length - 1))) == 0))
+            length++;
+
+        if ((length <= 8) && (length <= size) && (!id || (length <= 4)))
+        {
+            value = id ? data[0] : (data[0] & (0xFF >> length));
+            bool all_ones = value == (0xFFu >> length);
+            for (size_t i = 1; i < length; i++)
+            {
+                value = (value << 8) | data[i];
+                all_ones &= data[i] == 0xFF;
+            }
+
+            if (!id && all_ones)
+                value = ebml_unknown_size;
+
+            return length;
+        }
+    }
+
+    return 0;
+}
+
+static bool read_ebml_element(const uint8_t *data, size_t size, struct ebml_element &element)
+{
+    uint64_t id = 0;
+    const size_t id_length = read_ebml_vint(data, size, true, id);
+    if (id_length > 0)
+    {
+        const size_t size_length = read_ebml_vint(data + id_length, size - id_length, false, element.size);
+        if (size_length > 0)
+        {
+            element.id = uint32_t(id);
+            element.offset = id_length + size_length;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void for_each_ebml_element(
+        const uint8_t *data, size_t size,
+        const std::function<void(uint32_t, const uint8_t *, size_t)> &f)
+{
+    struct ebml_element element;
+    for (size_t pos = 0; (pos < size) && read_ebml_element(data + pos, size - pos, element); )
+    {
+        const size_t length = size_t(std::min(element.size, uint64_t(size - pos - element.offset)));
+        f(element.id, data + pos + element.offset, length);
+        pos += size_t(element.offset) + length;
+    }
+}
+
+static uint64_t ebml_uint(const uint8_t *data, size_t size)
+{
+    uint64_t result = 0;
+    for (size_t i = 0; i < std::min(size, size_t(8)); i++)
+        result = (result << 8) | data[i];
+
+    return result;
+}
+
+static double ebml_float(const uint8_t *data, size_t size)
+{
+    if (size == 4)
+    {
+        const uint32_t value = get_u32(data);
+        float result;
+        memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+    else if (size == 8)
+    {
+        const uint64_t value = get_u64(data);
+        double result;
+        memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    return 0.0;
+}
+
+static bool parse_mkv_tracks(const uint8_t *data, size_t size, struct media_cache::media_info &media_info)
+{
+    unsigned audio_count = 0, video_count = 0;
+    bool valid = true;
+
+    for_each_ebml_element(data, size, [&](uint32_t id, const uint8_t *data, size_t size)
+    {
+        if (id != 0xAE) // TrackEntry
+            return;
+
+        unsigned type = 0, width = 0, height = 0, channels = 1;
+        double sample_rate = 8000.0;
+        uint64_t default_duration = 0;
+        struct media_cache::track track;
+        track.language = "eng";
+
+        for_each_ebml_element(data, size, [&](uint32_t id, const uint8_t *data, size_t size)
+        {
+            switch (id)
+            {
+            case 0xD7:      track.id = int(ebml_uint(data, size)); break;
+            case 0x83:      type = unsigned(ebml_uint(data, size)); break;
+            case 0x22B59C:  track.language = std::string(reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), size)); break;
+            case 0x536E:    track.description = std::string(reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), size)); break;
+            case 0x23E383:  default_duration = ebml_uint(data, size); break;
+            case 0x6D80:    valid = false; break; // ContentEncodings
+
+            case 0xE0: // Video
+                for_each_ebml_element(data, size, [&](uint32_t id, const uint8_t *data, size_t size)
+                {
+                    if      (id == 0xB0) width = unsigned(ebml_uint(data, size));
+                    else if (id == 0xBA) height = unsigned(ebml_uint(data, size));
+                });
+                break;
+
+            case 0xE1: // Audio
+                for_each_ebml_element(data, size, [&](uint32_t id, const uint8_t *data, size_t size)
+                {
+                    if      (id == 0xB5) sample_rate = ebml_float(data, size);
+                    else if (id == 0x9F) channels = unsigned(ebml_uint(data, size));
+                });
+                break;
+            }
+        });
+
+        const auto number = track.id;
+        const auto language = track.language;
+        const auto description = track.description;
+        switch (type)
+        {
+        case 1: // Video
+            track = video_track(number, width, height);
+            if ((default_duration > 0) && (default_duration <= 0xFFFFFFFF))
+            {
+                track.video.frame_rate_num = 1000000000;
+                track.video.frame_rate_den = unsigned(default_duration);
+                reduce(track.video.frame_rate_num, track.video.frame_rate_den);
+            }
+
+            valid &= (width > 0) && (height > 0) && (++video_count == 1);
+            break;
+
+        case 2: // Audio
+            track = audio_track(number, unsigned(sample_rate + 0.5), channels);
+            valid &= (track.audio.sample_rate > 0) && (channels > 0) && (++audio_count == 1);
+            break;
+
+        case 0x11: // Subtitle
+            // The libvlc track IDs for subtitles are not known.
+            valid = false;
+            break;
+
+        default:
+            return;
+        }
+
+        track.language = language;
+        track.description = description;
+        media_info.tracks.emplace_back(std::move(track));
+    });
+
+    return valid && !media_info.tracks.empty();
+}
+
+static bool probe_mkv(file_reader &file, struct media_cache::media_info &media_info)
+{
+    const auto head = file.read(0, 64);
+
+    struct ebml_element element;
+    if (!read_ebml_element(head.data(), head.size(), element) ||
+        (element.id != 0x1A45DFA3) ||
+        (element.size == ebml_unknown_size) ||
+        (element.size > (head.size() - element.offset)))
+    {
+        return false;
+    }
+
+    std::string doc_type;
+    for_each_ebml_element(&head[element.offset], size_t(element.size), [&doc_type](uint32_t id, const uint8_t *data, size_t size)
+    {
+        if (id == 0x4282)
+            doc_type = std::string(reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), size));
+    });
+
+    if ((doc_type != "matroska") && (doc_type != "webm"))
+        return false;
+
+    uint64_t pos = element.offset + element.size;
+    auto header = file.read(pos, 16);
+    if (!read_ebml_element(header.data(), header.size(), element) || (element.id != 0x18538067))
+        return false;
+
+    if (element.offset > (file.size() - pos))
+        return false;
+
+    const uint64_t segment_end =
+            ((element.size != ebml_unknown_size) && (element.size <= (file.size() - pos - element.offset)))
+            ? (pos + element.offset + element.size)
+            : file.size();
+
+    bool has_info = false, has_tracks = false;
+    uint64_t timecode_scale = 1000000;
+    double duration = 0.0;
+
+    for (pos += element.offset; pos < segment_end; pos += element.offset + element.size)
+    {
+        header = file.read(pos, 16);
+        if (!read_ebml_element(header.data(), header.size(), element) ||
+            (element.size == ebml_unknown_size) ||
+            (element.offset > (segment_end - pos)) ||
+            (element.size > (segment_end - pos - element.offset)))
+        {
+            break;
+        }
+
+        if ((element.id == 0x1F43B675) && has_info && has_tracks) // Cluster
+            break;
+        else if (element.id == 0x1043A770) // Chapters are handled by libvlc.
+            return false;
+        else if ((element.id == 0x1549A966) || (element.id == 0x1654AE6B) || (element.id == 0x114D9B74))
+        {
+            if (element.size > (16 * 1024 * 1024))
+                return false;
+
+            const auto data = file.read(pos + element.offset, size_t(element.size));
+            if (element.id == 0x1549A966) // Info
+            {
+                for_each_ebml_element(data.data(), data.size(), [&](uint32_t id, const uint8_t *data, size_t size)
+                {
+                    if      (id == 0x2AD7B1) timecode_scale = ebml_uint(data, size);
+                    else if (id == 0x4489) duration = ebml_float(data, size);
+                });
+
+                has_info = true;
+            }
+            else if (element.id == 0x1654AE6B) // Tracks
+            {
+                if (!parse_mkv_tracks(data.data(), data.size(), media_info))
+                    return false;
+
+                has_tracks = true;
+            }
+            else if (element.id == 0x114D9B74) // SeekHead
+            {
+                bool has_chapters = false;
+                for_each_ebml_element(data.data(), data.size(), [&has_chapters](uint32_t id, const uint8_t *data, size_t size)
+                {
+                    if (id == 0x4DBB) // Seek
+                        for_each_ebml_element(data, size, [&has_chapters](uint32_t id, const uint8_t *data, size_t size)
+                        {
+                            if ((id == 0x53AB) && (size == 4) && (get_u32(data) == 0x1043A770))
+                                has_chapters = true;
+                        });
+                });
+
+                if (has_chapters)
+                    return false;
+            }
+        }
+    }
+
+    if (!has_info || !has_tracks)
+        return false;
+
+    media_info.duration = std::chrono::milliseconds(
+                uint64_t(duration * double(timecode_scale) / 1000000.0));
+
+    return true;
+}
+
+bool probe_media_info(const std::string &path, struct media_cache::media_info &media_info)
+{
+    file_reader file(path);
+    if (file.size() > 0)
+    {
+        static bool (* const probes[])(file_reader &, struct media_cache::media_info &) =
+        {
+            &probe_mp4, &probe_mkv, &probe_ts, &probe_ps
+        };
+
+        for (auto probe : probes)
+        {
+            struct media_cache::media_info result;
+            if (probe(file, result))
+            {
+                media_info = std::move(result);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+} // End of namespace
@@ -0,0 +1,34 @@
+/******************************************************************************
+ *   Copyright (C) 2015  A.J. Admiraal                                        *
+ *   code@admiraal.dds.nl                                                     *
+ *                                                                            *
+ *   This program is free software: you can redistribute it and/or modify     *
+ *   it under the terms of the GNU General Public License version 3 as        *
+ *   published by the Free Software Foundation.                               *
+ *                                                                            *
+ *   This program is distributed in the hope that it will be useful,          *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of           *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the            *
+ *   GNU General Public License for more details.                             *
+ *                                                                            *
+ *   You should have received a copy of the GNU General Public License        *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.    *
+ ******************************************************************************/
+
+#ifndef VLC_MEDIA_PROBE_H
+#define VLC_MEDIA_PROBE_H
+
+#include "vlc/media_cache.h"
+#include <string>
+
+namespace vlc {
+
+/*! Reads the media info of MP4, Matroska, MPEG TS and MPEG PS files from the
+    container headers, using the same track IDs as libvlc. Returns false if
+    the file is not supported, libvlc should be used to read it then.
+ */
+bool probe_media_info(const std::string &path, struct media_cache::media_info &);
+
+} // End of namespace
+
+#endif
@@ -155,49 +155,59 @@ static const std::unordered_set<std::string> & subtitle_suffixes()
     return subtitle_suffixes;
 }
 
-std::vector<std::string> find_subtitle_files(const std::string &path)
+directory_index::directory_index(const std::string &dir)
 {
-    std::vector<std::string> result;
     auto &subtitle_suffixes = subtitles::subtitle_suffixes();
 
-    const size_t lsl = path.find_last_of('/');
-    if (lsl != path.npos)
+    for (auto &name : platform::list_files(dir, platform::file_filter::all))
     {
-        const auto dir = path.substr(0, lsl);
-        const auto filename = path.substr(lsl + 1);
-        const auto suffix = suffix_of(filename);
-        const auto bare_name = to_bare_name(filename, suffix);
-
-        for (auto &name : platform::list_files(dir, platform::file_filter::all))
+        const auto lname = to_lower(name);
+        if (starts_with(lname, "sub") && ends_with(lname, "/"))
         {
-            const auto lname = to_lower(name);
-            if (starts_with(lname, "sub") && ends_with(lname, "/"))
+            for (auto &subname : platform::list_files(dir + '/' + name, platform::file_filter::all))
             {
-                for (auto &subname : platform::list_files(dir + '/' + name, platform::file_filter::all))
-                {
-                    const auto suffix = to_lower(suffix_of(subname));
-                    if ((subtitle_suffixes.find(suffix) != subtitle_suffixes.end()) &&
-                        starts_with(to_bare_name(subname, suffix), bare_name))
-                    {
-                        result.emplace_back(dir + '/' + name + subname);
-                    }
-                }
-            }
-            else
-            {
-                const auto suffix = suffix_of(lname);
-                if ((subtitle_suffixes.find(suffix) != subtitle_suffixes.end()) &&
-                    starts_with(to_bare_name(lname, suffix), bare_name))
-                {
-                    result.emplace_back(dir + '/' + name);
-                }
+                const auto suffix = to_lower(suffix_of(subname));
+                if (subtitle_suffixes.find(suffix) != subtitle_suffixes.end())
+                    files.emplace(to_bare_name(subname, suffix), dir + '/' + name + subname);
             }
         }
+        else
+        {
+            const auto suffix = suffix_of(lname);
+            if (subtitle_suffixes.find(suffix) != subtitle_suffixes.end())
+                files.emplace(to_bare_name(lname, suffix), dir + '/' + name);
+        }
+    }
+}
+
+directory_index::~directory_index()
+{
+}
+
+std::vector<std::string> directory_index::find_subtitle_files(const std::string &filename) const
+{
+    const auto bare_name = to_bare_name(filename, suffix_of(filename));
+
+    std::vector<std::string> result;
+    for (auto i = files.lower_bound(bare_name);
+         (i != files.end()) && starts_with(i->first, bare_name);
+         i++)
+    {
+        result.emplace_back(i->second);
     }
 
     return result;
 }
 
+std::vector<std::string> find_subtitle_files(const std::string &path)
+{
+    const size_t lsl = path.find_last_of('/');
+    if (lsl != path.npos)
+        return directory_index(path.substr(0, lsl)).find_subtitle_files(path.substr(lsl + 1));
+
+    return std::vector<std::string>();
+}
+
 static bool language_of(
         const std::string &input,
         const char *&language,
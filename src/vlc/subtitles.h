@@ -18,6 +18,7 @@
 #ifndef VLC_SUBTITLES_H
 #define VLC_SUBTITLES_H
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,21 @@ private:
     bool own;
 };
 
+/*! Lists the subtitle files in a directory, and its sub* subdirectories, once
+    so they can be matched against all media files in that directory.
+ */
+class directory_index
+{
+public:
+    explicit directory_index(const std::string &dir);
+    ~directory_index();
+
+    std::vector<std::string> find_subtitle_files(const std::string &filename) const;
+
+private:
+    std::multimap<std::string, std::string> files;
+};
+
 std::vector<std::string> find_subtitle_files(const std::string &path);
 
 bool determine_subtitle_language(
@@ -0,0 +1,108 @@
+#include "test.h"
+#include "platform/file_watcher.cpp"
+#include "platform/fstream.h"
+#include "platform/path.h"
+#include <cstdio>
+#include <set>
+#if defined(__unix__)
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+static const struct file_watcher_test
+{
+    file_watcher_test()
+        : changed_test(this, "platform::file_watcher::changed", &file_watcher_test::changed),
+          shared_test(this, "platform::file_watcher::shared", &file_watcher_test::shared)
+    {
+    }
+
+    struct test changed_test;
+    void changed()
+    {
+        const auto filename = platform::temp_file_path("txt");
+        const auto dir = filename.substr(0, filename.find_last_of('/') + 1);
+        const auto name = filename.substr(dir.length());
+
+        class platform::messageloop messageloop;
+        class platform::messageloop_ref messageloop_ref(messageloop);
+
+        platform::file_watcher file_watcher(
+                    messageloop_ref,
+                    [&messageloop, &dir, &name](const std::string &changed_dir, const std::string &changed_name)
+        {
+            if ((changed_dir == dir) && (changed_name == name))
+                messageloop.stop(1);
+        });
+
+        if (file_watcher.watch(dir))
+        {
+            test_assert(file_watcher.is_watched(dir));
+
+            platform::timer timeout(messageloop, [&messageloop] { messageloop.stop(0); });
+            timeout.start(std::chrono::seconds(5), true);
+            platform::ofstream(filename) << "test" << std::endl;
+            test_assert(messageloop.run() == 1);
+
+            file_watcher.unwatch(dir);
+            test_assert(!file_watcher.is_watched(dir));
+        }
+
+        ::remove(filename.c_str());
+    }
+
+    struct test shared_test;
+    void shared()
+    {
+#if defined(__unix__)
+        // Two paths to the same directory.
+        const auto path = platform::temp_file_path("dir");
+        const auto link = platform::temp_file_path("lnk");
+        test_assert(::mkdir(path.c_str(), 0755) == 0);
+        test_assert(::symlink(path.c_str(), link.c_str()) == 0);
+        const auto dir = path + '/', link_dir = link + '/';
+
+        class platform::messageloop messageloop;
+        class platform::messageloop_ref messageloop_ref(messageloop);
+
+        std::set<std::string> changed_dirs;
+        platform::file_watcher file_watcher(
+                    messageloop_ref,
+                    [&messageloop, &changed_dirs](const std::string &changed_dir, const std::string &)
+        {
+            changed_dirs.insert(changed_dir);
+            if (changed_dirs.size() == 2)
+                messageloop.stop(1);
+        });
+
+        if (file_watcher.watch(dir) && file_watcher.watch(link_dir))
+        {
+            platform::timer timeout(messageloop, [&messageloop] { messageloop.stop(0); });
+            timeout.start(std::chrono::seconds(5), true);
+            platform::ofstream(dir + "a.txt") << "test" << std::endl;
+            test_assert(messageloop.run() == 1);
+            test_assert(changed_dirs.count(dir) == 1);
+            test_assert(changed_dirs.count(link_dir) == 1);
+
+            // Removing one path keeps the watch for the other.
+            file_watcher.unwatch(dir);
+            test_assert(!file_watcher.is_watched(dir));
+            test_assert(file_watcher.is_watched(link_dir));
+
+            changed_dirs.clear();
+            changed_dirs.insert(dir);
+            timeout.start(std::chrono::seconds(5), true);
+            platform::ofstream(dir + "b.txt") << "test" << std::endl;
+            test_assert(messageloop.run() == 1);
+            test_assert(changed_dirs.count(link_dir) == 1);
+
+            file_watcher.unwatch(link_dir);
+        }
+
+        ::remove((dir + "a.txt").c_str());
+        ::remove((dir + "b.txt").c_str());
+        ::remove(link.c_str());
+        ::rmdir(path.c_str());
+#endif
+    }
+} file_watcher_test;
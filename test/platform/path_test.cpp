@@ -1,12 +1,18 @@
 #include "test.h"
 #include "platform/path.cpp"
 #include <algorithm>
+#if defined(__unix__)
+# include <dirent.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
 
 static const struct path_test
 {
     path_test()
         : list_root_directories_test(this, "platform::path::list_root_directories", &path_test::list_root_directories),
-          list_files_test(this, "platform::path::list_files", &path_test::list_files)
+          list_files_test(this, "platform::path::list_files", &path_test::list_files),
+          list_files_tree_test(this, "platform::path::list_files_tree", &path_test::list_files_tree)
     {
     }
 
@@ -43,4 +49,86 @@ static const struct path_test
 #endif
         }
     }
+
+    struct test list_files_tree_test;
+    void list_files_tree()
+    {
+#if defined(__unix__)
+        static const unsigned dir_count = 30, file_count = 9;
+
+        // Temporary files are hidden from directory listings, so the tree is
+        // created in the current directory.
+        const std::string root = "./" + std::string(platform::uuid::generate()) + '/';
+        test_assert(::mkdir(root.c_str(), 0755) == 0);
+
+        std::vector<std::string> dirs;
+        for (unsigned i = 0; i < dir_count; i++)
+        {
+            dirs.emplace_back("dir" + std::to_string(i) + '/');
+            test_assert(::mkdir((root + dirs.back()).c_str(), 0755) == 0);
+
+            // A third of the directories contain a single file.
+            for (unsigned j = 0, n = ((i % 3) == 0) ? 1 : file_count; j < n; j++)
+            {
+                const auto file = root + dirs.back() + "file" + std::to_string(j) + ".mkv";
+                FILE * const f = fopen(file.c_str(), "w");
+                test_assert(f != nullptr);
+                fclose(f);
+                test_assert(::truncate(file.c_str(), min_file_size) == 0);
+            }
+        }
+
+        // Lists a directory the way list_files() did before it used the file
+        // type from the directory entry: with a stat call on the full path
+        // of each entry.
+        const auto stat_list_files = [](const std::string &path, size_t max_count)
+        {
+            std::vector<std::string> result;
+            auto dir = ::opendir(path.c_str());
+            for (auto dirent = ::readdir(dir);
+                 dirent && (result.size() < max_count);
+                 dirent = ::readdir(dir))
+            {
+                struct stat stat;
+                if ((dirent->d_name[0] != '.') &&
+                    (::stat((path + dirent->d_name).c_str(), &stat) == 0))
+                {
+                    if (S_ISDIR(stat.st_mode))
+                        result.emplace_back(dirent->d_name + std::string("/"));
+                    else if (size_t(stat.st_size) >= min_file_size)
+                        result.emplace_back(dirent->d_name);
+                }
+            }
+
+            ::closedir(dir);
+            return result;
+        };
+
+        const auto stat_listing = stat_list_files(root, size_t(-1));
+        std::vector<std::vector<std::string>> stat_children;
+        for (auto &i : stat_listing)
+            stat_children.emplace_back(stat_list_files(root + i, 2));
+
+        const auto listing = platform::list_files(root);
+        std::vector<std::string> paths;
+        for (auto &i : listing)
+            paths.emplace_back(root + i);
+
+        const auto children = platform::list_files(paths, platform::file_filter::large_files, 2);
+
+        for (size_t i = 0; i < dirs.size(); i++)
+        {
+            for (unsigned j = 0; j < file_count; j++)
+                ::unlink((root + dirs[i] + "file" + std::to_string(j) + ".mkv").c_str());
+
+            ::rmdir((root + dirs[i]).c_str());
+        }
+
+        ::rmdir(root.c_str());
+
+        test_assert(listing.size() == dir_count);
+        test_assert(listing == stat_listing);
+        test_assert(children == stat_children);
+#endif
+    }
 } path_test;
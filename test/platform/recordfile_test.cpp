@@ -0,0 +1,169 @@
+#include "test.h"
+#include "platform/recordfile.cpp"
+#include "platform/fstream.h"
+#include "platform/path.h"
+#include <cstdio>
+#include <iterator>
+
+static const struct recordfile_test
+{
+    const std::string filename;
+
+    recordfile_test()
+        : filename(platform::temp_file_path("db")),
+          loopback_test(this, "platform::recordfile::loopback", &recordfile_test::loopback),
+          compact_test(this, "platform::recordfile::compact", &recordfile_test::compact),
+          truncated_test(this, "platform::recordfile::truncated", &recordfile_test::truncated),
+          many_test(this, "platform::recordfile::many", &recordfile_test::many)
+    {
+    }
+
+    ~recordfile_test()
+    {
+        ::remove(filename.c_str());
+    }
+
+    static platform::uuid make_uuid(unsigned i)
+    {
+        platform::uuid uuid;
+        for (unsigned j = 0; j < sizeof(uuid.value); j++)
+            uuid.value[j] = uint8_t((i >> ((j % 4) * 8)) + j);
+
+        return uuid;
+    }
+
+    static std::string make_value(unsigned i)
+    {
+        return "{ 1 \"eng\" \"\" 1 48000 2 0 2 \"dut\" \"\" 2 1920 1080 25 1 } " +
+                std::to_string(i * 1000) + " 0";
+    }
+
+    static uint64_t file_size(const std::string &filename)
+    {
+        struct platform::file_stat file_stat;
+        return platform::stat_file(filename, file_stat) ? file_stat.size : 0;
+    }
+
+    struct test loopback_test;
+    void loopback()
+    {
+        ::remove(filename.c_str());
+
+        {
+            platform::recordfile file(filename);
+            test_assert(file.empty());
+            test_assert(file.version() == 0);
+
+            file.clear(3);
+            for (unsigned i = 0; i < 16; i++)
+                file.write(make_uuid(i), make_value(i));
+
+            test_assert(file.size() == 16);
+            test_assert(file.read(make_uuid(5)) == make_value(5));
+        }
+
+        {
+            platform::recordfile file(filename);
+            test_assert(file.version() == 3);
+            test_assert(file.size() == 16);
+            for (unsigned i = 0; i < 16; i++)
+                test_assert(file.read(make_uuid(i)) == make_value(i));
+
+            test_assert(!file.has_record(make_uuid(16)));
+            test_assert(file.read(make_uuid(16)).empty());
+
+            file.write(make_uuid(3), std::string());
+            test_assert(file.has_record(make_uuid(3)));
+            test_assert(file.read(make_uuid(3)).empty());
+        }
+
+        {
+            platform::recordfile file(filename);
+            test_assert(file.has_record(make_uuid(3)));
+            test_assert(file.read(make_uuid(3)).empty());
+            test_assert(file.read(make_uuid(4)) == make_value(4));
+        }
+    }
+
+    struct test compact_test;
+    void compact()
+    {
+        ::remove(filename.c_str());
+
+        {
+            platform::recordfile file(filename);
+            for (unsigned n = 0; n < 64; n++)
+                for (unsigned i = 0; i < 64; i++)
+                    file.write(make_uuid(i), make_value(i + n));
+        }
+
+        const auto size = file_size(filename);
+
+        // Opening the file should compact it, as most records are overwritten.
+        {
+            platform::recordfile file(filename);
+            test_assert(file.size() == 64);
+            for (unsigned i = 0; i < 64; i++)
+                test_assert(file.read(make_uuid(i)) == make_value(i + 63));
+        }
+
+        test_assert(file_size(filename) < (size / 32));
+    }
+
+    struct test truncated_test;
+    void truncated()
+    {
+        ::remove(filename.c_str());
+
+        {
+            platform::recordfile file(filename);
+            for (unsigned i = 0; i < 8; i++)
+                file.write(make_uuid(i), make_value(i));
+        }
+
+        // Cut off the last record halfway, as if the process was killed.
+        {
+            platform::ifstream in(filename, std::ios_base::binary);
+            std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+
+            platform::ofstream(filename, std::ios_base::binary) << data.substr(0, data.size() - 8);
+        }
+
+        {
+            platform::recordfile file(filename);
+            test_assert(file.size() == 7);
+            test_assert(!file.has_record(make_uuid(7)));
+            test_assert(file.read(make_uuid(6)) == make_value(6));
+
+            file.write(make_uuid(7), make_value(7));
+        }
+
+        {
+            platform::recordfile file(filename);
+            test_assert(file.size() == 8);
+            test_assert(file.read(make_uuid(7)) == make_value(7));
+        }
+    }
+
+    struct test many_test;
+    void many()
+    {
+        static const unsigned count = 20000;
+
+        ::remove(filename.c_str());
+        {
+            platform::recordfile file(filename);
+            for (unsigned i = 0; i < count; i++)
+                file.write(make_uuid(i), make_value(i));
+        }
+
+        const platform::recordfile file(filename);
+        test_assert(file.size() == count);
+        for (unsigned i = 0; i < count; i++)
+        {
+            const unsigned j = (i * 7919) % count;
+            test_assert(file.read(make_uuid(j)) == make_value(j));
+        }
+    }
+} recordfile_test;
@@ -1,5 +1,7 @@
 #include "test.h"
 #include "platform/string.cpp"
+#include <algorithm>
+#include <vector>
 
 static const char base64_src[] =
         "Man is distinguished, not only by his reason, but by this singular passion from "
@@ -32,7 +34,8 @@ static const struct string_test
           to_percent_test(this, "string::to_percent", &string_test::to_percent),
           from_percent_test(this, "string::from_percent", &string_test::from_percent),
           escape_xml_test(this, "string::escape_xml", &string_test::escape_xml),
-          compare_version_test(this, "string::compare_version", &string_test::compare_version)
+          compare_version_test(this, "string::compare_version", &string_test::compare_version),
+          alphanum_key_test(this, "string::alphanum_key", &string_test::alphanum_key)
     {
     }
 
@@ -112,4 +115,64 @@ static const struct string_test
         test_assert(::compare_version("1.2.3", "1.1") > 0);
         test_assert(::compare_version("1.2.3", "0") > 0);
     }
+
+    static std::vector<std::string> alphanum_names(unsigned count)
+    {
+        static const char * const parts[] =
+        {
+            "episode ", "Episode ", "s01e", "S1E", "track", "-", " ", ".", "_",
+            "a", "b", "z", "A", "Z", "0", "00", "7", "9", "10", "010", "99",
+            "100", "4294967295", "99999999999", "\xc3\xa9", "\xc3\x89",
+            "\xe2\x82\xac", "\xf0\x9f\x8e\xac", ".mkv", ".avi", "/"
+        };
+
+        static const unsigned num_parts = sizeof(parts) / sizeof(*parts);
+
+        std::vector<std::string> result;
+        unsigned seed = 12345;
+        for (unsigned i = 0; i < count; i++)
+        {
+            std::string name;
+            for (unsigned j = 0, n = 1 + (i % 6); j < n; j++)
+            {
+                seed = (seed * 1103515245) + 12345;
+                name += parts[(seed >> 16) % num_parts];
+            }
+
+            result.emplace_back(std::move(name));
+        }
+
+        return result;
+    }
+
+    struct test alphanum_key_test;
+    void alphanum_key()
+    {
+        test_assert(::alphanum_key("file9") < ::alphanum_key("file10"));
+        test_assert(::alphanum_key("file010") == ::alphanum_key("file10"));
+        test_assert(::alphanum_key("file 2") < ::alphanum_key("file2"));
+        test_assert(::alphanum_key("file2") < ::alphanum_key("filea"));
+
+        // alphanum_less considers a string equivalent to its prefixes, the
+        // key orders them shortest first; any strict order has to agree.
+        const alphanum_less less;
+        const auto names = alphanum_names(400);
+        std::vector<std::string> keys;
+        for (auto &i : names)
+            keys.emplace_back(::alphanum_key(i));
+
+        for (size_t i = 0; i < names.size(); i++)
+            for (size_t j = 0; j < names.size(); j++)
+                if (less(names[i], names[j]))
+                    test_assert(keys[i] < keys[j]);
+
+        // Sorting by key gives an order alphanum_less agrees with.
+        std::vector<std::pair<std::string, const std::string *>> sorted;
+        for (size_t i = 0; i < names.size(); i++)
+            sorted.emplace_back(keys[i], &names[i]);
+
+        std::sort(sorted.begin(), sorted.end());
+        for (size_t i = 1; i < sorted.size(); i++)
+            test_assert(!less(*sorted[i].second, *sorted[i - 1].second));
+    }
 } string_test;
@@ -0,0 +1,38 @@
+#include "test.h"
+#include "platform/tempfile.cpp"
+#include <vector>
+
+static const struct tempfile_test
+{
+    tempfile_test()
+        : read_write_test(this, "platform::tempfile::read_write", &tempfile_test::read_write)
+    {
+    }
+
+    struct test read_write_test;
+    void read_write()
+    {
+        platform::tempfile file;
+        test_assert(file.is_open());
+
+        std::vector<char> data(100000);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = char(i * 7);
+
+        // Out of order, leaving a hole.
+        static const uint64_t far = uint64_t(1) << 32;
+        test_assert(file.write(far, &data[0], data.size()));
+        test_assert(file.write(0, &data[0], data.size()));
+
+        std::vector<char> result(data.size());
+        test_assert(file.read(0, &result[0], result.size()));
+        test_assert(result == data);
+        test_assert(file.read(far, &result[0], result.size()));
+        test_assert(result == data);
+
+        test_assert(file.read(data.size(), &result[0], 16));
+        test_assert(result[0] == 0);
+
+        test_assert(!file.read(far + 1, &result[0], result.size()));
+    }
+} tempfile_test;
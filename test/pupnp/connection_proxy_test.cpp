@@ -0,0 +1,235 @@
+#include "test.h"
+#include "pupnp/connection_proxy.cpp"
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace {
+
+char pattern(size_t pos)
+{
+    return char((pos * 31) ^ (pos >> 13));
+}
+
+// Produces size bytes of pattern().
+class pattern_stream : public std::istream
+{
+public:
+    explicit pattern_stream(size_t size)
+        : std::istream(nullptr),
+          buffer(size)
+    {
+        rdbuf(&buffer);
+    }
+
+private:
+    class streambuf : public std::streambuf
+    {
+    public:
+        explicit streambuf(size_t size)
+            : remaining(size),
+              pos(0),
+              block(65536)
+        {
+        }
+
+        int underflow() override
+        {
+            if (remaining == 0)
+                return traits_type::eof();
+
+            const size_t size = std::min(remaining, block.size());
+            for (size_t i = 0; i < size; i++)
+                block[i] = pattern(pos + i);
+
+            pos += size;
+            remaining -= size;
+            setg(&block[0], &block[0], &block[0] + size);
+            return traits_type::to_int_type(block[0]);
+        }
+
+    private:
+        size_t remaining, pos;
+        std::vector<char> block;
+    };
+
+    streambuf buffer;
+};
+
+// Reads the stream to the end and checks a sample of the bytes, expecting
+// the stream to start at offset.
+size_t read_all(std::istream &stream, bool &valid, size_t offset = 0)
+{
+    std::vector<char> buffer(65536);
+    size_t pos = offset;
+    valid = true;
+    for (;;)
+    {
+        stream.read(&buffer[0], buffer.size());
+        const size_t size = size_t(stream.gcount());
+        if (size == 0)
+            break;
+
+        for (size_t i = 0; i < size; i += 997)
+            valid &= buffer[i] == pattern(pos + i);
+
+        valid &= buffer[size - 1] == pattern(pos + size - 1);
+        pos += size;
+    }
+
+    return pos - offset;
+}
+
+} // End of namespace
+
+static const struct connection_proxy_test
+{
+    connection_proxy_test()
+        : read_test(this, "pupnp::connection_proxy::read", &connection_proxy_test::read),
+          spill_test(this, "pupnp::connection_proxy::spill", &connection_proxy_test::spill),
+          late_attach_test(this, "pupnp::connection_proxy::late_attach", &connection_proxy_test::late_attach),
+          multiple_readers_test(this, "pupnp::connection_proxy::multiple_readers", &connection_proxy_test::multiple_readers)
+    {
+    }
+
+    struct test read_test;
+    void read()
+    {
+        static const size_t size = 5 * block_size + 12345;
+
+        for (size_t data_rate : { size_t(0), size_t(65536) })
+        {
+            pupnp::connection_proxy proxy(std::unique_ptr<std::istream>(new pattern_stream(size)), data_rate);
+
+            bool valid = false;
+            test_assert(read_all(proxy, valid) == size);
+            test_assert(valid);
+        }
+    }
+
+    struct test spill_test;
+    void spill()
+    {
+        static const size_t size = 7 * block_size + 12345;
+
+        // Keeps two blocks in memory, the rest is moved to a temporary file.
+        pupnp::connection_proxy proxy(std::unique_ptr<std::istream>(new pattern_stream(size)), 0, nullptr, 2 * block_size);
+
+        bool valid = false;
+        test_assert(read_all(proxy, valid) == size);
+        test_assert(valid);
+
+        proxy.clear();
+        test_assert(proxy.seekg(0, std::ios_base::end));
+        test_assert(size_t(proxy.tellg()) == size);
+
+        for (size_t pos : { size_t(12345), block_size * 3 - 1, block_size * 6 + 1, size - 1, size_t(0) })
+        {
+            test_assert(proxy.seekg(pos));
+            test_assert(size_t(proxy.tellg()) == pos);
+
+            char data[2] = { 0, 0 };
+            const size_t count = std::min(size - pos, sizeof(data));
+            test_assert(size_t(proxy.read(data, count).gcount()) == count);
+            for (size_t i = 0; i < count; i++)
+                test_assert(data[i] == pattern(pos + i));
+        }
+    }
+
+    struct test late_attach_test;
+    void late_attach()
+    {
+        // Buffers three blocks.
+        static const size_t size = 16 * block_size;
+        static const size_t data_rate = 65536;
+        static const size_t interval = 300000;
+
+        for (bool indexed : { false, true })
+        {
+            size_t next = 0, end = 0;
+            pupnp::connection_proxy::random_access_points_function random_access_points;
+            if (indexed)
+                random_access_points = [&next, &end]
+                {
+                    std::vector<size_t> result;
+                    for (end += block_size; next < end; next += interval)
+                        result.push_back(next);
+
+                    return result;
+                };
+
+            pupnp::connection_proxy first(std::unique_ptr<std::istream>(new pattern_stream(size)), data_rate, random_access_points);
+            std::vector<char> buffer(8 * block_size);
+            test_assert(first.read(&buffer[0], buffer.size()));
+
+            pupnp::connection_proxy second;
+            const bool attached = second.attach(first);
+
+            size_t first_size = 0;
+            bool first_valid = false;
+            std::thread thread([&first, &first_size, &first_valid, &buffer]
+            {
+                first_size = read_all(first, first_valid, buffer.size());
+            });
+
+            if (attached)
+            {
+                // Joins at one of the random access points.
+                const std::string data((std::istreambuf_iterator<char>(second)), std::istreambuf_iterator<char>());
+                const size_t start = size - data.size();
+                test_assert((start > 0) && (start < size) && ((start % interval) == 0));
+
+                bool valid = true;
+                for (size_t i = 0; i < data.size(); i += 997)
+                    valid &= data[i] == pattern(start + i);
+
+                test_assert(valid);
+            }
+
+            thread.join();
+            test_assert(attached == indexed);
+            test_assert(first_size == size - buffer.size());
+            test_assert(first_valid);
+        }
+    }
+
+    struct test multiple_readers_test;
+    void multiple_readers()
+    {
+        // A 30 MB ring buffer, the stream wraps around it a few times.
+        static const size_t size = 128 * block_size;
+        static const size_t data_rate = block_size;
+
+        for (int readers : { 1, 2, 4, 8, 16 })
+        {
+            std::vector<std::unique_ptr<pupnp::connection_proxy>> proxies;
+            proxies.emplace_back(new pupnp::connection_proxy(std::unique_ptr<std::istream>(new pattern_stream(size)), data_rate));
+            while (proxies.size() < size_t(readers))
+            {
+                proxies.emplace_back(new pupnp::connection_proxy());
+                test_assert(proxies.back()->attach(*proxies.front()));
+            }
+
+            std::vector<size_t> sizes(proxies.size(), 0);
+            std::vector<char> valid(proxies.size(), 0);
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < proxies.size(); i++)
+                threads.emplace_back([&proxies, &sizes, &valid, i]
+                {
+                    bool v = false;
+                    sizes[i] = read_all(*proxies[i], v);
+                    valid[i] = v;
+                });
+
+            for (auto &i : threads)
+                i.join();
+
+            for (size_t i = 0; i < proxies.size(); i++)
+            {
+                test_assert(sizes[i] == size);
+                test_assert(valid[i]);
+            }
+        }
+    }
+} connection_proxy_test;
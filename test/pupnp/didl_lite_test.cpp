@@ -0,0 +1,256 @@
+#include "test.h"
+#include "pupnp/didl_lite.cpp"
+#include <ixml.h>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct res
+{
+    std::string url, protocol_info;
+    unsigned sample_rate, channels, width, height;
+};
+
+struct object
+{
+    bool is_item;
+    std::string id, parent_id, title;
+    size_t child_count;
+    std::chrono::milliseconds duration;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    std::vector<struct res> files;
+};
+
+// Builds the DOM the same way as ixml_structures used to.
+class dom
+{
+public:
+    dom()
+        : doc(ixmlDocument_createDocument()),
+          didl(add_element(&doc->n, "DIDL-Lite"))
+    {
+        ixmlElement_setAttribute(didl, "xmlns", "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");
+        ixmlElement_setAttribute(didl, "xmlns:dc", "http://purl.org/dc/elements/1.1/");
+        ixmlElement_setAttribute(didl, "xmlns:dlna", "urn:schemas-dlna-org:metadata-1-0/");
+        ixmlElement_setAttribute(didl, "xmlns:upnp", "urn:schemas-upnp-org:metadata-1-0/upnp/");
+    }
+
+    ~dom()
+    {
+        ixmlDocument_free(doc);
+    }
+
+    void add(const struct object &object)
+    {
+        IXML_Element * const item = add_element(&didl->n, object.is_item ? "item" : "container");
+        ixmlElement_setAttribute(item, "id", object.id.c_str());
+        ixmlElement_setAttribute(item, "parentID", object.parent_id.c_str());
+        ixmlElement_setAttribute(item, "restricted", "1");
+        if (!object.is_item && (object.child_count != size_t(-1)))
+            ixmlElement_setAttribute(item, "childCount", std::to_string(object.child_count).c_str());
+
+        add_textelement(&item->n, "dc:title", object.title);
+
+        for (auto &attribute : object.attributes)
+        {
+            IXML_Element * const e = add_textelement(&item->n, attribute.first, attribute.second);
+            if (attribute.first == "upnp:albumArtURI")
+                ixmlElement_setAttribute(e, "dlna:profileID", "JPEG_TN");
+        }
+
+        for (auto &file : object.files)
+        {
+            IXML_Element * const res = add_textelement(&item->n, "res", file.url);
+            ixmlElement_setAttribute(res, "protocolInfo", file.protocol_info.c_str());
+
+            if (object.duration.count() > 0)
+                ixmlElement_setAttribute(res, "duration", to_time(object.duration).c_str());
+
+            if (file.sample_rate > 0)
+                ixmlElement_setAttribute(res, "sampleFrequency", std::to_string(file.sample_rate).c_str());
+
+            if (file.channels > 0)
+                ixmlElement_setAttribute(res, "nrAudioChannels", std::to_string(file.channels).c_str());
+
+            if ((file.width > 0) && (file.height > 0))
+                ixmlElement_setAttribute(res, "resolution", (std::to_string(file.width) + "x" + std::to_string(file.height)).c_str());
+        }
+    }
+
+    std::string str() const
+    {
+        DOMString r = ixmlDocumenttoString(doc);
+        const std::string result = r;
+        ixmlFreeDOMString(r);
+
+        return result;
+    }
+
+private:
+    IXML_Element * add_element(IXML_Node *to, const std::string &name)
+    {
+        IXML_Element *e = ixmlDocument_createElement(doc, name.c_str());
+        ixmlNode_appendChild(to, &e->n);
+        return e;
+    }
+
+    IXML_Element * add_textelement(IXML_Node *to, const std::string &name, const std::string &value)
+    {
+        IXML_Element *e = add_element(to, name);
+        IXML_Node *n = ixmlDocument_createTextNode(doc, value.c_str());
+        ixmlNode_appendChild(&e->n, n);
+        return e;
+    }
+
+    static std::string to_time(std::chrono::milliseconds duration)
+    {
+        const auto milliseconds = duration.count();
+
+        std::ostringstream str;
+        str << (milliseconds / 3600000)
+            << ":" << std::setw(2) << std::setfill('0') << ((milliseconds % 3600000) / 60000)
+            << ":" << std::setw(2) << std::setfill('0') << ((milliseconds % 60000) / 1000)
+            << "." << std::setw(3) << std::setfill('0') << (milliseconds % 1000);
+
+        return str.str();
+    }
+
+private:
+    IXML_Document * const doc;
+    IXML_Element * const didl;
+};
+
+void add(pupnp::didl_lite &didl_lite, const struct object &object)
+{
+    if (object.is_item)
+        didl_lite.open_item(object.id, object.parent_id, true);
+    else
+        didl_lite.open_container(object.id, object.parent_id, true, object.child_count);
+
+    didl_lite.add_property("dc:title", object.title);
+
+    for (auto &attribute : object.attributes)
+        if (attribute.first == "upnp:albumArtURI")
+            didl_lite.add_property(attribute.first, attribute.second, "dlna:profileID", "JPEG_TN");
+        else
+            didl_lite.add_property(attribute.first, attribute.second);
+
+    for (auto &file : object.files)
+    {
+        didl_lite.add_res(
+                    file.url, file.protocol_info, object.duration,
+                    file.sample_rate, file.channels, file.width, file.height);
+    }
+
+    didl_lite.close();
+}
+
+std::vector<struct object> make_objects(size_t count)
+{
+    std::vector<struct object> result;
+    for (size_t i = 0; i < count; i++)
+    {
+        struct object object;
+        object.is_item = (i % 4) != 0;
+        object.id = std::to_string(i + 100);
+        object.parent_id = "42";
+        object.title = "Tom & Jerry's \"<Best>\" " + std::to_string(i);
+        object.child_count = ((i % 8) == 0) ? size_t(-1) : i;
+        object.duration = std::chrono::milliseconds(i * 123457);
+
+        if (object.is_item)
+        {
+            object.attributes.emplace_back("upnp:artist", "Artist " + std::to_string(i));
+            object.attributes.emplace_back("upnp:class", "object.item.videoItem");
+            if ((i % 3) == 0)
+                object.attributes.emplace_back("upnp:albumArtURI", "http://host/art/" + std::to_string(i) + ".jpeg");
+
+            for (unsigned j = 0; j < 8; j++)
+            {
+                struct res res;
+                res.url = "http://host:4280/condir/" + std::to_string(i) + "/" + std::to_string(j) + ".mpeg?a=1&b=2";
+                res.protocol_info = "http-get:*:video/mpeg:DLNA.ORG_PN=MPEG_PS_PAL;DLNA.ORG_OP=01";
+                res.sample_rate = (j % 2) ? 48000 : 0;
+                res.channels = (j % 2) ? 2 : 0;
+                res.width = (j % 3) ? 720 : 0;
+                res.height = 576;
+                object.files.emplace_back(res);
+            }
+        }
+        else
+            object.attributes.emplace_back("upnp:class", "object.container.album");
+
+        result.emplace_back(std::move(object));
+    }
+
+    return result;
+}
+
+} // End of namespace
+
+static const struct didl_lite_test
+{
+    didl_lite_test()
+        : identical_test(this, "pupnp::didl_lite::identical", &didl_lite_test::identical),
+          filter_test(this, "pupnp::didl_lite::filter", &didl_lite_test::filter)
+    {
+    }
+
+    struct test identical_test;
+    void identical()
+    {
+        {
+            dom dom;
+            pupnp::didl_lite didl_lite;
+            test_assert(didl_lite.finish() == dom.str());
+        }
+
+        for (size_t count : { 1, 2, 25, 500 })
+        {
+            dom dom;
+            pupnp::didl_lite didl_lite("*");
+            for (auto &object : make_objects(count))
+            {
+                dom.add(object);
+                add(didl_lite, object);
+            }
+
+            test_assert(didl_lite.count() == count);
+            test_assert(didl_lite.finish() == dom.str());
+        }
+    }
+
+    struct test filter_test;
+    void filter()
+    {
+        const auto objects = make_objects(8);
+
+        pupnp::didl_lite minimal("dc:title,res");
+        for (auto &object : objects)
+            add(minimal, object);
+
+        const auto text = minimal.finish();
+        test_assert(text.find("<dc:title>") != text.npos);
+        test_assert(text.find("<upnp:class>") != text.npos);
+        test_assert(text.find("protocolInfo=") != text.npos);
+        test_assert(text.find("<upnp:artist>") == text.npos);
+        test_assert(text.find("upnp:albumArtURI") == text.npos);
+        test_assert(text.find("duration=") == text.npos);
+        test_assert(text.find("sampleFrequency=") == text.npos);
+        test_assert(text.find("childCount=") == text.npos);
+
+        pupnp::didl_lite attributes("upnp:albumArtURI, res@duration,@childCount");
+        for (auto &object : objects)
+            add(attributes, object);
+
+        const auto text2 = attributes.finish();
+        test_assert(text2.find("<upnp:albumArtURI>") != text2.npos);
+        test_assert(text2.find("dlna:profileID") == text2.npos);
+        test_assert(text2.find("duration=") != text2.npos);
+        test_assert(text2.find("resolution=") == text2.npos);
+        test_assert(text2.find("childCount=") != text2.npos);
+    }
+} didl_lite_test;
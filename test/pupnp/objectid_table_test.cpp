@@ -0,0 +1,131 @@
+#include "test.h"
+#include "pupnp/objectid_table.cpp"
+#include "platform/inifile.h"
+#include "platform/path.h"
+#include <cstdio>
+#include <vector>
+
+static const struct objectid_table_test
+{
+    objectid_table_test()
+        : lookup_test(this, "pupnp::objectid_table::lookup", &objectid_table_test::lookup),
+          persist_test(this, "pupnp::objectid_table::persist", &objectid_table_test::persist),
+          cleanup_test(this, "pupnp::objectid_table::cleanup", &objectid_table_test::cleanup),
+          working_set_test(this, "pupnp::objectid_table::working_set", &objectid_table_test::working_set)
+    {
+    }
+
+    struct test lookup_test;
+    void lookup()
+    {
+        const auto filename = platform::temp_file_path("ini");
+        platform::inifile inifile(filename, false);
+        pupnp::objectid_table table(inifile);
+
+        static const char * const paths[] =
+        {
+            "/condir/Videos/", "/condir/Videos/Movie.mkv", "/condir/Videos/Series/",
+            "/condir/Videos/Series/01.mkv", "/condir/Videos/Series/02.mkv",
+            "/condir/Videos/Movie.mkv///p&position=60000#Resume",
+            "/condir/Videos/Movie.mkv///s#Seek", "/Update available/"
+        };
+
+        for (auto path : paths)
+        {
+            const auto id = table.to_id(path);
+            test_assert(id != 0);
+            test_assert(table.to_id(path) == id);
+            test_assert(table.to_id(path, false) == id);
+            test_assert(table.from_id(id) == path);
+        }
+
+        // Each segment is stored once.
+        test_assert(table.size() == 13);
+
+        test_assert(table.to_id("/condir/Music/", false) == 0);
+        test_assert(table.to_id("/condir/Videos/Movie", false) == 0);
+        test_assert(table.to_id("/condir/Videos/Series/", false) < table.to_id("/condir/Videos/Series/01.mkv"));
+        test_assert(table.from_id(12345).empty());
+        test_assert(table.from_id(0).empty());
+
+        ::remove(filename.c_str());
+    }
+
+    struct test persist_test;
+    void persist()
+    {
+        const auto filename = platform::temp_file_path("ini");
+
+        uint32_t movie, series;
+        {
+            platform::inifile inifile(filename, false);
+            pupnp::objectid_table table(inifile);
+            movie = table.to_id("/condir/Videos/Movie.mkv");
+            series = table.to_id("/condir/Videos/Series/");
+            inifile.save();
+        }
+
+        {
+            platform::inifile inifile(filename, false);
+            pupnp::objectid_table table(inifile);
+            test_assert(table.from_id(movie) == "/condir/Videos/Movie.mkv");
+            test_assert(table.from_id(series) == "/condir/Videos/Series/");
+            test_assert(table.to_id("/condir/Videos/Series/", false) == series);
+
+            // New IDs do not collide with the loaded IDs.
+            const auto other = table.to_id("/condir/Videos/Other.mkv");
+            test_assert((other != movie) && (other != series));
+            test_assert(table.from_id(other) == "/condir/Videos/Other.mkv");
+        }
+
+        ::remove(filename.c_str());
+    }
+
+    struct test cleanup_test;
+    void cleanup()
+    {
+        const auto filename = platform::temp_file_path("ini");
+        platform::inifile inifile(filename, false);
+        pupnp::objectid_table table(inifile, 64);
+
+        const auto kept = table.to_id("/condir/Videos/Movie.mkv");
+        for (int i = 0; i < 1000; i++)
+        {
+            table.to_id("/condir/Videos/Movie.mkv///p&position=" + std::to_string(i));
+            table.from_id(kept);
+        }
+
+        test_assert(table.size() <= 64);
+        test_assert(table.from_id(kept) == "/condir/Videos/Movie.mkv");
+
+        // IDs of removed paths are not reused.
+        const auto removed = table.to_id("/condir/Videos/Movie.mkv///p&position=0", false);
+        test_assert(removed == 0);
+        test_assert(table.to_id("/condir/Videos/Movie.mkv///p&position=0") > kept + 1000);
+
+        ::remove(filename.c_str());
+    }
+
+    struct test working_set_test;
+    void working_set()
+    {
+        const auto filename = platform::temp_file_path("ini");
+        platform::inifile inifile(filename, false);
+        pupnp::objectid_table table(inifile, 64);
+
+        // A cleanup while all paths are in use drops only the oldest paths,
+        // and does not cause another cleanup for the next path.
+        std::vector<uint32_t> ids;
+        for (int i = 0; i < 80; i++)
+            ids.push_back(table.to_id("/condir/Videos/" + std::to_string(i) + ".mkv"));
+
+        test_assert(table.size() <= 64);
+        test_assert(table.size() >= 48);
+        for (int i = 80 - 40; i < 80; i++)
+            test_assert(table.from_id(ids[i]) == "/condir/Videos/" + std::to_string(i) + ".mkv");
+
+        test_assert(table.from_id(ids[0]).empty());
+
+        ::remove(filename.c_str());
+    }
+} objectid_table_test;
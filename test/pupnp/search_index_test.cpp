@@ -0,0 +1,215 @@
+#include "test.h"
+#include "pupnp/search_index.cpp"
+#include <algorithm>
+#include <sstream>
+
+static const struct search_index_test
+{
+    search_index_test()
+        : parse_test(this, "pupnp::search_criteria::parse", &search_index_test::parse),
+          find_test(this, "pupnp::search_index::find", &search_index_test::find),
+          remove_test(this, "pupnp::search_index::remove", &search_index_test::remove),
+          large_test(this, "pupnp::search_index::large", &search_index_test::large)
+    {
+    }
+
+    struct test parse_test;
+    void parse()
+    {
+        pupnp::search_criteria criteria;
+        test_assert(criteria.parse("*"));
+        test_assert(criteria.type == pupnp::search_criteria::relation::all);
+
+        test_assert(criteria.parse("dc:title contains \"Foo \\\"Bar\\\"\""));
+        test_assert(criteria.type == pupnp::search_criteria::relation::contains);
+        test_assert(criteria.property == "dc:title");
+        test_assert(criteria.value == "Foo \"Bar\"");
+
+        test_assert(criteria.parse(
+                        "upnp:class derivedfrom \"object.item.videoItem\" and "
+                        "(dc:title contains \"a\" or dc:creator = \"b\") and @refID exists false"));
+
+        test_assert(criteria.type == pupnp::search_criteria::relation::and_);
+        test_assert(criteria.operands.size() == 3);
+        test_assert(criteria.operands[0].type == pupnp::search_criteria::relation::derived_from);
+        test_assert(criteria.operands[1].type == pupnp::search_criteria::relation::or_);
+        test_assert(criteria.operands[1].operands.size() == 2);
+        test_assert(criteria.operands[1].operands[1].type == pupnp::search_criteria::relation::equals);
+        test_assert(criteria.operands[2].type == pupnp::search_criteria::relation::exists);
+        test_assert(criteria.operands[2].value == "false");
+
+        test_assert(criteria.parse("a = \"1\" or b = \"2\" and c = \"3\""));
+        test_assert(criteria.type == pupnp::search_criteria::relation::or_);
+        test_assert(criteria.operands[1].type == pupnp::search_criteria::relation::and_);
+
+        test_assert(!criteria.parse(""));
+        test_assert(!criteria.parse("dc:title contains"));
+        test_assert(!criteria.parse("dc:title contains \"a"));
+        test_assert(!criteria.parse("dc:title like \"a\""));
+        test_assert(!criteria.parse("(dc:title contains \"a\""));
+        test_assert(!criteria.parse("dc:title contains \"a\" and"));
+
+        const auto nested = [](unsigned depth)
+        {
+            return std::string(depth, '(') + "dc:title contains \"a\"" + std::string(depth, ')');
+        };
+
+        test_assert(criteria.parse(nested(64)));
+        test_assert(!criteria.parse(nested(65)));
+        test_assert(!criteria.parse(nested(100000)));
+    }
+
+    static std::vector<std::string> find(const pupnp::search_index &index, const char *text, const char *scope = "/")
+    {
+        pupnp::search_criteria criteria;
+        test_assert(criteria.parse(text));
+
+        size_t count = 0;
+        const auto result = index.find(criteria, scope, 0, count);
+        test_assert(count == result.size());
+        return result;
+    }
+
+    static pupnp::search_index make_index()
+    {
+        pupnp::search_index index;
+        index.add("/Movies/Big Buck Bunny.mkv", "object.item.videoItem", "Big Buck Bunny");
+        index.add("/Movies/Sintel.mp4", "object.item.videoItem.movie", "Sintel");
+        index.add("/Music/Bunny Tunes/01 Intro.mp3", "object.item.audioItem", "01 Intro", "The Bunnies", "Bunny Tunes");
+        index.add("/Pictures/bunny.jpg", "object.item.imageItem", "bunny");
+        return index;
+    }
+
+    struct test find_test;
+    void find()
+    {
+        const auto index = make_index();
+        test_assert(index.size() == 4);
+
+        test_assert(find(index, "*").size() == 4);
+        test_assert(find(index, "dc:title contains \"bunny\"").size() == 3);
+        test_assert(find(index, "dc:title contains \"BUCK BUN\"") == std::vector<std::string>({ "/Movies/Big Buck Bunny.mkv" }));
+        test_assert(find(index, "dc:title contains \"movies\"").size() == 2);
+        test_assert(find(index, "dc:title contains \"xyz\"").empty());
+        test_assert(find(index, "dc:title contains \"unny\"").size() == 3);
+        test_assert(find(index, "dc:title contains \"ck bun\"") == std::vector<std::string>({ "/Movies/Big Buck Bunny.mkv" }));
+        test_assert(find(index, "dc:title contains \" unny\"").empty());
+        test_assert(find(index, "upnp:artist contains \"unnie\"").size() == 1);
+        test_assert(find(index, "dc:title = \"sintel\"") == std::vector<std::string>({ "/Movies/Sintel.mp4" }));
+        test_assert(find(index, "dc:title doesNotContain \"bunny\"").size() == 2);
+        test_assert(find(index, "upnp:artist contains \"bunnies\"").size() == 1);
+        test_assert(find(index, "dc:creator = \"the bunnies\"").size() == 1);
+        test_assert(find(index, "upnp:album startsWith \"bunny\"").size() == 1);
+        test_assert(find(index, "upnp:genre contains \"rock\"").empty());
+
+        test_assert(find(index, "upnp:class derivedfrom \"object.item.videoItem\"").size() == 2);
+        test_assert(find(index, "upnp:class = \"object.item.videoItem\"").size() == 1);
+        test_assert(find(index, "upnp:class derivedfrom \"object.item\"").size() == 4);
+        test_assert(find(index, "upnp:class derivedfrom \"object.item.video\"").empty());
+        test_assert(find(index, "upnp:class derivedfrom \"object.container\"").empty());
+
+        test_assert(find(index,
+                         "upnp:class derivedfrom \"object.item.videoItem\" and "
+                         "dc:title contains \"bunny\"") == std::vector<std::string>({ "/Movies/Big Buck Bunny.mkv" }));
+
+        test_assert(find(index,
+                         "upnp:class derivedfrom \"object.item.imageItem\" or "
+                         "upnp:class derivedfrom \"object.item.audioItem\"").size() == 2);
+
+        test_assert(find(index, "upnp:artist exists true").size() == 1);
+        test_assert(find(index, "upnp:artist exists false").size() == 3);
+        test_assert(find(index, "@refID exists false").size() == 4);
+
+        test_assert(find(index, "dc:title contains \"bunny\"", "/Movies/").size() == 1);
+        test_assert(find(index, "*", "/Music/Bunny Tunes/").size() == 1);
+
+        pupnp::search_criteria criteria;
+        test_assert(criteria.parse("upnp:class derivedfrom \"object.item\""));
+        size_t count = 2;
+        const auto page = index.find(criteria, "/", 1, count);
+        test_assert(count == 4);
+        test_assert(page == std::vector<std::string>({ "/Movies/Sintel.mp4", "/Music/Bunny Tunes/01 Intro.mp3" }));
+    }
+
+    struct test remove_test;
+    void remove()
+    {
+        auto index = make_index();
+        index.remove("/Movies/Sintel.mp4");
+        test_assert(index.size() == 3);
+        test_assert(find(index, "dc:title contains \"sintel\"").empty());
+        test_assert(find(index, "*").size() == 3);
+
+        index.add("/Movies/Sintel.mp4", "object.item.videoItem", "Sintel");
+        index.add("/Movies/Sintel.mp4", "object.item.videoItem", "Sintel");
+        test_assert(index.size() == 4);
+        test_assert(find(index, "dc:title contains \"sintel\"").size() == 1);
+
+        for (int i = 0; i < 3000; i++)
+            index.add("/Other/" + std::to_string(i) + ".mkv", "object.item.videoItem", std::to_string(i));
+
+        for (int i = 0; i < 3000; i++)
+            index.remove("/Other/" + std::to_string(i) + ".mkv");
+
+        test_assert(index.size() == 4);
+        test_assert(find(index, "*").size() == 4);
+        test_assert(find(index, "upnp:class derivedfrom \"object.item.videoItem\"").size() == 2);
+        test_assert(find(index, "upnp:album contains \"tunes\"").size() == 1);
+
+        index.remove("/Music/");
+        test_assert(index.size() == 3);
+        test_assert(find(index, "upnp:album contains \"tunes\"").empty());
+
+        index.clear();
+        test_assert(index.size() == 0);
+        test_assert(find(index, "*").empty());
+    }
+
+    struct test large_test;
+    void large()
+    {
+        static const unsigned count = 100000;
+        static const char * const words[] =
+        {
+            "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+            "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa"
+        };
+
+        static const char * const classes[] =
+        {
+            "object.item.videoItem", "object.item.videoItem.movie",
+            "object.item.audioItem", "object.item.imageItem"
+        };
+
+        pupnp::search_index index;
+        for (unsigned i = 0; i < count; i++)
+        {
+            std::ostringstream title;
+            title << words[i % 16] << ' ' << words[(i / 16) % 16] << ' ' << words[(i / 256) % 16] << ' ' << i;
+
+            std::ostringstream path;
+            path << '/' << words[(i / 4096) % 16] << '/' << title.str() << ".mkv";
+
+            index.add(path.str(), classes[i % 4], title.str());
+        }
+
+        test_assert(index.size() == count);
+
+        const auto titles = find(index, "dc:title contains \"4321\"");
+        test_assert(titles.size() == 20); // 4321, 43210 to 43219 and 14321 to 94321
+
+        const auto title_classes = find(
+                    index,
+                    "upnp:class derivedfrom \"object.item.videoItem\" and "
+                    "dc:title contains \"alpha bravo charlie\"");
+
+        test_assert(title_classes.size() == 25); // i % 4096 == 528
+
+        pupnp::search_criteria images;
+        test_assert(images.parse("upnp:class derivedfrom \"object.item.imageItem\""));
+        size_t images_count = 50;
+        const auto images_page = index.find(images, "/", 1000, images_count);
+        test_assert(images_page.size() == 50);
+        test_assert(images_count == count / 4);
+    }
+} search_index_test;
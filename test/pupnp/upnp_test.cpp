@@ -0,0 +1,49 @@
+#include "test.h"
+#include "pupnp/upnp.cpp"
+
+namespace pupnp {
+
+static const struct upnp_test
+{
+    upnp_test()
+        : accepts_encoding_test(this, "pupnp::upnp::accepts_encoding", &upnp_test::accepts_encoding)
+    {
+    }
+
+    struct test accepts_encoding_test;
+    void accepts_encoding()
+    {
+        test_assert(pupnp::accepts_encoding("gzip", "gzip"));
+        test_assert(pupnp::accepts_encoding("deflate, GZIP", "gzip"));
+        test_assert(!pupnp::accepts_encoding("", "gzip"));
+        test_assert(!pupnp::accepts_encoding("identity", "gzip"));
+        test_assert(!pupnp::accepts_encoding("gzipx", "gzip"));
+
+        test_assert(!pupnp::accepts_encoding("gzip;q=0", "gzip"));
+        test_assert(!pupnp::accepts_encoding("gzip;q=0.0, deflate", "gzip"));
+        test_assert(pupnp::accepts_encoding("gzip;q=0.5", "gzip"));
+
+        test_assert(pupnp::accepts_encoding("*", "gzip"));
+        test_assert(pupnp::accepts_encoding("*", "deflate"));
+        test_assert(!pupnp::accepts_encoding("*;q=0", "gzip"));
+
+        // An entry for the encoding itself takes precedence over "*".
+        test_assert(pupnp::accepts_encoding("*;q=0, gzip", "gzip"));
+        test_assert(pupnp::accepts_encoding("gzip, *;q=0", "gzip"));
+        test_assert(!pupnp::accepts_encoding("*, gzip;q=0", "gzip"));
+        test_assert(!pupnp::accepts_encoding("gzip;q=0, *", "gzip"));
+
+        // Whitespace around the parameters.
+        test_assert(!pupnp::accepts_encoding("gzip ; q=0", "gzip"));
+        test_assert(!pupnp::accepts_encoding(" gzip\t;q=0 , deflate", "gzip"));
+        test_assert(pupnp::accepts_encoding("gzip ; q=1", "gzip"));
+
+        // Only deflate is accepted.
+        test_assert(!pupnp::accepts_encoding("gzip;q=0, deflate", "gzip"));
+        test_assert(pupnp::accepts_encoding("gzip;q=0, deflate", "deflate"));
+        test_assert(!pupnp::accepts_encoding("deflate, *;q=0", "gzip"));
+        test_assert(pupnp::accepts_encoding("deflate, *;q=0", "deflate"));
+    }
+} upnp_test;
+
+} // End of namespace
@@ -8,6 +8,15 @@
 #include "resources/resource_file.h"
 #include "resources/resources.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#if defined(__unix__)
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
 
 namespace vlc {
 
@@ -15,11 +24,22 @@ static const struct media_cache_test
 {
     const resources::resource_file pm5544_png;
     std::string media_cache_file;
+    std::string media_fingerprints_file;
+    std::string media_store_file;
 
     media_cache_test()
         : pm5544_png(resources::pm5544_png, "png"),
           media_cache_file(platform::temp_file_path("ini")),
-          png_test(this, "vlc::media::png", &media_cache_test::png)
+          media_fingerprints_file(platform::temp_file_path("ini")),
+          media_store_file(platform::temp_file_path("db")),
+          png_test(this, "vlc::media::png", &media_cache_test::png),
+          uuid_index_test(this, "vlc::media_cache::uuid_index", &media_cache_test::uuid_index),
+          import_test(this, "vlc::media_cache::import", &media_cache_test::import),
+          info_cache_test(this, "vlc::media_cache::info_cache", &media_cache_test::info_cache),
+          concurrent_test(this, "vlc::media_cache::concurrent", &media_cache_test::concurrent),
+          subtitle_index_test(this, "vlc::subtitles::directory_index", &media_cache_test::subtitle_index),
+          dispatch_test(this, "vlc::media_cache::dispatch", &media_cache_test::dispatch),
+          dispatch_timeout_test(this, "vlc::media_cache::dispatch_timeout", &media_cache_test::dispatch_timeout)
     {
     }
 
@@ -27,6 +47,12 @@ static const struct media_cache_test
     {
         if (!media_cache_file.empty())
             ::remove(media_cache_file.c_str());
+
+        if (!media_fingerprints_file.empty())
+            ::remove(media_fingerprints_file.c_str());
+
+        if (!media_store_file.empty())
+            ::remove(media_store_file.c_str());
     }
 
     struct test png_test;
@@ -38,7 +64,9 @@ static const struct media_cache_test
         test_assert(!mrl.empty());
 
         class platform::inifile inifile(media_cache_file, false);
-        class media_cache media_cache(messageloop_ref, inifile);
+        class platform::inifile fingerprint_file(media_fingerprints_file, false);
+        class platform::recordfile recordfile(media_store_file);
+        class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
 
         static const platform::uuid ref_uuid("6c9a8849-dbd4-5b7e-8f50-0916d1294251");
         test_assert(media_cache.uuid(mrl) == ref_uuid);
@@ -64,6 +92,328 @@ static const struct media_cache_test
             }
         }
     }
+
+    struct test uuid_index_test;
+    void uuid_index()
+    {
+        class platform::messageloop messageloop;
+        class platform::messageloop_ref messageloop_ref(messageloop);
+
+        const auto path = platform::temp_file_path("png");
+        platform::ofstream(path, std::ios_base::binary).write(
+                    reinterpret_cast<const char *>(resources::pm5544_png),
+                    sizeof(resources::pm5544_png));
+
+        const auto mrl = platform::mrl_from_path(path);
+        test_assert(!mrl.empty());
+
+        class platform::inifile inifile(media_cache_file, false);
+        class platform::inifile fingerprint_file(media_fingerprints_file, false);
+        class platform::recordfile recordfile(media_store_file);
+        platform::uuid uuid;
+        {
+            class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+            uuid = media_cache.uuid(mrl);
+            test_assert(!uuid.is_null());
+        }
+
+        test_assert(!inifile.has_section("fingerprints"));
+
+        // Replace the indexed UUID, it should be used without hashing the file.
+        auto fingerprints = fingerprint_file.open_section("fingerprints");
+        auto value = fingerprints.read(mrl);
+        test_assert(!value.empty());
+
+        const auto indexed_uuid = platform::uuid::generate();
+        fingerprints.write(mrl, value.substr(0, value.find_last_of(' ') + 1) + std::string(indexed_uuid));
+        {
+            class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+            test_assert(media_cache.uuid(mrl) == indexed_uuid);
+        }
+
+        // A modified file is hashed again.
+        platform::ofstream(path, std::ios_base::binary | std::ios_base::app) << '\0';
+        {
+            class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+            const auto new_uuid = media_cache.uuid(mrl);
+            test_assert(!new_uuid.is_null());
+            test_assert(new_uuid != indexed_uuid);
+            test_assert(new_uuid != uuid);
+        }
+
+        ::remove(path.c_str());
+    }
+
+    struct test import_test;
+    void import()
+    {
+        class platform::messageloop messageloop;
+        class platform::messageloop_ref messageloop_ref(messageloop);
+        auto mrl = platform::mrl_from_path(pm5544_png);
+        test_assert(!mrl.empty());
+
+        const auto ini_file = platform::temp_file_path("ini");
+        const auto store_file = platform::temp_file_path("db");
+        {
+            class platform::inifile inifile(ini_file, false);
+            class platform::inifile fingerprint_file(media_fingerprints_file, false);
+            inifile.open_section("rev_2").write(
+                        "6c9a8849-dbd4-5b7e-8f50-0916d1294251",
+                        "{ 0 \"\" \"\" 2 768 576 0 0 } 0 0");
+
+            class platform::recordfile recordfile(store_file);
+            {
+                class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+                test_assert(media_cache.media_type(mrl) == media_type::picture);
+                test_assert(media_cache.has_media_info(mrl));
+            }
+
+            test_assert(!inifile.has_section("rev_2"));
+        }
+
+        // The imported data should be stored in the binary store.
+        {
+            class platform::inifile inifile(ini_file, false);
+            class platform::inifile fingerprint_file(media_fingerprints_file, false);
+            class platform::recordfile recordfile(store_file);
+            class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+
+            const auto media_info = media_cache.media_info(mrl);
+            test_assert(media_info.tracks.size() == 1);
+            test_assert(media_info.tracks[0].type == track_type::video);
+            test_assert(media_info.tracks[0].video.width == 768);
+            test_assert(media_info.tracks[0].video.height == 576);
+        }
+
+        ::remove(ini_file.c_str());
+        ::remove(store_file.c_str());
+    }
+
+    struct test info_cache_test;
+    void info_cache()
+    {
+        class platform::messageloop messageloop;
+        class platform::messageloop_ref messageloop_ref(messageloop);
+        auto mrl = platform::mrl_from_path(pm5544_png);
+
+        const auto ini_file = platform::temp_file_path("ini");
+        const auto store_file = platform::temp_file_path("db");
+        {
+            class platform::inifile inifile(ini_file, false);
+            class platform::inifile fingerprint_file(media_fingerprints_file, false);
+            inifile.open_section("rev_2").write(
+                        "6c9a8849-dbd4-5b7e-8f50-0916d1294251",
+                        "{ 0 \"\" \"\" 2 768 576 0 0 } 0 0");
+
+            class platform::recordfile recordfile(store_file);
+            class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+
+            test_assert(media_cache.media_type(mrl) == media_type::picture);
+            test_assert(media_cache.info_cache_misses() == 1);
+            test_assert(media_cache.info_cache_hits() == 0);
+
+            for (int i = 0; i < 4; i++)
+            {
+                test_assert(media_cache.media_type(mrl) == media_type::picture);
+                test_assert(media_cache.media_info(mrl).tracks.size() == 1);
+            }
+
+            test_assert(media_cache.info_cache_misses() == 1);
+            test_assert(media_cache.info_cache_hits() == 8);
+        }
+
+        ::remove(ini_file.c_str());
+        ::remove(store_file.c_str());
+    }
+
+    struct test concurrent_test;
+    void concurrent()
+    {
+        class platform::messageloop messageloop;
+        class platform::messageloop_ref messageloop_ref(messageloop);
+        auto mrl = platform::mrl_from_path(pm5544_png);
+
+        const auto ini_file = platform::temp_file_path("ini");
+        const auto store_file = platform::temp_file_path("db");
+        {
+            class platform::inifile inifile(ini_file, false);
+            class platform::inifile fingerprint_file(media_fingerprints_file, false);
+            inifile.open_section("rev_2").write(
+                        "6c9a8849-dbd4-5b7e-8f50-0916d1294251",
+                        "{ 0 \"\" \"\" 2 768 576 0 0 } 0 0");
+
+            class platform::recordfile recordfile(store_file);
+            class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
+            test_assert(media_cache.media_type(mrl) == media_type::picture);
+
+            // The lookups a Browse of a directory does for each item, from
+            // multiple threads at once.
+            static const int count = 20000;
+            const unsigned num_threads = std::max(std::thread::hardware_concurrency(), 2u);
+
+            std::atomic<int> failed(0);
+            std::vector<std::thread> threads;
+            for (unsigned i = 0; i < num_threads; i++)
+                threads.emplace_back([&media_cache, &mrl, &failed]
+                {
+                    for (int j = 0; j < count; j++)
+                        if (media_cache.uuid(mrl).is_null() ||
+                            !media_cache.has_media_info(mrl) ||
+                            (media_cache.media_type(mrl) != media_type::picture) ||
+                            (media_cache.media_info(mrl).tracks.size() != 1))
+                        {
+                            failed++;
+                        }
+                });
+
+            for (auto &i : threads)
+                i.join();
+
+            test_assert(failed == 0);
+        }
+
+        ::remove(ini_file.c_str());
+        ::remove(store_file.c_str());
+    }
+
+    struct test subtitle_index_test;
+    void subtitle_index()
+    {
+#if defined(__unix__)
+        // Temporary files are hidden from directory listings, so a new
+        // directory is created in the current directory.
+        const std::string dir = "./" + std::string(platform::uuid::generate());
+        test_assert(::mkdir(dir.c_str(), 0755) == 0);
+
+        const std::string name = std::string(platform::uuid::generate());
+        const auto subtitle = dir + '/' + name + ".en.srt";
+        const auto other = dir + '/' + name.substr(0, name.length() - 1) + ".srt";
+        platform::ofstream(subtitle) << "1\n00:00:01,000 --> 00:00:02,000\nHello\n";
+        platform::ofstream(other) << "1\n00:00:01,000 --> 00:00:02,000\nHello\n";
+
+        const subtitles::directory_index index(dir);
+        const auto files = index.find_subtitle_files(name + ".png");
+        const auto found = subtitles::find_subtitle_files(dir + '/' + name + ".png");
+
+        ::remove(subtitle.c_str());
+        ::remove(other.c_str());
+        ::rmdir(dir.c_str());
+
+        test_assert(std::find(files.begin(), files.end(), subtitle) != files.end());
+        test_assert(std::find(files.begin(), files.end(), other) == files.end());
+        test_assert(found == files);
+#endif
+    }
+
+    struct test dispatch_test;
+    void dispatch()
+    {
+        static const size_t num_workers = 4;
+
+        std::set<std::string> tasks;
+        for (int i = 0; i < 128; i++)
+            tasks.insert(std::to_string(100 + i));
+
+        tasks.insert("000-slow");
+        const size_t num_tasks = tasks.size();
+
+        std::vector<std::deque<std::string>> workers(num_workers);
+        std::vector<size_t> received(num_workers, 0), max_in_flight(num_workers, 0);
+        const auto send = [&workers, &max_in_flight](size_t i, const std::string &task)
+        {
+            workers[i].push_back(task);
+            max_in_flight[i] = std::max(max_in_flight[i], workers[i].size());
+            return true;
+        };
+
+        // The first task only finishes when all tasks that are not queued
+        // behind it have finished, which requires the other workers to pull
+        // them.
+        std::atomic<size_t> total_received(0);
+        const auto receive = [&workers, &received, &total_received, num_tasks](size_t i)
+        {
+            if (workers[i].front() == "000-slow")
+                while ((total_received + workers[i].size()) < num_tasks)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            workers[i].pop_front();
+            received[i]++;
+            total_received++;
+            return true;
+        };
+
+        const auto abort = [](size_t) { test_assert(false); };
+
+        std::set<std::string> timed_out;
+        dispatch_tasks(
+                    num_workers, process_window, std::chrono::seconds(10),
+                    tasks,
+                    send, receive, abort,
+                    timed_out);
+
+        test_assert(tasks.empty());
+        test_assert(timed_out.empty());
+        test_assert(total_received == num_tasks);
+
+        size_t sum = 0, used = 0;
+        for (size_t i = 0; i < num_workers; i++)
+        {
+            test_assert(max_in_flight[i] <= process_window);
+            test_assert(workers[i].empty());
+            sum += received[i];
+            if (received[i] > 0)
+                used++;
+        }
+
+        test_assert(sum == num_tasks);
+        test_assert(used > 1);
+    }
+
+    struct test dispatch_timeout_test;
+    void dispatch_timeout()
+    {
+        std::set<std::string> tasks;
+        for (int i = 0; i < 16; i++)
+            tasks.insert(std::to_string(100 + i));
+
+        tasks.insert("hang");
+
+        std::vector<std::deque<std::string>> workers(2);
+        const auto send = [&workers](size_t i, const std::string &task)
+        {
+            workers[i].push_back(task);
+            return true;
+        };
+
+        std::atomic<bool> killed(false);
+        const auto receive = [&workers, &killed](size_t i)
+        {
+            if (workers[i].front() == "hang")
+            {
+                while (!killed)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+                return false;
+            }
+
+            workers[i].pop_front();
+            return true;
+        };
+
+        const auto abort = [&killed](size_t) { killed = true; };
+
+        std::set<std::string> timed_out;
+        dispatch_tasks(
+                    workers.size(), 1, std::chrono::milliseconds(50),
+                    tasks,
+                    send, receive, abort,
+                    timed_out);
+
+        test_assert(killed);
+        test_assert(tasks.empty());
+        test_assert(timed_out.size() == 1);
+        test_assert(*timed_out.begin() == "hang");
+    }
 } media_cache_test;
 
 } // End of namespace
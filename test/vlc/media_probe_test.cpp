@@ -0,0 +1,469 @@
+#include "test.h"
+#include "vlc/media_probe.cpp"
+#include "platform/fstream.h"
+#include "platform/path.h"
+#include "resources/resource_file.h"
+#include "resources/resources.h"
+#include <chrono>
+#include <cstdio>
+
+namespace vlc {
+
+static const struct media_probe_test
+{
+    std::vector<std::string> files;
+
+    media_probe_test()
+        : mp4_test(this, "vlc::media_probe::mp4", &media_probe_test::mp4),
+          mkv_test(this, "vlc::media_probe::mkv", &media_probe_test::mkv),
+          ts_test(this, "vlc::media_probe::ts", &media_probe_test::ts),
+          ps_test(this, "vlc::media_probe::ps", &media_probe_test::ps),
+          unsupported_test(this, "vlc::media_probe::unsupported", &media_probe_test::unsupported),
+          malformed_test(this, "vlc::media_probe::malformed", &media_probe_test::malformed)
+    {
+    }
+
+    ~media_probe_test()
+    {
+        for (auto &i : files)
+            ::remove(i.c_str());
+    }
+
+    static void u8(std::string &s, unsigned v)      { s.push_back(char(v)); }
+    static void u16(std::string &s, unsigned v)     { u8(s, v >> 8); u8(s, v); }
+    static void u32(std::string &s, uint32_t v)     { u16(s, v >> 16); u16(s, v); }
+    static void zeros(std::string &s, size_t n)     { s.append(n, '\0'); }
+
+    static std::string box(const char *type, const std::string &payload)
+    {
+        std::string result;
+        u32(result, uint32_t(payload.size() + 8));
+        return result + type + payload;
+    }
+
+    static std::string ebml(uint32_t id, const std::string &payload)
+    {
+        std::string result;
+        for (int i = 3; i >= 0; i--)
+            if ((id >> (i * 8)) != 0)
+                u8(result, id >> (i * 8));
+
+        u8(result, 0x01); // 8 byte size
+        for (int i = 6; i >= 0; i--)
+            u8(result, unsigned(uint64_t(payload.size()) >> (i * 8)));
+
+        return result + payload;
+    }
+
+    static std::string ebml_uint(uint32_t id, uint32_t value)
+    {
+        std::string payload;
+        u32(payload, value);
+        return ebml(id, payload);
+    }
+
+    static std::string ebml_float(uint32_t id, double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        std::string payload;
+        u32(payload, uint32_t(bits >> 32));
+        u32(payload, uint32_t(bits));
+        return ebml(id, payload);
+    }
+
+    static std::string ts_packet(unsigned pid, bool unit_start, const std::string &payload)
+    {
+        std::string result;
+        u8(result, 0x47);
+        u16(result, (unit_start ? 0x4000 : 0) | pid);
+        u8(result, 0x10);
+        result += payload.substr(0, 184);
+        result.append(188 - result.size(), char(0xFF));
+        return result;
+    }
+
+    static std::string ts_pcr_packet(unsigned pid, uint64_t pcr)
+    {
+        std::string result;
+        u8(result, 0x47);
+        u16(result, pid);
+        u8(result, 0x20);
+        u8(result, 183);
+        u8(result, 0x10);
+        u32(result, uint32_t(pcr >> 1));
+        u8(result, ((pcr & 1) << 7) | 0x7E);
+        u8(result, 0x00);
+        result.append(188 - result.size(), char(0xFF));
+        return result;
+    }
+
+    static std::string pes(unsigned stream_id, const std::string &payload)
+    {
+        std::string result;
+        u32(result, 0x00000100 | stream_id);
+        u16(result, unsigned(payload.size() + 3));
+        u8(result, 0x80);
+        u8(result, 0x00);
+        u8(result, 0x00);
+        return result + payload;
+    }
+
+    static std::string ps_pack(uint64_t scr)
+    {
+        std::string result;
+        u32(result, 0x000001BA);
+        u8(result, 0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 0x03));
+        u8(result, unsigned(scr >> 20));
+        u8(result, 0x04 | ((scr >> 12) & 0xF8) | ((scr >> 13) & 0x03));
+        u8(result, unsigned(scr >> 5));
+        u8(result, ((scr << 3) & 0xF8) | 0x04);
+        u8(result, 0x01);
+        u8(result, 0x01); u8(result, 0x89); u8(result, 0xC3);
+        u8(result, 0xF8);
+        return result;
+    }
+
+    static std::string mpeg2_sequence_header()
+    {
+        std::string result;
+        u32(result, 0x000001B3);
+        u8(result, 0x2D); u8(result, 0x02); u8(result, 0x40); // 720x576
+        u8(result, 0x23); // 4:3, 25 fps
+        zeros(result, 8);
+        return result;
+    }
+
+    std::string write_file(const std::string &data, const char *suffix)
+    {
+        const auto path = platform::temp_file_path(suffix);
+        platform::ofstream(path, std::ios_base::binary) << data;
+        files.push_back(path);
+
+        return path;
+    }
+
+    std::string make_mp4()
+    {
+        std::string ftyp = "isom";
+        u32(ftyp, 0x200);
+        ftyp += "isomavc1";
+
+        std::string mvhd;
+        zeros(mvhd, 12);
+        u32(mvhd, 1000);
+        u32(mvhd, 90000);
+        zeros(mvhd, 80);
+
+        std::string video_tkhd;
+        zeros(video_tkhd, 12);
+        u32(video_tkhd, 1);
+        zeros(video_tkhd, 64);
+        u32(video_tkhd, 1280 << 16);
+        u32(video_tkhd, 720 << 16);
+
+        std::string video_mdhd;
+        zeros(video_mdhd, 12);
+        u32(video_mdhd, 25000);
+        u32(video_mdhd, 2250000);
+        u16(video_mdhd, 0x55C4); // und
+        zeros(video_mdhd, 2);
+
+        std::string video_hdlr;
+        zeros(video_hdlr, 8);
+        video_hdlr += "vide";
+        zeros(video_hdlr, 13);
+
+        std::string video_stsd;
+        zeros(video_stsd, 4);
+        u32(video_stsd, 1);
+        std::string avc1;
+        zeros(avc1, 24);
+        u16(avc1, 1280);
+        u16(avc1, 720);
+        zeros(avc1, 50);
+        video_stsd += box("avc1", avc1);
+
+        std::string video_stts;
+        zeros(video_stts, 4);
+        u32(video_stts, 1);
+        u32(video_stts, 2250);
+        u32(video_stts, 1000);
+
+        const auto video_trak = box("trak",
+                box("tkhd", video_tkhd) +
+                box("mdia",
+                    box("mdhd", video_mdhd) +
+                    box("hdlr", video_hdlr) +
+                    box("minf", box("stbl", box("stsd", video_stsd) + box("stts", video_stts)))));
+
+        std::string audio_tkhd;
+        zeros(audio_tkhd, 12);
+        u32(audio_tkhd, 2);
+        zeros(audio_tkhd, 72);
+
+        std::string audio_mdhd;
+        zeros(audio_mdhd, 12);
+        u32(audio_mdhd, 48000);
+        u32(audio_mdhd, 4320000);
+        u16(audio_mdhd, (('e' - 0x60) << 10) | (('n' - 0x60) << 5) | ('g' - 0x60));
+        zeros(audio_mdhd, 2);
+
+        std::string audio_hdlr;
+        zeros(audio_hdlr, 8);
+        audio_hdlr += "soun";
+        zeros(audio_hdlr, 13);
+
+        std::string audio_stsd;
+        zeros(audio_stsd, 4);
+        u32(audio_stsd, 1);
+        std::string mp4a;
+        zeros(mp4a, 16);
+        u16(mp4a, 2);
+        u16(mp4a, 16);
+        zeros(mp4a, 4);
+        u32(mp4a, 48000u << 16);
+        audio_stsd += box("mp4a", mp4a);
+
+        const auto audio_trak = box("trak",
+                box("tkhd", audio_tkhd) +
+                box("mdia",
+                    box("mdhd", audio_mdhd) +
+                    box("hdlr", audio_hdlr) +
+                    box("minf", box("stbl", box("stsd", audio_stsd)))));
+
+        return write_file(
+                    box("ftyp", ftyp) +
+                    box("moov", box("mvhd", mvhd) + video_trak + audio_trak) +
+                    box("mdat", std::string(4096, '\0')),
+                    "mp4");
+    }
+
+    std::string make_mkv()
+    {
+        const auto header = ebml(0x1A45DFA3, ebml(0x4282, "matroska"));
+
+        const auto info = ebml(0x1549A966,
+                ebml_uint(0x2AD7B1, 1000000) +
+                ebml_float(0x4489, 120000.0));
+
+        const auto tracks = ebml(0x1654AE6B,
+                ebml(0xAE,
+                     ebml_uint(0xD7, 1) +
+                     ebml_uint(0x83, 1) +
+                     ebml_uint(0x23E383, 40000000) +
+                     ebml(0xE0, ebml_uint(0xB0, 1920) + ebml_uint(0xBA, 1080))) +
+                ebml(0xAE,
+                     ebml_uint(0xD7, 2) +
+                     ebml_uint(0x83, 2) +
+                     ebml(0x22B59C, "dut") +
+                     ebml(0xE1, ebml_float(0xB5, 44100.0) + ebml_uint(0x9F, 2))));
+
+        const auto cluster = ebml(0x1F43B675, std::string(4096, '\0'));
+
+        return write_file(header + ebml(0x18538067, info + tracks + cluster), "mkv");
+    }
+
+    std::string make_ts(unsigned video_stream_type)
+    {
+        std::string pat;
+        u8(pat, 0x00); // pointer_field
+        u8(pat, 0x00);
+        u16(pat, 0xB000 | 13);
+        u16(pat, 1);
+        u8(pat, 0xC1); u8(pat, 0x00); u8(pat, 0x00);
+        u16(pat, 1);
+        u16(pat, 0xE000 | 0x100);
+        u32(pat, 0);
+
+        std::string pmt;
+        u8(pmt, 0x00); // pointer_field
+        u8(pmt, 0x02);
+        u16(pmt, 0xB000 | 29);
+        u16(pmt, 1);
+        u8(pmt, 0xC1); u8(pmt, 0x00); u8(pmt, 0x00);
+        u16(pmt, 0xE000 | 0x101);
+        u16(pmt, 0xF000);
+        u8(pmt, video_stream_type);
+        u16(pmt, 0xE000 | 0x101);
+        u16(pmt, 0xF000);
+        u8(pmt, 0x03);
+        u16(pmt, 0xE000 | 0x102);
+        u16(pmt, 0xF000 | 6);
+        u8(pmt, 0x0A); u8(pmt, 4); pmt += "fre"; u8(pmt, 0);
+        u32(pmt, 0);
+
+        std::string audio_frame;
+        u8(audio_frame, 0xFF); u8(audio_frame, 0xFD); // MPEG-1 layer 2
+        u8(audio_frame, 0xC4); // 48 kHz
+        u8(audio_frame, 0x00); // Stereo
+        zeros(audio_frame, 16);
+
+        std::string result =
+                ts_packet(0x000, true, pat) +
+                ts_packet(0x100, true, pmt) +
+                ts_pcr_packet(0x101, 900000) +
+                ts_packet(0x101, true, pes(0xE0, mpeg2_sequence_header())) +
+                ts_packet(0x102, true, pes(0xC0, audio_frame));
+
+        for (unsigned i = 0; i < 64; i++)
+            result += ts_packet(0x1FFF, false, std::string());
+
+        result += ts_pcr_packet(0x101, 900000 + (60000 * 90));
+
+        return write_file(result, "ts");
+    }
+
+    std::string make_ps()
+    {
+        std::string ac3_frame;
+        u8(ac3_frame, 0x80); // Substream ID
+        u8(ac3_frame, 0x01); u16(ac3_frame, 0x0001);
+        u16(ac3_frame, 0x0B77);
+        u16(ac3_frame, 0x0000);
+        u8(ac3_frame, 0x1C); // 48 kHz
+        u8(ac3_frame, 0x40); // bsid 8
+        u8(ac3_frame, 0xE1); // 3/2 + LFE
+        zeros(ac3_frame, 16);
+
+        std::string result =
+                ps_pack(900000) +
+                pes(0xE0, mpeg2_sequence_header()) +
+                pes(0xBD, ac3_frame);
+
+        for (unsigned i = 0; i < 64; i++)
+            result += ps_pack(900000 + (i * 3600)) + pes(0xE0, std::string(256, '\0'));
+
+        result += ps_pack(900000 + (30000 * 90));
+        u32(result, 0x000001B9);
+
+        return write_file(result, "mpg");
+    }
+
+    struct test mp4_test;
+    void mp4()
+    {
+        struct media_cache::media_info media_info;
+        test_assert(probe_media_info(make_mp4(), media_info));
+        test_assert(media_info.duration == std::chrono::milliseconds(90000));
+        test_assert(media_info.tracks.size() == 2);
+
+        test_assert(media_info.tracks[0].type == track_type::video);
+        test_assert(media_info.tracks[0].id == 1);
+        test_assert(media_info.tracks[0].video.width == 1280);
+        test_assert(media_info.tracks[0].video.height == 720);
+        test_assert(media_info.tracks[0].video.frame_rate_num == 25);
+        test_assert(media_info.tracks[0].video.frame_rate_den == 1);
+
+        test_assert(media_info.tracks[1].type == track_type::audio);
+        test_assert(media_info.tracks[1].id == 2);
+        test_assert(media_info.tracks[1].language == "eng");
+        test_assert(media_info.tracks[1].audio.sample_rate == 48000);
+        test_assert(media_info.tracks[1].audio.channels == 2);
+    }
+
+    struct test mkv_test;
+    void mkv()
+    {
+        struct media_cache::media_info media_info;
+        test_assert(probe_media_info(make_mkv(), media_info));
+        test_assert(media_info.duration == std::chrono::milliseconds(120000));
+        test_assert(media_info.tracks.size() == 2);
+
+        test_assert(media_info.tracks[0].type == track_type::video);
+        test_assert(media_info.tracks[0].id == 1);
+        test_assert(media_info.tracks[0].video.width == 1920);
+        test_assert(media_info.tracks[0].video.height == 1080);
+        test_assert(media_info.tracks[0].video.frame_rate_num == 25);
+        test_assert(media_info.tracks[0].video.frame_rate_den == 1);
+
+        test_assert(media_info.tracks[1].type == track_type::audio);
+        test_assert(media_info.tracks[1].id == 2);
+        test_assert(media_info.tracks[1].language == "dut");
+        test_assert(media_info.tracks[1].audio.sample_rate == 44100);
+        test_assert(media_info.tracks[1].audio.channels == 2);
+    }
+
+    struct test ts_test;
+    void ts()
+    {
+        struct media_cache::media_info media_info;
+        test_assert(probe_media_info(make_ts(0x02), media_info));
+        test_assert(media_info.duration == std::chrono::milliseconds(60000));
+        test_assert(media_info.tracks.size() == 2);
+
+        test_assert(media_info.tracks[0].type == track_type::video);
+        test_assert(media_info.tracks[0].id == 0x101);
+        test_assert(media_info.tracks[0].video.width == 720);
+        test_assert(media_info.tracks[0].video.height == 576);
+        test_assert(media_info.tracks[0].video.frame_rate_num == 25);
+
+        test_assert(media_info.tracks[1].type == track_type::audio);
+        test_assert(media_info.tracks[1].id == 0x102);
+        test_assert(media_info.tracks[1].language == "fre");
+        test_assert(media_info.tracks[1].audio.sample_rate == 48000);
+        test_assert(media_info.tracks[1].audio.channels == 2);
+
+        // HEVC is left to libvlc.
+        test_assert(!probe_media_info(make_ts(0x24), media_info));
+    }
+
+    struct test ps_test;
+    void ps()
+    {
+        struct media_cache::media_info media_info;
+        test_assert(probe_media_info(make_ps(), media_info));
+        test_assert(media_info.duration == std::chrono::milliseconds(30000));
+        test_assert(media_info.tracks.size() == 2);
+
+        test_assert(media_info.tracks[0].type == track_type::video);
+        test_assert(media_info.tracks[0].id == 0xE0);
+        test_assert(media_info.tracks[0].video.width == 720);
+        test_assert(media_info.tracks[0].video.height == 576);
+
+        test_assert(media_info.tracks[1].type == track_type::audio);
+        test_assert(media_info.tracks[1].id == 0xBD80);
+        test_assert(media_info.tracks[1].audio.sample_rate == 48000);
+        test_assert(media_info.tracks[1].audio.channels == 6);
+    }
+
+    struct test unsupported_test;
+    void unsupported()
+    {
+        const resources::resource_file pm5544_png(resources::pm5544_png, "png");
+        const resources::resource_file a440hz_mp2(resources::a440hz_mp2, "mp2");
+
+        struct media_cache::media_info media_info;
+        test_assert(!probe_media_info(pm5544_png, media_info));
+        test_assert(!probe_media_info(a440hz_mp2, media_info));
+        test_assert(!probe_media_info(platform::temp_file_path("none"), media_info));
+    }
+
+    struct test malformed_test;
+    void malformed()
+    {
+        struct media_cache::media_info media_info;
+
+        // A 64-bit box size that wraps the position back to the ftyp box.
+        std::string mp4 = box("ftyp", "isom" + std::string(4, '\0'));
+        const uint64_t wrap = 0 - uint64_t(mp4.size());
+        u32(mp4, 1);
+        mp4 += "free";
+        u32(mp4, uint32_t(wrap >> 32));
+        u32(mp4, uint32_t(wrap));
+        test_assert(!probe_media_info(write_file(mp4, "mp4"), media_info));
+
+        // An EBML header of unknown size.
+        std::string mkv;
+        u32(mkv, 0x1A45DFA3);
+        u8(mkv, 0xFF);
+        u16(mkv, 0x4282);
+        u8(mkv, 0x88);
+        mkv += "matroska";
+        mkv += ebml(0x18538067, std::string());
+        test_assert(!probe_media_info(write_file(mkv, "mkv"), media_info));
+    }
+} media_probe_test;
+
+} // End of namespace
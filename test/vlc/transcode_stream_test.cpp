@@ -3,6 +3,7 @@
 #include "vlc/media_cache.h"
 #include "platform/fstream.h"
 #include "platform/path.h"
+#include "platform/recordfile.h"
 #include "resources/resource_file.h"
 #include "resources/resources.h"
 #include <algorithm>
@@ -13,12 +14,14 @@ static const struct transcode_stream_test
 {
     const resources::resource_file a440hz_mp2;
     const resources::resource_file pm5544_png;
-    std::string media_cache_file, out_file;
+    std::string media_cache_file, media_fingerprints_file, media_store_file, out_file;
 
     transcode_stream_test()
         : a440hz_mp2(resources::a440hz_mp2, "mp2"),
           pm5544_png(resources::pm5544_png, "png"),
           media_cache_file(platform::temp_file_path("ini")),
+          media_fingerprints_file(platform::temp_file_path("ini")),
+          media_store_file(platform::temp_file_path("db")),
           transcode_mp2v_ps_test(this, "vlc::transcode_stream::transcode_mp2v_ps", &transcode_stream_test::transcode_mp2v_ps),
           transcode_mp2v_ts_test(this, "vlc::transcode_stream::transcode_mp2v_ts", &transcode_stream_test::transcode_mp2v_ts),
           transcode_h264_ts_test(this, "vlc::transcode_stream::transcode_h264_ts", &transcode_stream_test::transcode_h264_ts)
@@ -32,6 +35,12 @@ static const struct transcode_stream_test
 
         if (!media_cache_file.empty())
             ::remove(media_cache_file.c_str());
+
+        if (!media_fingerprints_file.empty())
+            ::remove(media_fingerprints_file.c_str());
+
+        if (!media_store_file.empty())
+            ::remove(media_store_file.c_str());
     }
 
     void transcode_base(const std::string &transcode, const char *mux)
@@ -40,7 +49,9 @@ static const struct transcode_stream_test
         class platform::messageloop_ref messageloop_ref(messageloop);
 
         class platform::inifile inifile(media_cache_file, false);
-        class media_cache media_cache(messageloop_ref, inifile);
+        class platform::inifile fingerprint_file(media_fingerprints_file, false);
+        class platform::recordfile recordfile(media_store_file);
+        class media_cache media_cache(messageloop_ref, inifile, fingerprint_file, recordfile);
 
         if (!out_file.empty())
             ::remove(out_file.c_str());